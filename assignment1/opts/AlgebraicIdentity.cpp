@@ -4,6 +4,48 @@
 //-----------------------------------------------------------------------------
 
 #include "LocalOpts.h"
+#include "llvm/IR/Constants.h"
+
+/*
+  Floating point: alcune identità valgono sempre in IEEE-754, le altre solo con i fast-math flag dell'istruzione
+    • x + (-0.0) = x, x - 0.0 = x, x * 1.0 = x, x / 1.0 = x     sempre
+    • x + 0.0 = x, x - (-0.0) = x                                nsz (-0.0 + 0.0 = +0.0)
+    • x * 0.0 = 0.0                                              nnan (inf * 0.0 = NaN) e nsz (-1.0 * 0.0 = -0.0)
+    • x - x = 0.0, x / x = 1.0                                   nnan e ninf (inf - inf, 0.0 / 0.0 = NaN)
+*/
+Value *getFPIdentity(Instruction &Inst) {
+  Value *op1 = Inst.getOperand(0);
+  Value *op2 = Inst.getOperand(1);
+  ConstantFP *fpOp1 = dyn_cast<ConstantFP>(op1);
+  ConstantFP *fpOp2 = dyn_cast<ConstantFP>(op2);
+  bool nsz = Inst.hasNoSignedZeros();
+
+  switch(Inst.getOpcode()) {
+    case Instruction::FAdd:
+      if (fpOp1 && fpOp1->isZero() && (fpOp1->isNegative() || nsz)) return op2;
+      if (fpOp2 && fpOp2->isZero() && (fpOp2->isNegative() || nsz)) return op1;
+      break;
+
+    case Instruction::FSub:
+      if (fpOp2 && fpOp2->isZero() && (!fpOp2->isNegative() || nsz)) return op1;
+      if (op1 == op2 && Inst.hasNoNaNs() && Inst.hasNoInfs()) return ConstantFP::get(Inst.getType(), 0.0);
+      break;
+
+    case Instruction::FMul:
+      if (fpOp1 && fpOp1->isExactlyValue(1.0)) return op2;
+      if (fpOp2 && fpOp2->isExactlyValue(1.0)) return op1;
+      if (((fpOp1 && fpOp1->isZero()) || (fpOp2 && fpOp2->isZero())) && Inst.hasNoNaNs() && nsz)
+        return ConstantFP::get(Inst.getType(), 0.0);
+      break;
+
+    case Instruction::FDiv:
+      if (fpOp2 && fpOp2->isExactlyValue(1.0)) return op1;
+      if (op1 == op2 && Inst.hasNoNaNs() && Inst.hasNoInfs()) return ConstantFP::get(Inst.getType(), 1.0);
+      break;
+  }
+
+  return nullptr;
+}
 
 bool runOnBasicBlockOpt1(BasicBlock &BB) {
   Value *op1, *op2, *zero, *one;
@@ -12,6 +54,11 @@ bool runOnBasicBlockOpt1(BasicBlock &BB) {
   for(Instruction &Inst : BB) {
     if (!Inst.isBinaryOp()) continue;
 
+    if (Inst.getType()->isFPOrFPVectorTy()) {
+      if (Value *V = getFPIdentity(Inst)) Inst.replaceAllUsesWith(V);
+      continue;
+    }
+
     zero = ConstantInt::get(Inst.getType(), 0);
     one = ConstantInt::get(Inst.getType(), 1);
 
@@ -0,0 +1,257 @@
+//-----------------------------------------------------------------------------
+// Sparse Conditional Constant Propagation Pass implementation
+//-----------------------------------------------------------------------------
+
+/*
+ALGORITMO (Wegman-Zadeck):
+  • Ogni valore SSA ha un valore nel lattice:  Undefined  ->  Constant(C)  ->  Overdefined
+    (si scende solo verso il basso: due costanti diverse danno Overdefined)
+  • Due worklist:
+    • CFG: archi diventati eseguibili (un blocco è eseguibile se almeno un arco entrante lo è)
+    • SSA: istruzioni il cui operando ha cambiato valore nel lattice
+  • Un PHINode considera solo i valori che arrivano da archi eseguibili
+  • Un branch con condizione costante rende eseguibile un solo successore
+  • Al termine:
+    • Le istruzioni Constant vengono sostituite dalla costante
+    • I branch con condizione costante diventano incondizionati
+    • I blocchi mai eseguibili vengono eliminati
+  Così i passi ai/sr/mi trovano le costanti negli operandi (dyn_cast<ConstantInt>)
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/ConstantFolding.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+struct LatticeValue {
+  enum State { Undefined, Constant, Overdefined };
+  State S = Undefined;
+  llvm::Constant *C = nullptr;
+
+  bool isUndefined() const { return S == Undefined; }
+  bool isConstant() const { return S == Constant; }
+  bool isOverdefined() const { return S == Overdefined; }
+  bool operator==(const LatticeValue &O) const { return S == O.S && C == O.C; }
+
+  static LatticeValue get(llvm::Constant *C) { return {Constant, C}; }
+  static LatticeValue overdefined() { return {Overdefined, nullptr}; }
+};
+
+// Meet di due valori del lattice
+LatticeValue meetLattice(LatticeValue A, LatticeValue B) {
+  if (A.isUndefined()) return B;
+  if (B.isUndefined()) return A;
+  if (A.isConstant() && B.isConstant() && A.C == B.C) return A;
+  return LatticeValue::overdefined();
+}
+
+class SCCPSolver {
+public:
+  SCCPSolver(Function &F) : F(F), DL(F.getParent()->getDataLayout()) {}
+
+  void solve() {
+    markEdgeExecutable(nullptr, &F.getEntryBlock());
+
+    // Un branch su un valore rimasto Undefined non rende eseguibile nessun successore:
+    // si forza la condizione a Overdefined e si riparte finché non succede più
+    do {
+      while (!BlockWorklist.empty() || !InstWorklist.empty()) {
+        while (!BlockWorklist.empty()) {
+          BasicBlock *BB = BlockWorklist.pop_back_val();
+          for (Instruction &I : *BB) visit(I);
+        }
+        while (!InstWorklist.empty()) {
+          Instruction *I = InstWorklist.pop_back_val();
+          if (Executable.count(I->getParent())) visit(*I);
+        }
+      }
+    } while (resolveUndefinedBranches());
+  }
+
+  LatticeValue getValue(Value *V) {
+    if (auto *C = dyn_cast<Constant>(V)) return LatticeValue::get(C);
+    if (!isa<Instruction>(V)) return LatticeValue::overdefined(); // Argomenti, ...
+    return Values.lookup(V);
+  }
+
+  bool isExecutable(BasicBlock *BB) const { return Executable.count(BB); }
+
+private:
+  void markEdgeExecutable(BasicBlock *From, BasicBlock *To) {
+    if (From && !ExecutableEdges.insert({From, To}).second) return;
+
+    if (Executable.insert(To).second) {
+      BlockWorklist.push_back(To); // Primo arco eseguibile: si visita tutto il blocco
+    } else {
+      for (PHINode &Phi : To->phis()) InstWorklist.push_back(&Phi); // Nuovo arco: cambiano solo i PHI
+    }
+  }
+
+  void update(Instruction &I, LatticeValue New) {
+    LatticeValue &Old = Values[&I];
+    New = meetLattice(Old, New); // Il valore può solo scendere nel lattice
+    if (New == Old) return;
+
+    Old = New;
+    for (User *U : I.users()) {
+      if (auto *UI = dyn_cast<Instruction>(U)) InstWorklist.push_back(UI);
+    }
+  }
+
+  void visit(Instruction &I) {
+    if (auto *Phi = dyn_cast<PHINode>(&I))        return visitPHI(*Phi);
+    if (auto *Br = dyn_cast<BranchInst>(&I))      return visitBranch(*Br);
+    if (auto *Sw = dyn_cast<SwitchInst>(&I))      return visitSwitch(*Sw);
+    if (I.isTerminator()) {
+      // invoke/callbr producono un valore: non noto, altrimenti resterebbe Undefined e un PHI che lo unisce
+      // a una costante diventerebbe quella costante
+      if (!I.getType()->isVoidTy()) update(I, LatticeValue::overdefined());
+      for (BasicBlock *Succ : successors(&I)) markEdgeExecutable(I.getParent(), Succ);
+      return;
+    }
+    if (I.getType()->isVoidTy()) return;
+
+    // Solo istruzioni senza effetti collaterali e senza accessi in memoria
+    if (!(I.isBinaryOp() || isa<CastInst>(I) || isa<CmpInst>(I) || isa<SelectInst>(I) || isa<GetElementPtrInst>(I)))
+      return update(I, LatticeValue::overdefined());
+
+    if (auto *Sel = dyn_cast<SelectInst>(&I)) {
+      LatticeValue Cond = getValue(Sel->getCondition());
+      if (Cond.isUndefined()) return;
+      if (auto *CI = dyn_cast_or_null<ConstantInt>(Cond.C))
+        return update(I, getValue(CI->isOne() ? Sel->getTrueValue() : Sel->getFalseValue()));
+      return update(I, meetLattice(getValue(Sel->getTrueValue()), getValue(Sel->getFalseValue())));
+    }
+
+    SmallVector<Constant*, 4> Ops;
+    for (Value *Op : I.operands()) {
+      LatticeValue V = getValue(Op);
+      if (V.isOverdefined()) return update(I, LatticeValue::overdefined());
+      if (V.isUndefined()) return; // Si aspetta che l'operando venga definito
+      Ops.push_back(V.C);
+    }
+
+    Constant *Folded;
+    if (auto *Cmp = dyn_cast<CmpInst>(&I))
+      Folded = ConstantFoldCompareInstOperands(Cmp->getPredicate(), Ops[0], Ops[1], DL);
+    else
+      Folded = ConstantFoldInstOperands(&I, Ops, DL);
+
+    update(I, Folded ? LatticeValue::get(Folded) : LatticeValue::overdefined());
+  }
+
+  void visitPHI(PHINode &Phi) {
+    LatticeValue Result;
+    for (unsigned i = 0; i < Phi.getNumIncomingValues(); i++) {
+      if (!ExecutableEdges.count({Phi.getIncomingBlock(i), Phi.getParent()})) continue;
+
+      Result = meetLattice(Result, getValue(Phi.getIncomingValue(i)));
+      if (Result.isOverdefined()) break;
+    }
+    update(Phi, Result);
+  }
+
+  void visitBranch(BranchInst &Br) {
+    BasicBlock *BB = Br.getParent();
+    if (Br.isUnconditional()) return markEdgeExecutable(BB, Br.getSuccessor(0));
+
+    LatticeValue Cond = getValue(Br.getCondition());
+    if (Cond.isUndefined()) return;
+
+    if (auto *CI = dyn_cast_or_null<ConstantInt>(Cond.C))
+      return markEdgeExecutable(BB, Br.getSuccessor(CI->isOne() ? 0 : 1));
+
+    markEdgeExecutable(BB, Br.getSuccessor(0));
+    markEdgeExecutable(BB, Br.getSuccessor(1));
+  }
+
+  void visitSwitch(SwitchInst &Sw) {
+    BasicBlock *BB = Sw.getParent();
+    LatticeValue Cond = getValue(Sw.getCondition());
+    if (Cond.isUndefined()) return;
+
+    if (auto *CI = dyn_cast_or_null<ConstantInt>(Cond.C))
+      return markEdgeExecutable(BB, Sw.findCaseValue(CI)->getCaseSuccessor());
+
+    for (BasicBlock *Succ : successors(BB)) markEdgeExecutable(BB, Succ);
+  }
+
+  bool resolveUndefinedBranches() {
+    bool changed = false;
+    for (BasicBlock *BB : Executable) {
+      Value *Cond = nullptr;
+      if (auto *Br = dyn_cast<BranchInst>(BB->getTerminator()))
+        Cond = Br->isConditional() ? Br->getCondition() : nullptr;
+      else if (auto *Sw = dyn_cast<SwitchInst>(BB->getTerminator()))
+        Cond = Sw->getCondition();
+
+      auto *CondInst = dyn_cast_or_null<Instruction>(Cond);
+      if (CondInst && getValue(CondInst).isUndefined()) {
+        update(*CondInst, LatticeValue::overdefined());
+        InstWorklist.push_back(BB->getTerminator());
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  Function &F;
+  const DataLayout &DL;
+  DenseMap<Value*, LatticeValue> Values;
+  SmallPtrSet<BasicBlock*, 32> Executable;
+  DenseSet<std::pair<BasicBlock*, BasicBlock*>> ExecutableEdges;
+  SmallVector<BasicBlock*> BlockWorklist;
+  SmallVector<Instruction*> InstWorklist;
+};
+
+bool runOnFunctionSCCP(Function &F) {
+  SCCPSolver Solver(F);
+  Solver.solve();
+
+  unsigned constants = 0;
+  unsigned folded = 0;
+
+  // Sostituzione dei valori costanti (solo nei blocchi eseguibili, gli altri vengono eliminati)
+  for (BasicBlock &BB : F) {
+    if (!Solver.isExecutable(&BB)) continue;
+
+    for (Instruction &Inst : BB) {
+      if (Inst.use_empty()) continue;
+
+      LatticeValue V = Solver.getValue(&Inst);
+      if (V.isConstant()) {
+        Inst.replaceAllUsesWith(V.C); // NB: replaceAllUsesWith non rimuove le istruzioni (default: dce=1)
+        constants++;
+      }
+    }
+  }
+
+  // I branch con condizione ora costante diventano incondizionati (aggiornando i PHI del successore scartato)
+  for (BasicBlock &BB : F) {
+    if (Solver.isExecutable(&BB) && ConstantFoldTerminator(&BB, true))
+      folded++;
+  }
+
+  // I blocchi mai eseguibili non sono più raggiungibili dall'entry
+  unsigned before = F.size();
+  removeUnreachableBlocks(F);
+  unsigned removed = before - F.size();
+
+  errs() << "(costanti: " << constants << ", branch: " << folded << ", blocchi rimossi: " << removed << ") ";
+  return constants || folded || removed;
+}
+
+PreservedAnalyses ConstantPropagationPass::run(Function &F, FunctionAnalysisManager &) {
+  errs() << F.getName() << ": ";
+
+  if (!runOnFunctionSCCP(F)) {
+    errs() << "Not Transformed by ConstantPropagationPass\n";
+    return PreservedAnalyses::all();
+  }
+
+  errs() << "Transformed by ConstantPropagationPass\n";
+  return PreservedAnalyses::none();
+}
@@ -0,0 +1,178 @@
+//-----------------------------------------------------------------------------
+// Function Specialization Pass implementation
+//-----------------------------------------------------------------------------
+
+/*
+I passi locali vedono solo gli Argument della funzione: in foo(1, 2) le costanti restano nel chiamante.
+
+ALGORITMO (passo di modulo):
+  • Candidati: chiamate dirette a funzioni definite nel modulo (non interponibili, non varargs, non optnone)
+    con almeno un argomento intero o floating point costante, usato dalla funzione chiamata.
+    Un argomento non costante conta come costante se LazyValueInfo lo dimostra nel punto della chiamata
+    (es. dentro if (n == 8))
+  • Le chiamate con le stesse costanti agli stessi argomenti condividono un clone
+  • Con un profilo (ProfileSummaryInfo) solo le chiamate in blocchi caldi; in ogni caso i cloni vengono creati
+    dalla chiamata più frequente (BlockFrequencyInfo del chiamante, relativa al suo entry)
+  • Budget: le istruzioni dei cloni non superano Budget (un clone che non ci sta viene saltato)
+  • Clone: gli usi degli argomenti costanti diventano la costante, le chiamate vengono ridirette al clone
+    (interno al modulo; la firma non cambia, gli argomenti restano inutilizzati)
+  • Sul clone viene eseguita la pipeline di fs(...) (default cp,ai,sr,mi): cp propaga le costanti,
+    ai/sr/mi trovano ConstantInt negli operandi
+  La funzione originale resta (può avere altri chiamanti o essere esterna)
+*/
+
+#include "LocalOpts.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/LazyValueInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <map>
+#include <tuple>
+
+// Parametri di fs<...>, separati da ';' (es. fs<budget=1000>)
+Expected<FunctionSpecializationOptions> parseFunctionSpecializationOptions(StringRef Params) {
+  FunctionSpecializationOptions Opts;
+  while (!Params.empty()) {
+    StringRef Param;
+    std::tie(Param, Params) = Params.split(';');
+    if (Param.consume_front("budget=")) {
+      if (Param.getAsInteger(0, Opts.Budget))
+        return createStringError(inconvertibleErrorCode(), "fs: budget non valido '" + Param + "'");
+    } else {
+      return createStringError(inconvertibleErrorCode(), "fs: parametro sconosciuto '" + Param + "'");
+    }
+  }
+  return Opts;
+}
+
+// Una specializzazione: funzione e costante per argomento (nullptr: argomento non specializzato)
+struct SpecializationKey {
+  Function *F;
+  SmallVector<Constant*, 4> Args;
+
+  bool operator<(const SpecializationKey &O) const {
+    return std::tie(F, Args) < std::tie(O.F, O.Args);
+  }
+};
+
+struct SpecializationCandidate {
+  SpecializationKey Key;
+  SmallVector<CallBase*, 4> Calls;
+  double Frequency = 0; // Somma delle frequenze delle chiamate
+};
+
+bool isSpecializable(Function &F) {
+  return !F.isDeclaration() && !F.isVarArg() && !F.isInterposable() && !F.hasOptNone() && !F.isIntrinsic();
+}
+
+// Costante passata all'argomento A nella chiamata CB, nullptr se non nota o inutile
+Constant *getConstantArgument(CallBase &CB, Argument &A, LazyValueInfo &LVI) {
+  if (A.use_empty() || !(A.getType()->isIntegerTy() || A.getType()->isFloatingPointTy())) return nullptr;
+
+  Value *V = CB.getArgOperand(A.getArgNo());
+  if (isa<ConstantInt>(V) || isa<ConstantFP>(V)) return cast<Constant>(V);
+  if (Constant *C = LVI.getConstant(V, &CB)) {
+    if (isa<ConstantInt>(C)) return C;
+  }
+  return nullptr;
+}
+
+unsigned getInstructionCount(Function &F) {
+  unsigned count = 0;
+  for (BasicBlock &BB : F) count += BB.size();
+  return count;
+}
+
+Function *createSpecialization(const SpecializationKey &Key, unsigned id) {
+  ValueToValueMapTy VMap;
+  Function *Clone = CloneFunction(Key.F, VMap);
+  Clone->setName(Key.F->getName() + ".spec." + Twine(id));
+  Clone->setLinkage(GlobalValue::InternalLinkage);
+  Clone->setVisibility(GlobalValue::DefaultVisibility);
+  Clone->setComdat(nullptr);
+
+  for (unsigned i = 0; i < Key.Args.size(); i++) {
+    if (Key.Args[i]) Clone->getArg(i)->replaceAllUsesWith(Key.Args[i]);
+  }
+  return Clone;
+}
+
+PreservedAnalyses FunctionSpecializationPass::run(Module &M, ModuleAnalysisManager &MAM) {
+  FunctionAnalysisManager &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  ProfileSummaryInfo &PSI = MAM.getResult<ProfileSummaryAnalysis>(M);
+
+  // Raccolta delle chiamate specializzabili, raggruppate per (funzione, costanti), in ordine di incontro
+  std::map<SpecializationKey, unsigned> index;
+  SmallVector<SpecializationCandidate> candidates;
+  for (Function &Caller : M) {
+    if (Caller.isDeclaration()) continue;
+
+    LazyValueInfo &LVI = FAM.getResult<LazyValueAnalysis>(Caller);
+    BlockFrequencyInfo &BFI = FAM.getResult<BlockFrequencyAnalysis>(Caller);
+    double entryFreq = BFI.getEntryFreq().getFrequency();
+
+    for (Instruction &I : instructions(Caller)) {
+      auto *CB = dyn_cast<CallBase>(&I);
+      if (!CB || CB->isMustTailCall()) continue;
+      Function *Callee = CB->getCalledFunction();
+      if (!Callee || !isSpecializable(*Callee) || CB->getFunctionType() != Callee->getFunctionType()) continue;
+      if (PSI.hasProfileSummary() && !PSI.isHotBlock(CB->getParent(), &BFI)) continue;
+
+      SpecializationKey Key{Callee, {}};
+      bool hasConstant = false;
+      for (Argument &A : Callee->args()) {
+        Key.Args.push_back(getConstantArgument(*CB, A, LVI));
+        hasConstant |= Key.Args.back() != nullptr;
+      }
+      if (!hasConstant) continue;
+
+      auto [It, inserted] = index.try_emplace(Key, candidates.size());
+      if (inserted) candidates.push_back({Key, {}});
+      SpecializationCandidate &Cand = candidates[It->second];
+      Cand.Calls.push_back(CB);
+      Cand.Frequency += BFI.getBlockFreq(CB->getParent()).getFrequency() / entryFreq;
+    }
+  }
+
+  // Dalla specializzazione più frequente, finché c'è budget
+  stable_sort(candidates, [](const SpecializationCandidate &A, const SpecializationCandidate &B) {
+    return A.Frequency > B.Frequency;
+  });
+
+  unsigned budget = Opts.Budget;
+  unsigned id = 0;
+  bool changed = false;
+
+  for (SpecializationCandidate &Cand : candidates) {
+    const SpecializationKey &Key = Cand.Key;
+    unsigned size = getInstructionCount(*Key.F);
+    if (size > budget) {
+      errs() << Key.F->getName() << ": specializzazione saltata (" << size << " istruzioni, budget " << budget << ")\n";
+      continue;
+    }
+    budget -= size;
+
+    Function *Clone = createSpecialization(Key, id++);
+    for (CallBase *CB : Cand.Calls) CB->setCalledFunction(Clone);
+    changed = true;
+
+    errs() << Key.F->getName() << " -> " << Clone->getName() << " (chiamate: " << Cand.Calls.size() << ", argomenti costanti:";
+    for (unsigned i = 0; i < Key.Args.size(); i++) {
+      if (Key.Args[i]) errs() << " " << i << "=" << *Key.Args[i];
+    }
+    errs() << ")\n";
+
+    CloneFPM.run(*Clone, FAM);
+  }
+
+  if (!changed) {
+    errs() << "Not Transformed by FunctionSpecializationPass\n";
+    return PreservedAnalyses::all();
+  }
+
+  errs() << "Transformed by FunctionSpecializationPass (cloni: " << id << ")\n";
+  return PreservedAnalyses::none();
+}
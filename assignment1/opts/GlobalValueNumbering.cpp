@@ -0,0 +1,156 @@
+//-----------------------------------------------------------------------------
+// Global Value Numbering Pass implementation
+//-----------------------------------------------------------------------------
+
+/*
+ALGORITMO (dominator-based GVN / global CSE):
+  • Ogni espressione è identificata da: opcode (+ predicato per i confronti), tipo e operandi
+  • Gli operandi sono già rappresentati dal loro "leader" (il valore con cui sono stati sostituiti),
+    quindi due espressioni con gli stessi operandi leader calcolano lo stesso valore
+  • Per le operazioni commutative gli operandi vengono ordinati per value number (a + b == b + a)
+  • Si visita il dominator tree con una hash table "scoped": entrando in un blocco si apre uno scope,
+    uscendone si chiude, così sono visibili solo le espressioni calcolate nei blocchi dominatori
+  • Se un'espressione è già nella tabella, l'istruzione viene sostituita dal leader che la domina
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/ScopedHashTable.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Operator.h"
+#include <memory>
+#include <vector>
+
+// Espressione "hash-consed"
+struct GVNExpression {
+  unsigned Opcode;
+  Type *Ty;
+  Type *ExtraTy; // Tipo sorgente per le GEP (stessi operandi ma tipi diversi non sono equivalenti)
+  SmallVector<Value*, 4> Ops;
+
+  bool operator==(const GVNExpression &O) const {
+    return Opcode == O.Opcode && Ty == O.Ty && ExtraTy == O.ExtraTy && Ops == O.Ops;
+  }
+};
+
+namespace llvm {
+template <> struct DenseMapInfo<GVNExpression> {
+  static GVNExpression getEmptyKey() { return {~0U, nullptr, nullptr, {}}; }
+  static GVNExpression getTombstoneKey() { return {~0U - 1, nullptr, nullptr, {}}; }
+  static unsigned getHashValue(const GVNExpression &E) {
+    return hash_combine(E.Opcode, E.Ty, E.ExtraTy, hash_combine_range(E.Ops.begin(), E.Ops.end()));
+  }
+  static bool isEqual(const GVNExpression &A, const GVNExpression &B) { return A == B; }
+};
+}
+
+using GVNTable = ScopedHashTable<GVNExpression, Instruction*>;
+using GVNScope = ScopedHashTableScope<GVNExpression, Instruction*>;
+
+// Istruzioni senza effetti collaterali e senza accessi in memoria
+bool isNumberable(Instruction &I) {
+  return I.isBinaryOp() || isa<CmpInst>(I) || isa<CastInst>(I) ||
+         isa<GetElementPtrInst>(I) || isa<SelectInst>(I);
+}
+
+// Value number di un valore: assegnato alla prima occorrenza, serve solo per ordinare gli operandi
+unsigned getValueNumber(DenseMap<Value*, unsigned> &numbers, Value *V) {
+  return numbers.try_emplace(V, numbers.size()).first->second;
+}
+
+GVNExpression buildExpression(Instruction &I, DenseMap<Value*, unsigned> &numbers) {
+  GVNExpression E{I.getOpcode(), I.getType(), nullptr, {}};
+
+  if (auto *Cmp = dyn_cast<CmpInst>(&I))
+    E.Opcode = (E.Opcode << 8) | Cmp->getPredicate();
+  if (auto *GEP = dyn_cast<GEPOperator>(&I))
+    E.ExtraTy = GEP->getSourceElementType();
+
+  for (Value *Op : I.operands())
+    E.Ops.push_back(Op);
+
+  // Canonicalizzazione delle operazioni commutative: operandi ordinati per value number
+  if (I.isCommutative() && getValueNumber(numbers, E.Ops[1]) < getValueNumber(numbers, E.Ops[0]))
+    std::swap(E.Ops[0], E.Ops[1]);
+
+  return E;
+}
+
+// Sostituisce le espressioni ridondanti di un blocco, ritorna il numero di sostituzioni
+unsigned runOnBasicBlockGVN(BasicBlock &BB, GVNTable &table, DenseMap<Value*, unsigned> &numbers) {
+  unsigned replaced = 0;
+
+  for (Instruction &Inst : BB) {
+    if (!isNumberable(Inst) || Inst.use_empty()) continue;
+
+    GVNExpression E = buildExpression(Inst, numbers);
+
+    if (Instruction *Leader = table.lookup(E)) {
+      // Il leader domina Inst: ne prende il posto, tenendo solo i flag (nsw, nuw, exact, inbounds) comuni
+      Leader->andIRFlags(&Inst);
+      Inst.replaceAllUsesWith(Leader); // NB: replaceAllUsesWith non rimuove le istruzioni (default: dce=1)
+      replaced++;
+    } else {
+      table.insert(E, &Inst);
+      getValueNumber(numbers, &Inst);
+    }
+  }
+
+  return replaced;
+}
+
+// Visita del dominator tree con uno stack esplicito (niente ricorsione su funzioni molto grandi)
+unsigned runOnFunctionGVN(Function &F, DominatorTree &DT) {
+  struct StackNode {
+    DomTreeNode *Node;
+    DomTreeNode::const_iterator Child;
+    std::unique_ptr<GVNScope> Scope;
+  };
+
+  GVNTable table;
+  DenseMap<Value*, unsigned> numbers;
+  std::vector<StackNode> stack;
+  unsigned replaced = 0;
+
+  // Argomenti numerati per primi, in ordine: la canonicalizzazione non dipende dagli indirizzi
+  for (Argument &A : F.args())
+    getValueNumber(numbers, &A);
+
+  DomTreeNode *Root = DT.getRootNode();
+  stack.push_back({Root, Root->begin(), std::make_unique<GVNScope>(table)});
+  replaced += runOnBasicBlockGVN(*Root->getBlock(), table, numbers);
+
+  while (!stack.empty()) {
+    StackNode &Top = stack.back();
+
+    if (Top.Child == Top.Node->end()) {
+      stack.pop_back(); // Chiude lo scope: le espressioni del blocco non sono più visibili
+      continue;
+    }
+
+    DomTreeNode *Next = *Top.Child++;
+    stack.push_back({Next, Next->begin(), std::make_unique<GVNScope>(table)});
+    replaced += runOnBasicBlockGVN(*Next->getBlock(), table, numbers);
+  }
+
+  return replaced;
+}
+
+PreservedAnalyses GlobalValueNumberingPass::run(Function &F, FunctionAnalysisManager &AM) {
+  errs() << F.getName() << ": ";
+
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  unsigned replaced = runOnFunctionGVN(F, DT);
+
+  if (!replaced) {
+    errs() << "Not Transformed by GlobalValueNumberingPass\n";
+    return PreservedAnalyses::all();
+  }
+
+  errs() << "Transformed by GlobalValueNumberingPass (espressioni ridondanti: " << replaced << ")\n";
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>(); // Il CFG non cambia
+  return PA;
+}
@@ -13,6 +13,43 @@ bool add_passes(StringRef Name, FunctionPassManager &FPM){
     FPM.addPass(MultiInstructionPass());
     return true;
   }
+  if (Name == "cp") {
+    FPM.addPass(ConstantPropagationPass());
+    return true;
+  }
+  if (Name == "gn") {
+    FPM.addPass(GlobalValueNumberingPass());
+    return true;
+  }
+  if (Name == "slp") {
+    FPM.addPass(SLPVectorizerPass());
+    return true;
+  }
+  if (Name == "vr") {
+    FPM.addPass(ValueRangePass());
+    return true;
+  }
+
+  return false;
+}
+
+// Passi di modulo: fs<budget=N>(pipeline dei cloni), default fs(cp,ai,sr,mi)
+bool add_module_passes(PassBuilder &PB, StringRef Name, ArrayRef<PassBuilder::PipelineElement> InnerPipeline, ModulePassManager &MPM){
+  if (PassBuilder::checkParametrizedPassName(Name, "fs")) {
+    Expected<FunctionSpecializationOptions> Opts = PassBuilder::parsePassParameters(parseFunctionSpecializationOptions, Name, "fs");
+    if (!Opts) {
+      errs() << toString(Opts.takeError()) << "\n";
+      return false;
+    }
+    FunctionPassManager CloneFPM;
+    Error Err = InnerPipeline.empty() ? PB.parsePassPipeline(CloneFPM, "cp,ai,sr,mi") : PB.parsePassPipeline(CloneFPM, InnerPipeline);
+    if (Err) {
+      errs() << toString(std::move(Err)) << "\n";
+      return false;
+    }
+    MPM.addPass(FunctionSpecializationPass(*Opts, std::move(CloneFPM)));
+    return true;
+  }
 
   return false;
 }
@@ -27,6 +64,10 @@ llvm::PassPluginLibraryInfo getTestPassPluginInfo() {
           return add_passes(Name, FPM);
         }
       );
+      PB.registerPipelineParsingCallback([&PB](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement> InnerPipeline) {
+          return add_module_passes(PB, Name, InnerPipeline, MPM);
+        }
+      );
     }
   };
 }
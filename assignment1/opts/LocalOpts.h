@@ -22,3 +22,42 @@ struct MultiInstructionPass : PassInfoMixin<MultiInstructionPass> {
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
   static bool isRequired() { return true; }
 };
+
+// Global Value Numbering
+struct GlobalValueNumberingPass : PassInfoMixin<GlobalValueNumberingPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Sparse Conditional Constant Propagation
+struct ConstantPropagationPass : PassInfoMixin<ConstantPropagationPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// SLP Vectorization
+struct SLPVectorizerPass : PassInfoMixin<SLPVectorizerPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Value Range Simplification
+struct ValueRangePass : PassInfoMixin<ValueRangePass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Function Specialization (modulo): fs<budget=N>(passi eseguiti sui cloni)
+struct FunctionSpecializationOptions {
+  unsigned Budget = 400; // Istruzioni aggiunte al modulo dai cloni
+};
+Expected<FunctionSpecializationOptions> parseFunctionSpecializationOptions(StringRef Params); // FunctionSpecialization.cpp
+
+struct FunctionSpecializationPass : PassInfoMixin<FunctionSpecializationPass> {
+  FunctionSpecializationPass(FunctionSpecializationOptions Opts, FunctionPassManager CloneFPM)
+    : Opts(Opts), CloneFPM(std::move(CloneFPM)) {}
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &);
+  static bool isRequired() { return true; }
+  FunctionSpecializationOptions Opts;
+  FunctionPassManager CloneFPM; // Eseguito su ogni clone, con gli argomenti ormai costanti
+};
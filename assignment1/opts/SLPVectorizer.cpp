@@ -0,0 +1,494 @@
+//-----------------------------------------------------------------------------
+// SLP Vectorization Pass implementation
+//-----------------------------------------------------------------------------
+
+/*
+SLP (Superword Level Parallelism): nel codice lineare (es. loop srotolati a mano) le stesse operazioni vengono
+ripetute su dati indipendenti:
+    out[0] = x[0] * h0 + y[0];
+    out[1] = x[1] * h1 + y[1];   ->   <out[0..3]> = <x[0..3]> * <h0..h3> + <y[0..3]>
+    ...
+
+ALGORITMO (per ogni basic block):
+  • Radici ("seed"):
+    • Store su indirizzi consecutivi (stessa base, distanza SCEV costante pari alla dimensione dell'elemento)
+    • Gruppi di operazioni binarie isomorfe (stesso opcode e tipo) indipendenti tra loro, dal fondo del blocco
+  • Albero bottom-up: partendo dal gruppo di radici (un "bundle" di VF scalari, uno per lane) si costruisce
+    il bundle di ogni operando. Un bundle è vettorizzabile se gli scalari sono istruzioni isomorfe del blocco,
+    non ancora vettorizzate, e i load sono consecutivi; altrimenti diventa un "gather" (insertelement)
+  • Codice vettoriale inserito prima dell'ultima radice: i load vettoriali non devono scavalcare store che
+    possono scrivere la stessa memoria, gli store radice non devono scavalcare accessi in alias (AA)
+  • Costo (TTI, reciprocal throughput): istruzioni scalari che muoiono contro istruzioni vettoriali,
+    insertelement dei gather ed extractelement per gli usi esterni all'albero
+    • Uno scalare usato da un'istruzione che viene prima del punto di inserimento resta vivo (con i suoi operandi)
+  • VF = larghezza dei registri vettoriali (TTI) / dimensione dell'elemento
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <optional>
+
+static const unsigned MaxTreeDepth = 12;
+
+// Bundle di scalari (uno per lane)
+struct SLPNode {
+  SmallVector<Value*, 8> scalars;
+  bool gather;
+  SmallVector<int, 3> operands; // Indici dei nodi operandi
+  Value *Vec = nullptr;
+};
+
+struct SLPTree {
+  BasicBlock &BB;
+  AAResults &AA;
+  ScalarEvolution &SE;
+  TargetTransformInfo &TTI;
+  const DataLayout &DL;
+
+  Instruction *InsertPt = nullptr;                // Ultima radice
+  SmallVector<StoreInst*, 8> stores;               // Radici store (vuoto per i gruppi di operazioni)
+  SmallVector<SLPNode, 16> nodes;
+  DenseMap<Value*, std::pair<int, unsigned>> lanes; // Scalare vettorizzato -> (nodo, lane)
+  SmallPtrSet<Value*, 16> alive;                   // Scalari vettorizzati che restano in uso
+
+  SLPTree(BasicBlock &BB, AAResults &AA, ScalarEvolution &SE, TargetTransformInfo &TTI, const DataLayout &DL)
+      : BB(BB), AA(AA), SE(SE), TTI(TTI), DL(DL) {}
+
+  unsigned getVF() const { return nodes[0].scalars.size(); }
+  // Istruzione vettorizzata o store radice: non serve lo scalare
+  bool isTreeUser(User *U) const { return lanes.count(U) || is_contained(stores, U); }
+
+  int buildNode(ArrayRef<Value*> VL, unsigned depth);
+  int newGather(ArrayRef<Value*> VL);
+  bool areConsecutiveLoads(ArrayRef<Value*> VL);
+  void computeAlive();
+  InstructionCost getCost(InstructionCost &ScalarCost);
+  Value *vectorizeNode(int idx, IRBuilder<> &Builder);
+  void vectorize();
+};
+
+// Distanza in byte tra due puntatori, se costante
+std::optional<int64_t> getPointerDistance(Value *From, Value *To, ScalarEvolution &SE) {
+  if (getUnderlyingObject(From) != getUnderlyingObject(To)) return std::nullopt;
+  auto *Diff = dyn_cast<SCEVConstant>(SE.getMinusSCEV(SE.getSCEV(To), SE.getSCEV(From)));
+  if (!Diff) return std::nullopt;
+  return Diff->getAPInt().getSExtValue();
+}
+
+static bool isVectorizableType(Type *Ty) {
+  return Ty->isIntegerTy() || Ty->isFloatingPointTy();
+}
+
+// Registri vettoriali / dimensione dell'elemento
+unsigned getMaxVF(TargetTransformInfo &TTI, Type *Ty) {
+  unsigned Bits = TTI.getRegisterBitWidth(TargetTransformInfo::RGK_FixedWidthVector).getFixedValue();
+  return Bits / std::max<unsigned>(Ty->getScalarSizeInBits(), 8);
+}
+
+// Load semplici su indirizzi consecutivi, senza store in alias fino al punto di inserimento
+bool SLPTree::areConsecutiveLoads(ArrayRef<Value*> VL) {
+  auto *First = cast<LoadInst>(VL[0]);
+  uint64_t Size = DL.getTypeStoreSize(First->getType());
+  for (unsigned k = 0; k < VL.size(); k++) {
+    auto *Load = cast<LoadInst>(VL[k]);
+    if (!Load->isSimple()) return false;
+    std::optional<int64_t> Dist = getPointerDistance(First->getPointerOperand(), Load->getPointerOperand(), SE);
+    if (!Dist || *Dist != (int64_t)(k * Size)) return false;
+
+    // Il load vettoriale viene eseguito al punto di inserimento, comunque prima degli store radice
+    // (uno store radice in alias prima del load è già escluso da tryVectorizeRoots)
+    MemoryLocation Loc = MemoryLocation::get(Load);
+    for (Instruction *I = Load->getNextNode(); I != InsertPt; I = I->getNextNode()) {
+      if (I->mayWriteToMemory() && !is_contained(stores, I) && isModSet(AA.getModRefInfo(I, Loc))) return false;
+    }
+  }
+  return true;
+}
+
+int SLPTree::newGather(ArrayRef<Value*> VL) {
+  nodes.push_back({SmallVector<Value*, 8>(VL.begin(), VL.end()), true, {}});
+  return nodes.size() - 1;
+}
+
+int SLPTree::buildNode(ArrayRef<Value*> VL, unsigned depth) {
+  // Stesso bundle già nell'albero (es. a[i] usato da due operazioni): riuso del nodo
+  for (unsigned n = 0; n < nodes.size(); n++) {
+    if (!nodes[n].gather && ArrayRef<Value*>(nodes[n].scalars) == VL) return n;
+  }
+
+  auto *I0 = dyn_cast<Instruction>(VL[0]);
+  if (depth > MaxTreeDepth || !I0 || !isVectorizableType(I0->getType())) return newGather(VL);
+
+  SmallPtrSet<Value*, 8> unique;
+  for (Value *V : VL) {
+    auto *I = dyn_cast<Instruction>(V);
+    if (!I || I->getParent() != &BB || I->getOpcode() != I0->getOpcode() || I->getType() != I0->getType() ||
+        lanes.count(I) || !unique.insert(I).second || (I != InsertPt && !I->comesBefore(InsertPt)))
+      return newGather(VL);
+    if (auto *Cmp = dyn_cast<CmpInst>(I); Cmp && Cmp->getPredicate() != cast<CmpInst>(I0)->getPredicate())
+      return newGather(VL);
+    if (isa<CastInst>(I) && I->getOperand(0)->getType() != I0->getOperand(0)->getType()) return newGather(VL);
+  }
+
+  bool isLoad = isa<LoadInst>(I0);
+  if (isLoad ? !areConsecutiveLoads(VL)
+             : !isa<BinaryOperator>(I0) && !isa<UnaryOperator>(I0) && !isa<CastInst>(I0) && !isa<CmpInst>(I0) &&
+               !isa<SelectInst>(I0))
+    return newGather(VL);
+
+  int idx = nodes.size();
+  nodes.push_back({SmallVector<Value*, 8>(VL.begin(), VL.end()), false, {}});
+  for (unsigned k = 0; k < VL.size(); k++) lanes[VL[k]] = {idx, k};
+  if (isLoad) return idx;
+
+  // Bundle degli operandi: per le operazioni commutative si scambiano gli operandi della lane
+  // se così l'opcode coincide con quello della lane 0 (es. a*b + c  e  c + a*b)
+  auto sameKind = [](Value *A, Value *B) {
+    auto *IA = dyn_cast<Instruction>(A), *IB = dyn_cast<Instruction>(B);
+    if (IA && IB) return IA->getOpcode() == IB->getOpcode();
+    return isa<Constant>(A) && isa<Constant>(B);
+  };
+
+  SmallVector<SmallVector<Value*, 8>, 3> operands(I0->getNumOperands());
+  for (Value *V : VL) {
+    auto *I = cast<Instruction>(V);
+    Value *Op0 = I->getOperand(0);
+    Value *Op1 = I->getNumOperands() > 1 ? I->getOperand(1) : nullptr;
+    if (I != I0 && I->isCommutative() && !sameKind(Op0, I0->getOperand(0)) && sameKind(Op1, I0->getOperand(0)))
+      std::swap(Op0, Op1);
+
+    operands[0].push_back(Op0);
+    if (Op1) operands[1].push_back(Op1);
+    if (I->getNumOperands() > 2) operands[2].push_back(I->getOperand(2));
+  }
+
+  for (auto &Bundle : operands) {
+    int Op = buildNode(Bundle, depth + 1);
+    nodes[idx].operands.push_back(Op);
+  }
+  return idx;
+}
+
+// Scalari vettorizzati che restano vivi: usati prima del punto di inserimento da istruzioni fuori dall'albero
+// o da un gather (un gather usa lo scalare, non la lane), e a catena i loro operandi
+void SLPTree::computeAlive() {
+  SmallVector<Instruction*, 16> worklist;
+  auto markAlive = [&](Value *V) {
+    if (lanes.count(V) && alive.insert(V).second) worklist.push_back(cast<Instruction>(V));
+  };
+
+  for (SLPNode &Node : nodes) {
+    for (Value *V : Node.scalars) {
+      if (Node.gather) {
+        markAlive(V);
+        continue;
+      }
+      for (User *U : V->users()) {
+        auto *UI = cast<Instruction>(U);
+        if (!isTreeUser(UI) && UI->getParent() == &BB && UI->comesBefore(InsertPt)) markAlive(V);
+      }
+    }
+  }
+
+  while (!worklist.empty()) {
+    Instruction *I = worklist.pop_back_val();
+    for (Value *Op : I->operands()) markAlive(Op);
+  }
+}
+
+InstructionCost SLPTree::getCost(InstructionCost &ScalarCost) {
+  const auto CostKind = TargetTransformInfo::TCK_RecipThroughput;
+  InstructionCost VecCost = 0;
+  ScalarCost = 0;
+
+  for (SLPNode &Node : nodes) {
+    auto *VecTy = FixedVectorType::get(Node.scalars[0]->getType(), Node.scalars.size());
+
+    if (Node.gather) {
+      if (all_of(Node.scalars, [](Value *V) { return isa<Constant>(V); })) continue;
+      bool splat = all_equal(Node.scalars);
+      for (unsigned k = 0; k < (splat ? 1 : Node.scalars.size()); k++)
+        VecCost += TTI.getVectorInstrCost(Instruction::InsertElement, VecTy, CostKind, k);
+      if (splat) VecCost += 1; // Shuffle di broadcast
+      continue;
+    }
+
+    auto *I0 = cast<Instruction>(Node.scalars[0]);
+    if (auto *Load = dyn_cast<LoadInst>(I0))
+      VecCost += TTI.getMemoryOpCost(Instruction::Load, VecTy, Load->getAlign(), Load->getPointerAddressSpace(), CostKind);
+    else if (auto *Cast = dyn_cast<CastInst>(I0))
+      VecCost += TTI.getCastInstrCost(Cast->getOpcode(), VecTy,
+                                      FixedVectorType::get(Cast->getSrcTy(), Node.scalars.size()),
+                                      TargetTransformInfo::CastContextHint::None, CostKind);
+    else if (auto *Cmp = dyn_cast<CmpInst>(I0))
+      VecCost += TTI.getCmpSelInstrCost(Cmp->getOpcode(), FixedVectorType::get(Cmp->getOperand(0)->getType(), Node.scalars.size()),
+                                        VecTy, Cmp->getPredicate(), CostKind);
+    else if (isa<SelectInst>(I0))
+      VecCost += TTI.getCmpSelInstrCost(Instruction::Select, VecTy,
+                                        FixedVectorType::get(I0->getOperand(0)->getType(), Node.scalars.size()),
+                                        CmpInst::BAD_ICMP_PREDICATE, CostKind);
+    else
+      VecCost += TTI.getArithmeticInstrCost(I0->getOpcode(), VecTy, CostKind);
+
+    for (unsigned k = 0; k < Node.scalars.size(); k++) {
+      auto *I = cast<Instruction>(Node.scalars[k]);
+      if (alive.count(I)) continue;
+      ScalarCost += TTI.getInstructionCost(I, CostKind);
+      // Usi fuori dall'albero dopo il punto di inserimento: extractelement
+      if (any_of(I->users(), [&](User *U) { return !isTreeUser(U); }))
+        VecCost += TTI.getVectorInstrCost(Instruction::ExtractElement, VecTy, CostKind, k);
+    }
+  }
+
+  // Store radice
+  if (!stores.empty()) {
+    auto *VecTy = FixedVectorType::get(stores[0]->getValueOperand()->getType(), stores.size());
+    VecCost += TTI.getMemoryOpCost(Instruction::Store, VecTy, stores[0]->getAlign(), stores[0]->getPointerAddressSpace(), CostKind);
+    for (StoreInst *S : stores) ScalarCost += TTI.getInstructionCost(S, CostKind);
+  }
+  return VecCost;
+}
+
+Value *SLPTree::vectorizeNode(int idx, IRBuilder<> &Builder) {
+  if (nodes[idx].Vec) return nodes[idx].Vec;
+  SmallVector<Value*, 3> ops;
+  for (int Op : nodes[idx].operands) ops.push_back(vectorizeNode(Op, Builder));
+
+  SLPNode &Node = nodes[idx];
+  unsigned VF = Node.scalars.size();
+  auto *VecTy = FixedVectorType::get(Node.scalars[0]->getType(), VF);
+
+  if (Node.gather) {
+    if (all_equal(Node.scalars)) return Node.Vec = Builder.CreateVectorSplat(VF, Node.scalars[0], "slp.splat");
+    Value *Vec = PoisonValue::get(VecTy);
+    for (unsigned k = 0; k < VF; k++) Vec = Builder.CreateInsertElement(Vec, Node.scalars[k], k, "slp.gather");
+    return Node.Vec = Vec;
+  }
+
+  auto *I0 = cast<Instruction>(Node.scalars[0]);
+  if (auto *Load = dyn_cast<LoadInst>(I0))
+    return Node.Vec = Builder.CreateAlignedLoad(VecTy, Load->getPointerOperand(), Load->getAlign(), "slp.load");
+
+  Instruction *New;
+  if (auto *Cast = dyn_cast<CastInst>(I0))
+    New = CastInst::Create(Cast->getOpcode(), ops[0], VecTy);
+  else if (auto *Cmp = dyn_cast<CmpInst>(I0))
+    New = CmpInst::Create(Cmp->getOpcode(), Cmp->getPredicate(), ops[0], ops[1]);
+  else if (isa<SelectInst>(I0))
+    New = SelectInst::Create(ops[0], ops[1], ops[2]);
+  else if (auto *UnOp = dyn_cast<UnaryOperator>(I0))
+    New = UnaryOperator::Create(UnOp->getOpcode(), ops[0]);
+  else
+    New = BinaryOperator::Create(cast<BinaryOperator>(I0)->getOpcode(), ops[0], ops[1]);
+
+  // Flag (nsw, fast-math, ...) validi per tutte le lane
+  New->copyIRFlags(I0);
+  for (Value *V : Node.scalars) New->andIRFlags(V);
+  return Node.Vec = Builder.Insert(New, "slp." + std::string(I0->getOpcodeName()));
+}
+
+void SLPTree::vectorize() {
+  IRBuilder<> Builder(InsertPt);
+  Value *Root = vectorizeNode(0, Builder);
+  if (!stores.empty()) Builder.CreateAlignedStore(Root, stores[0]->getPointerOperand(), stores[0]->getAlign());
+
+  // Usi esterni degli scalari che muoiono: extractelement (sono tutti dopo il punto di inserimento)
+  SmallVector<WeakTrackingVH, 16> dead;
+  for (SLPNode &Node : nodes) {
+    if (Node.gather) continue;
+    for (unsigned k = 0; k < Node.scalars.size(); k++) {
+      auto *I = cast<Instruction>(Node.scalars[k]);
+      dead.push_back(I);
+      if (alive.count(I)) continue;
+
+      Value *Extract = nullptr;
+      for (Use &U : make_early_inc_range(I->uses())) {
+        if (isTreeUser(U.getUser())) continue;
+        if (!Extract) Extract = Builder.CreateExtractElement(Node.Vec, k, I->getName() + ".slp");
+        U.set(Extract);
+      }
+    }
+  }
+
+  for (StoreInst *S : stores) S->eraseFromParent();
+  RecursivelyDeleteTriviallyDeadInstructionsPermissive(dead);
+}
+
+// Costruisce l'albero dalle radici e lo vettorizza se conviene
+bool tryVectorizeRoots(ArrayRef<Value*> roots, ArrayRef<StoreInst*> stores, BasicBlock &BB, AAResults &AA, ScalarEvolution &SE,
+                       TargetTransformInfo &TTI, const DataLayout &DL) {
+  SLPTree Tree(BB, AA, SE, TTI, DL);
+  for (Value *V : roots) {
+    auto *I = cast<Instruction>(V);
+    if (!Tree.InsertPt || Tree.InsertPt->comesBefore(I)) Tree.InsertPt = I;
+  }
+  Tree.stores.append(stores.begin(), stores.end());
+
+  SmallVector<Value*, 8> values;
+  if (stores.empty()) {
+    values.append(roots.begin(), roots.end());
+  } else {
+    // Gli store radice vengono spostati al punto di inserimento: nessun accesso in alias tra lo store e la sua nuova posizione
+    Instruction *First = stores[0];
+    for (StoreInst *S : stores) {
+      if (S->comesBefore(First)) First = S;
+      values.push_back(S->getValueOperand());
+    }
+    for (Instruction *I = First; I != Tree.InsertPt; I = I->getNextNode()) {
+      if (!I->mayReadOrWriteMemory() || is_contained(stores, I)) continue;
+      for (StoreInst *S : stores) {
+        if (S->comesBefore(I) && isModOrRefSet(AA.getModRefInfo(I, MemoryLocation::get(S)))) return false;
+      }
+    }
+  }
+
+  int RootIdx = Tree.buildNode(values, 0);
+  if (Tree.nodes[RootIdx].gather) return false; // Nemmeno le radici sono isomorfe
+
+  Tree.computeAlive();
+  InstructionCost ScalarCost;
+  InstructionCost VecCost = Tree.getCost(ScalarCost);
+
+  errs() << "  - " << (stores.empty() ? "Gruppo " : "Store ") << *roots[0] << " (VF " << Tree.getVF() << ", "
+         << Tree.nodes.size() << " nodi): costo scalare " << ScalarCost << ", vettoriale " << VecCost;
+  if (!VecCost.isValid() || VecCost >= ScalarCost) {
+    errs() << " -> non conveniente\n";
+    return false;
+  }
+  errs() << " -> vettorizzato\n";
+
+  Tree.vectorize();
+  return true;
+}
+
+// Catene di store consecutivi: per ogni base, store ordinati per distanza dal primo
+unsigned vectorizeStoreChains(BasicBlock &BB, AAResults &AA, ScalarEvolution &SE, TargetTransformInfo &TTI, const DataLayout &DL) {
+  MapVector<std::pair<Value*, Type*>, SmallVector<std::pair<int64_t, StoreInst*>, 8>> chains;
+  for (Instruction &I : BB) {
+    auto *S = dyn_cast<StoreInst>(&I);
+    if (!S || !S->isSimple() || !isVectorizableType(S->getValueOperand()->getType())) continue;
+
+    auto &Chain = chains[{getUnderlyingObject(S->getPointerOperand()), S->getValueOperand()->getType()}];
+    std::optional<int64_t> Dist = Chain.empty() ? 0 : getPointerDistance(Chain[0].second->getPointerOperand(),
+                                                                         S->getPointerOperand(), SE);
+    if (Dist) Chain.push_back({*Dist, S});
+  }
+
+  unsigned vectorized = 0;
+  for (auto &[Key, Chain] : chains) {
+    uint64_t Size = DL.getTypeStoreSize(Key.second);
+    unsigned MaxVF = getMaxVF(TTI, Key.second);
+    stable_sort(Chain, [](auto &A, auto &B) { return A.first < B.first; });
+
+    // Sequenze di indirizzi consecutivi, divise in gruppi da VF (potenza di 2)
+    unsigned Begin = 0;
+    while (Begin < Chain.size()) {
+      unsigned End = Begin + 1;
+      while (End < Chain.size() && Chain[End].first == Chain[End - 1].first + (int64_t)Size) End++;
+
+      while (End - Begin >= 2 && MaxVF >= 2) {
+        unsigned VF = std::min(MaxVF, 1u << Log2_32(End - Begin));
+        SmallVector<StoreInst*, 8> stores;
+        SmallVector<Value*, 8> roots;
+        for (unsigned k = Begin; k < Begin + VF; k++) {
+          stores.push_back(Chain[k].second);
+          roots.push_back(Chain[k].second);
+        }
+        if (tryVectorizeRoots(roots, stores, BB, AA, SE, TTI, DL)) vectorized++;
+        Begin += VF;
+      }
+      Begin = End;
+    }
+  }
+  return vectorized;
+}
+
+// True se From usa (anche indirettamente, nel blocco) il valore di To
+bool dependsOn(Instruction *From, Instruction *To) {
+  SmallVector<Instruction*, 16> worklist = {From};
+  SmallPtrSet<Instruction*, 16> visited;
+  while (!worklist.empty()) {
+    Instruction *I = worklist.pop_back_val();
+    for (Value *Op : I->operands()) {
+      auto *OpI = dyn_cast<Instruction>(Op);
+      if (OpI == To) return true;
+      // Le istruzioni prima di To non possono usarlo
+      if (OpI && OpI->getParent() == To->getParent() && To->comesBefore(OpI) && visited.insert(OpI).second)
+        worklist.push_back(OpI);
+    }
+  }
+  return false;
+}
+
+// Gruppi di operazioni isomorfe (stesso opcode e tipo) indipendenti tra loro. Si parte dal fondo del blocco:
+// le ultime operazioni di ogni catena sono le radici degli alberi più profondi (es. y = (x*x + 7) - x, per 4 x diverse)
+unsigned vectorizeOperationGroups(BasicBlock &BB, AAResults &AA, ScalarEvolution &SE, TargetTransformInfo &TTI, const DataLayout &DL) {
+  MapVector<std::pair<unsigned, Type*>, SmallVector<WeakTrackingVH, 8>> groups;
+  for (Instruction &I : reverse(BB)) {
+    if (I.isBinaryOp() && isVectorizableType(I.getType())) groups[{I.getOpcode(), I.getType()}].push_back(&I);
+  }
+
+  unsigned vectorized = 0;
+  for (auto &[Key, Candidates] : groups) {
+    unsigned MaxVF = getMaxVF(TTI, Key.second);
+    if (MaxVF < 2) continue;
+
+    SmallVector<WeakTrackingVH, 8> pending(Candidates.begin(), Candidates.end());
+    while (pending.size() >= 2) {
+      SmallVector<Instruction*, 8> group;
+      SmallVector<WeakTrackingVH, 8> rest;
+      for (WeakTrackingVH &VH : pending) {
+        auto *I = dyn_cast_or_null<Instruction>(VH);
+        if (!I) continue; // Eliminata da una vettorizzazione precedente
+        if (group.size() < MaxVF && none_of(group, [&](Instruction *G) { return dependsOn(G, I) || dependsOn(I, G); }))
+          group.push_back(I);
+        else
+          rest.push_back(VH);
+      }
+      if (group.size() < 2) break;
+
+      // VF potenza di 2, lane in ordine di programma (load consecutivi nello stesso ordine)
+      while (!isPowerOf2_32(group.size())) rest.push_back(group.pop_back_val());
+      sort(group, [](Instruction *A, Instruction *B) { return A->comesBefore(B); });
+
+      SmallVector<Value*, 8> roots(group.begin(), group.end());
+      if (tryVectorizeRoots(roots, {}, BB, AA, SE, TTI, DL)) vectorized++;
+      pending = std::move(rest);
+    }
+  }
+  return vectorized;
+}
+
+PreservedAnalyses SLPVectorizerPass::run(Function &F, FunctionAnalysisManager &AM) {
+  errs() << F.getName() << ":\n";
+
+  AAResults &AA = AM.getResult<AAManager>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  TargetTransformInfo &TTI = AM.getResult<TargetIRAnalysis>(F);
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  unsigned vectorized = 0;
+  for (BasicBlock &BB : F) {
+    vectorized += vectorizeStoreChains(BB, AA, SE, TTI, DL);
+    vectorized += vectorizeOperationGroups(BB, AA, SE, TTI, DL);
+  }
+
+  if (!vectorized) {
+    errs() << "Not Transformed by SLPVectorizerPass\n";
+    return PreservedAnalyses::all();
+  }
+
+  errs() << "Transformed by SLPVectorizerPass (alberi vettorizzati: " << vectorized << ")\n";
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>(); // Il CFG non cambia
+  return PA;
+}
@@ -3,10 +3,85 @@
 //-----------------------------------------------------------------------------
 
 #include "LocalOpts.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
 #include <cmath>
 
+/*
+  Floating point (le nuove istruzioni hanno i fast-math flag dell'originale):
+    • x * 2.0 -> x + x                                 sempre (esatto)
+    • x / C   -> x * (1/C)                             se 1/C è esatto (C potenza di 2), altrimenti solo con arcp
+    • (a * b) + c, (a * b) - c, c - (a * b) -> fmuladd  contract sulla fmul (con un solo uso) e sull'fadd/fsub
+      fmuladd diventa una FMA solo se il target la ha, altrimenti resta fmul + fadd
+*/
+Value *reduceFPInstruction(Instruction &Inst) {
+  IRBuilder<> Builder(&Inst);
+  Builder.setFastMathFlags(Inst.getFastMathFlags());
+  Value *op1 = Inst.getOperand(0);
+  Value *op2 = Inst.getOperand(1);
+
+  switch(Inst.getOpcode()) {
+    case Instruction::FMul: {
+      auto *fpOp = dyn_cast<ConstantFP>(op2);
+      Value *reg = op1;
+      if (!fpOp) {
+        fpOp = dyn_cast<ConstantFP>(op1);
+        reg = op2;
+      }
+      if (fpOp && fpOp->isExactlyValue(2.0)) return Builder.CreateFAdd(reg, reg);
+      break;
+    }
+
+    case Instruction::FDiv: {
+      auto *fpOp = dyn_cast<ConstantFP>(op2);
+      if (!fpOp) break;
+
+      APFloat inverse(fpOp->getValueAPF().getSemantics());
+      if (fpOp->getValueAPF().getExactInverse(&inverse))
+        return Builder.CreateFMul(op1, ConstantFP::get(Inst.getType(), inverse));
+
+      if (Inst.hasAllowReciprocal() && fpOp->getValueAPF().isFiniteNonZero()) {
+        inverse = APFloat(fpOp->getValueAPF().getSemantics(), 1);
+        inverse.divide(fpOp->getValueAPF(), APFloat::rmNearestTiesToEven);
+        return Builder.CreateFMul(op1, ConstantFP::get(Inst.getType(), inverse));
+      }
+      break;
+    }
+
+    case Instruction::FAdd:
+    case Instruction::FSub: {
+      if (!Inst.hasAllowContract()) break;
+
+      for (unsigned i = 0; i < 2; i++) {
+        auto *Mul = dyn_cast<BinaryOperator>(Inst.getOperand(i));
+        if (!Mul || Mul->getOpcode() != Instruction::FMul || !Mul->hasOneUse() || !Mul->hasAllowContract()) continue;
+
+        FastMathFlags FMF = Inst.getFastMathFlags();
+        FMF &= Mul->getFastMathFlags();
+        Builder.setFastMathFlags(FMF);
+
+        Value *a = Mul->getOperand(0);
+        Value *addend = Inst.getOperand(1 - i);
+        if (Inst.getOpcode() == Instruction::FSub) {
+          if (i == 0) addend = Builder.CreateFNeg(addend); // (a * b) - c = (a * b) + (-c)
+          else a = Builder.CreateFNeg(a);                  // c - (a * b) = (-a * b) + c
+        }
+        return Builder.CreateIntrinsic(Intrinsic::fmuladd, {Inst.getType()}, {a, Mul->getOperand(1), addend});
+      }
+      break;
+    }
+  }
+
+  return nullptr;
+}
+
 bool runOnBasicBlockOpt2(BasicBlock &BB) {
   for(Instruction &Inst : BB) {
+    if (Inst.isBinaryOp() && Inst.getType()->isFPOrFPVectorTy()) {
+      if (Value *V = reduceFPInstruction(Inst)) Inst.replaceAllUsesWith(V); // Le nuove istruzioni sono prima di Inst
+      continue;
+    }
+
     bool isDiv = (Inst.getOpcode() == Instruction::SDiv);
 
     if(isDiv || Inst.getOpcode() == Instruction::Mul) {
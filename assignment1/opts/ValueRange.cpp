@@ -0,0 +1,249 @@
+//-----------------------------------------------------------------------------
+// Value Range Simplification Pass implementation
+//-----------------------------------------------------------------------------
+
+/*
+ALGORITMO (range dei valori da LazyValueInfo, known bits da ValueTracking):
+  • Un valore è non negativo se il suo ConstantRange nel punto d'uso (LVI, che usa anche le condizioni dei branch
+    dominatori) o i suoi known bits lo dimostrano
+  • Operazioni con segno su valori non negativi diventano senza segno (stesso risultato, più economiche):
+    • sdiv x, 2^k -> lshr x, k        sdiv x, y -> udiv x, y
+    • srem x, 2^k -> and x, 2^k-1     srem x, y -> urem x, y
+    • ashr x, k   -> lshr x, k        sext x    -> zext nneg x
+    • icmp slt/sle/sgt/sge -> ult/ule/ugt/uge
+  • Un confronto il cui risultato è deciso dai range degli operandi diventa costante; i branch con condizione
+    costante diventano incondizionati (es. un controllo dei limiti ripetuto dentro un ramo che lo ha già fatto)
+  • Restringimento: add/sub/mul/and/or/xor su iN con operandi estesi da iM (o costanti) il cui risultato sta in iM
+    vengono calcolati in iM ed estesi (trunc(op(a, b)) = op(trunc a, trunc b), l'estensione ricostruisce il valore)
+    Solo se iM è un intero legale per il target
+  In ogni passata tutte le interrogazioni a LVI vengono fatte prima di trasformare (LVI non viene aggiornato), poi la
+  sua cache viene svuotata; si ripete finché qualcosa cambia, così le catene di operazioni vengono ristrette un passo
+  alla volta. I branch vengono ripiegati solo alla fine
+*/
+
+#include "LocalOpts.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/LazyValueInfo.h"
+#include "llvm/Analysis/SimplifyQuery.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include <optional>
+
+struct RangeStats {
+  unsigned unsignedOps = 0; // Operazioni e confronti con segno diventati senza segno
+  unsigned comparisons = 0; // Confronti costanti
+  unsigned narrowed = 0;    // Operazioni ristrette
+};
+
+bool isNonNegativeAt(Value *V, Instruction *CxtI, LazyValueInfo &LVI, const SimplifyQuery &SQ) {
+  if (!V->getType()->isIntegerTy()) return false;
+  return LVI.getConstantRange(V, CxtI, /*UndefAllowed*/ false).isAllNonNegative() ||
+         isKnownNonNegative(V, SQ.getWithInstruction(CxtI));
+}
+
+// Divisore costante potenza di 2 positiva (es. 16, non INT_MIN)
+ConstantInt *getPositivePowerOfTwo(Value *V) {
+  auto *C = dyn_cast<ConstantInt>(V);
+  return C && C->getValue().isPowerOf2() && !C->isNegative() ? C : nullptr;
+}
+
+// Operazione con segno i cui operandi sono non negativi: può diventare senza segno
+bool hasNonNegativeOperands(Instruction &I, LazyValueInfo &LVI, const SimplifyQuery &SQ) {
+  switch (I.getOpcode()) {
+    case Instruction::SDiv:
+    case Instruction::SRem:
+      if (!getPositivePowerOfTwo(I.getOperand(1)) && !isNonNegativeAt(I.getOperand(1), &I, LVI, SQ)) return false;
+      [[fallthrough]];
+    case Instruction::AShr:
+    case Instruction::SExt:
+      return isNonNegativeAt(I.getOperand(0), &I, LVI, SQ);
+  }
+  return false;
+}
+
+// Operazione con segno -> senza segno (gli operandi sono già stati controllati da hasNonNegativeOperands)
+Value *buildUnsignedOp(Instruction &I) {
+  Value *op0 = I.getOperand(0);
+  IRBuilder<> Builder(&I);
+
+  switch (I.getOpcode()) {
+    case Instruction::SDiv:
+    case Instruction::SRem: {
+      Value *op1 = I.getOperand(1);
+      bool isDiv = I.getOpcode() == Instruction::SDiv;
+
+      if (ConstantInt *C = getPositivePowerOfTwo(op1)) {
+        if (isDiv) return Builder.CreateLShr(op0, C->getValue().logBase2(), "", I.isExact());
+        return Builder.CreateAnd(op0, ConstantInt::get(I.getType(), C->getValue() - 1));
+      }
+      return isDiv ? Builder.CreateUDiv(op0, op1, "", I.isExact()) : Builder.CreateURem(op0, op1);
+    }
+
+    case Instruction::AShr:
+      return Builder.CreateLShr(op0, I.getOperand(1), "", I.isExact());
+
+    case Instruction::SExt: {
+      Value *Ext = Builder.CreateZExt(op0, I.getType());
+      if (auto *ZExt = dyn_cast<ZExtInst>(Ext)) ZExt->setNonNeg();
+      return Ext;
+    }
+  }
+
+  return nullptr;
+}
+
+// Confronto deciso dai range degli operandi: true/false, nullptr altrimenti
+Constant *getConstantComparison(ICmpInst &Cmp, LazyValueInfo &LVI) {
+  if (!Cmp.getOperand(0)->getType()->isIntegerTy()) return nullptr; // Puntatori e vettori
+
+  ConstantRange LHS = LVI.getConstantRange(Cmp.getOperand(0), &Cmp, /*UndefAllowed*/ false);
+  ConstantRange RHS = LVI.getConstantRange(Cmp.getOperand(1), &Cmp, /*UndefAllowed*/ false);
+
+  if (LHS.icmp(Cmp.getPredicate(), RHS)) return ConstantInt::getTrue(Cmp.getType());
+  if (LHS.icmp(Cmp.getInversePredicate(), RHS)) return ConstantInt::getFalse(Cmp.getType());
+  return nullptr;
+}
+
+// Sorgente di un'estensione o costante troncabile a NarrowTy (NarrowTy viene fissato dalla prima estensione)
+Value *getNarrowOperand(Value *V, IntegerType *&NarrowTy) {
+  if (auto *Ext = dyn_cast<CastInst>(V)) {
+    if (!isa<ZExtInst>(Ext) && !isa<SExtInst>(Ext)) return nullptr;
+    auto *SrcTy = cast<IntegerType>(Ext->getSrcTy());
+    if (NarrowTy && NarrowTy != SrcTy) return nullptr;
+    NarrowTy = SrcTy;
+    return Ext->getOperand(0);
+  }
+  return isa<ConstantInt>(V) ? V : nullptr;
+}
+
+// Estensione (zext o sext) con cui un'operazione su iN può essere calcolata in iM, vuoto se il risultato non sta in iM
+std::optional<Instruction::CastOps> getNarrowExtension(BinaryOperator &BO, LazyValueInfo &LVI, const DataLayout &DL) {
+  switch (BO.getOpcode()) {
+    case Instruction::Add: case Instruction::Sub: case Instruction::Mul:
+    case Instruction::And: case Instruction::Or: case Instruction::Xor:
+      break;
+    default:
+      return std::nullopt;
+  }
+  if (!BO.getType()->isIntegerTy()) return std::nullopt;
+
+  IntegerType *NarrowTy = nullptr;
+  Value *op0 = getNarrowOperand(BO.getOperand(0), NarrowTy);
+  Value *op1 = op0 ? getNarrowOperand(BO.getOperand(1), NarrowTy) : nullptr;
+  if (!op1 || !NarrowTy || !DL.isLegalInteger(NarrowTy->getBitWidth())) return std::nullopt;
+
+  ConstantRange R = LVI.getConstantRange(&BO, &BO, /*UndefAllowed*/ false);
+  unsigned bits = NarrowTy->getBitWidth();
+  if (R.getActiveBits() <= bits) return Instruction::ZExt;
+  if (R.getMinSignedBits() <= bits) return Instruction::SExt;
+  return std::nullopt;
+}
+
+// Operazione su iN calcolata in iM ed estesa con Ext (deciso da getNarrowExtension)
+Value *buildNarrowOp(BinaryOperator &BO, Instruction::CastOps Ext) {
+  IntegerType *NarrowTy = nullptr;
+  Value *op0 = getNarrowOperand(BO.getOperand(0), NarrowTy);
+  Value *op1 = getNarrowOperand(BO.getOperand(1), NarrowTy);
+
+  IRBuilder<> Builder(&BO);
+  Value *Narrow = Builder.CreateBinOp(BO.getOpcode(), Builder.CreateTrunc(op0, NarrowTy), Builder.CreateTrunc(op1, NarrowTy));
+  return Builder.CreateCast(Ext, Narrow, BO.getType());
+}
+
+// Una passata sulla funzione: prima tutte le decisioni (LVI vede solo l'IR originale), poi le sostituzioni
+bool runOnFunctionVR(Function &F, LazyValueInfo &LVI, const SimplifyQuery &SQ, RangeStats &stats) {
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  SmallVector<Instruction*> unsignedOps, signedCmps;
+  SmallVector<std::pair<Instruction*, Constant*>> constantCmps;
+  SmallVector<std::pair<BinaryOperator*, Instruction::CastOps>> narrowOps;
+
+  for (BasicBlock &BB : F) {
+    for (Instruction &I : BB) {
+      if (I.use_empty()) continue;
+
+      if (auto *Cmp = dyn_cast<ICmpInst>(&I)) {
+        if (Constant *C = getConstantComparison(*Cmp, LVI))
+          constantCmps.push_back({Cmp, C});
+        else if (Cmp->isSigned() && isNonNegativeAt(Cmp->getOperand(0), Cmp, LVI, SQ) &&
+                 isNonNegativeAt(Cmp->getOperand(1), Cmp, LVI, SQ))
+          signedCmps.push_back(Cmp);
+        continue;
+      }
+
+      switch (I.getOpcode()) {
+        case Instruction::SDiv: case Instruction::SRem: case Instruction::AShr: case Instruction::SExt:
+          if (hasNonNegativeOperands(I, LVI, SQ)) unsignedOps.push_back(&I);
+          break;
+        default:
+          if (auto *BO = dyn_cast<BinaryOperator>(&I))
+            if (auto Ext = getNarrowExtension(*BO, LVI, DL)) narrowOps.push_back({BO, *Ext});
+      }
+    }
+  }
+
+  bool changed = false;
+
+  for (auto [Cmp, C] : constantCmps) {
+    Cmp->replaceAllUsesWith(C); // NB: replaceAllUsesWith non rimuove le istruzioni (default: dce=1)
+    stats.comparisons++;
+    changed = true;
+  }
+
+  for (Instruction *I : signedCmps) {
+    auto *Cmp = cast<ICmpInst>(I);
+    Cmp->setPredicate(Cmp->getUnsignedPredicate());
+    stats.unsignedOps++;
+    changed = true;
+  }
+
+  for (Instruction *I : unsignedOps) {
+    I->replaceAllUsesWith(buildUnsignedOp(*I));
+    stats.unsignedOps++;
+    changed = true;
+  }
+
+  for (auto [BO, Ext] : narrowOps) {
+    BO->replaceAllUsesWith(buildNarrowOp(*BO, Ext));
+    stats.narrowed++;
+    changed = true;
+  }
+
+  // Le istruzioni nuove non sono nella cache di LVI e quelle sostituite non hanno più usi: la passata
+  // successiva riparte da zero
+  if (changed) LVI.clear();
+  return changed;
+}
+
+PreservedAnalyses ValueRangePass::run(Function &F, FunctionAnalysisManager &AM) {
+  errs() << F.getName() << ": ";
+
+  LazyValueInfo &LVI = AM.getResult<LazyValueAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  AssumptionCache &AC = AM.getResult<AssumptionAnalysis>(F);
+  SimplifyQuery SQ(F.getParent()->getDataLayout(), &DT, &AC);
+
+  RangeStats stats;
+  bool changed = false;
+  while (runOnFunctionVR(F, LVI, SQ, stats)) changed = true;
+
+  // I branch con condizione ora costante diventano incondizionati, i blocchi non più raggiungibili vengono eliminati
+  unsigned folded = 0;
+  for (BasicBlock &BB : F) {
+    if (ConstantFoldTerminator(&BB, true)) folded++;
+  }
+  if (folded) removeUnreachableBlocks(F);
+
+  if (!changed && !folded) {
+    errs() << "Not Transformed by ValueRangePass\n";
+    return PreservedAnalyses::all();
+  }
+
+  errs() << "Transformed by ValueRangePass (senza segno: " << stats.unsignedOps << ", confronti: " << stats.comparisons
+         << ", ristrette: " << stats.narrowed << ", branch: " << folded << ")\n";
+  return PreservedAnalyses::none();
+}
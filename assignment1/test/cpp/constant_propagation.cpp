@@ -0,0 +1,19 @@
+int constant_propagation_test(int x, int n){
+    int k = 16;
+    int s = 0;
+
+    for(int i = 0; i < n; i++){
+        if(k == 16)     // Sempre vero: il ramo else viene eliminato
+            s += i;
+        else
+            k = k + 1;  // Mai eseguito: k resta costante anche nel PHI del loop
+    }
+
+    int a = x * k;      // Dopo cp: x * 16 -> ottimizzabile da sr
+    int b = a / (k / 4); // Dopo cp: a / 4  -> ottimizzabile da sr
+    return s + b;
+}
+
+int main(){
+    return constant_propagation_test(3, 5);
+}
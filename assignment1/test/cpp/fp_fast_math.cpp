@@ -0,0 +1,21 @@
+// Da compilare con i fast-math flag: make clang assignment=1 test=fp_fast_math cflags=-ffast-math
+// (senza flag restano solo le trasformazioni sempre valide in IEEE-754)
+double fp_fast_math_test(double *A, double x, double y, int n){
+    double a = x * 1.0;     // Ottimizzato (sempre)
+    double b = a + 0.0;     // Ottimizzato (nsz)
+    double c = b - b;       // Ottimizzato: 0.0 (nnan, ninf)
+    double d = y / 4.0;     // y * 0.25 (reciproco esatto, sempre)
+    double e = y / 3.0;     // y * (1/3) (arcp)
+    double f = x * 2.0;     // x + x (sempre)
+
+    double s = c;
+    for(int i = 0; i < n; i++)
+        s = s + A[i] * y;   // fmuladd(A[i], y, s) (contract)
+
+    return s + d + e + f;
+}
+
+int main(){
+    double A[4] = {1.0, 2.0, 3.0, 4.0};
+    return (int)fp_fast_math_test(A, 1.5, 3.0, 4);
+}
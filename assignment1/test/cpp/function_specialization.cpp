@@ -0,0 +1,18 @@
+// Kernel generico: stride e scala arrivano come argomenti
+int scale_sum(int *A, int n, int stride, int scale){
+    int s = 0;
+    for(int i = 0; i < n; i += stride)
+        s += A[i] * scale / stride;  // Nel clone (stride = 4, scale = 16): A[i] << 4 >> 2 (sr)
+    return s;
+}
+
+int main(){
+    int A[64];
+    for(int i = 0; i < 64; i++) A[i] = i;
+
+    int a = scale_sum(A, 64, 4, 16);  // Clone con n = 64, stride = 4 e scale = 16
+    int b = scale_sum(A + 1, 63, 4, 16); // Altre costanti (n = 63): altro clone
+    int c = scale_sum(A, 64, 1, 1);   // A[i] * 1 / 1 -> A[i] (ai)
+    int d = scale_sum(A, 64, 1, 1);   // Stesse costanti di c: stesso clone
+    return a + b + c + d;
+}
@@ -0,0 +1,23 @@
+int global_value_numbering_test(int *A, int a, int b, int c){
+    int x = a + b;
+    A[x] = c;
+
+    if(c > 0){
+        int y = b + a;  // Ottimizzato (commutativa, dominata da x)
+        A[y] = y * 2;   // Ottimizzato (indice dell'array uguale ad A[x])
+    }
+    else {
+        int z = a + b;  // Ottimizzato
+        A[z + 1] = z * 2;
+    }
+
+    int w = x * 2;   // Non ottimizzato (x * 2 non è calcolato in un blocco dominatore)
+    int v = a - b;
+    int u = b - a;   // Non ottimizzato (la sottrazione non è commutativa)
+    return w + v + u;
+}
+
+int main(){
+    int A[16];
+    return global_value_numbering_test(A, 1, 2, 3);
+}
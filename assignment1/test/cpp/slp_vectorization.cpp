@@ -0,0 +1,56 @@
+// SLP vectorization (p=mem2reg,slp): codice DSP srotolato a mano, nessun loop
+// Con registri da 128 bit: gruppi di 4 int / 4 float
+
+// Store consecutivi: out[0..3] = x[0..3] * h[0..3] + x[1..4] * 3
+void fir4(int *__restrict out, const int *__restrict x, const int *__restrict h){
+    out[0] = x[0] * h[0] + x[1] * 3;
+    out[1] = x[1] * h[1] + x[2] * 3;
+    out[2] = x[2] * h[2] + x[3] * 3;
+    out[3] = x[3] * h[3] + x[4] * 3;
+}
+
+// In place: ogni load precede lo store sullo stesso elemento
+void gain(int *a){
+    a[0] = a[0] + 1;
+    a[1] = a[1] + 2;
+    a[2] = a[2] + 3;
+    a[3] = a[3] + 4;
+}
+
+// p e q possono sovrapporsi: lo store p[0] verrebbe spostato dopo il load q[1] -> non vettorizzato
+void shift(int *p, int *q){
+    p[0] = q[0] << 1;
+    p[1] = q[1] << 1;
+    p[2] = q[2] << 1;
+    p[3] = q[3] << 1;
+}
+
+// Conversione float -> int con fast-math
+void mix(int *__restrict o, const float *__restrict f, const float *__restrict g){
+    o[0] = (int)(f[0] * 2.5f + g[0]);
+    o[1] = (int)(f[1] * 2.5f + g[1]);
+    o[2] = (int)(f[2] * 2.5f + g[2]);
+    o[3] = (int)(f[3] * 2.5f + g[3]);
+}
+
+// Gruppo di operazioni isomorfe senza store: y[k] = (v*v + 7) - (v ^ 5) + v*v, risultati estratti (extractelement)
+int energy(const int *v){
+    int y0 = (v[0] * v[0] + 7) - (v[0] ^ 5) + v[0] * v[0];
+    int y1 = (v[1] * v[1] + 7) - (v[1] ^ 5) + v[1] * v[1];
+    int y2 = (v[2] * v[2] + 7) - (v[2] ^ 5) + v[2] * v[2];
+    int y3 = (v[3] * v[3] + 7) - (v[3] ^ 5) + v[3] * v[3];
+    return (y0 ^ y1) - (y2 ^ y3);
+}
+
+int main(){
+    int X[16] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    int H[4] = {3, 1, 4, 1};
+    float F[4] = {1.0f, 2.0f, 3.5f, 4.0f};
+    int O[8] = {0};
+
+    fir4(O, X, H);
+    gain(X + 2);
+    shift(X + 5, X + 2);
+    mix(O + 4, F, F);
+    return O[0] + O[3] + O[6] + X[7] + energy(X + 8);
+}
@@ -0,0 +1,26 @@
+int value_range_test(int *A, int x, unsigned char c){
+    int s = 0;
+
+    if(x >= 0){
+        s += x / 8;         // x >= 0 (condizione del branch): lshr x, 3
+        s += x % 8;         // and x, 7
+        s += A[x];          // Indice: sext x -> zext nneg x
+        if(x < -5)          // Mai vero: il confronto diventa false e il ramo viene eliminato
+            s = 0;
+    }
+
+    int k = c;              // Range [0, 255] (zext)
+    s += k / 4;             // lshr k, 2
+    if(k > 300)             // Mai vero
+        s = 1;
+    if(k < 10)              // slt -> ult
+        s -= A[k];
+
+    long long t = (long long)(x & 0xFFFF) * 4; // Risultato in [0, 2^18): mul calcolata in i32 ed estesa
+    return s + (int)(t / 3); // t >= 0: sdiv -> udiv
+}
+
+int main(){
+    int A[300];
+    return value_range_test(A, 17, 5);
+}
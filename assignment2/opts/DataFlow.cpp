@@ -0,0 +1,242 @@
+//-----------------------------------------------------------------------------
+// Data-Flow Analysis: istanze del framework e passi di stampa
+//-----------------------------------------------------------------------------
+
+#include "LocalOpts.h"
+#include "DataFlow.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+
+// ---------- Reaching Definitions ----------
+
+ReachingDefinitionsTransfer::ReachingDefinitionsTransfer(Function &F) {
+  // Dominio: istruzioni che definiscono un valore oppure scrivono in memoria (store)
+  DenseMap<const Value*, SmallVector<unsigned>> storesTo; // Store raggruppate per puntatore
+
+  for (Instruction &I : instructions(F)) {
+    if (auto *SI = dyn_cast<StoreInst>(&I))
+      storesTo[SI->getPointerOperand()].push_back(Defs.insert(&I));
+    else if (!I.getType()->isVoidTy())
+      Defs.insert(&I);
+  }
+
+  initSets(F, Defs.size());
+
+  for (BasicBlock &BB : F) {
+    BlockSets &S = getSets(BB);
+
+    for (Instruction &I : BB) {
+      int def = Defs.lookup(&I);
+      if (def < 0) continue;
+
+      // In SSA un valore non viene mai ridefinito: uccidono solo le store sullo stesso puntatore
+      // (anche quelle generate prima nello stesso blocco)
+      if (auto *SI = dyn_cast<StoreInst>(&I)) {
+        for (unsigned other : storesTo[SI->getPointerOperand()]) {
+          S.Kill.set(other);
+          S.Gen.reset(other);
+        }
+      }
+
+      S.Gen.set(def);
+    }
+  }
+}
+
+// ---------- Liveness ----------
+
+LivenessTransfer::LivenessTransfer(Function &F) {
+  // Dominio: argomenti e istruzioni che producono un valore
+  for (Argument &A : F.args())
+    Values.insert(&A);
+  for (Instruction &I : instructions(F)) {
+    if (!I.getType()->isVoidTy())
+      Values.insert(&I);
+  }
+
+  initSets(F, Values.size());
+
+  // Gen = usi "upward exposed" del blocco, Kill = definizioni del blocco
+  // NB: gli operandi dei PHINode sono vivi sull'arco entrante, non nel blocco del PHI (vedi transferEdge)
+  for (BasicBlock &BB : F) {
+    BlockSets &S = getSets(BB);
+
+    for (Instruction &I : BB) {
+      if (!isa<PHINode>(I)) {
+        for (Value *Op : I.operands()) {
+          int use = Values.lookup(Op);
+          if (use >= 0 && !S.Kill.test(use))
+            S.Gen.set(use);
+        }
+      }
+
+      int def = Values.lookup(&I);
+      if (def >= 0)
+        S.Kill.set(def);
+    }
+  }
+}
+
+// Out(From) riceve, oltre a In(To), i valori che i PHI di To prendono dall'arco From -> To
+void LivenessTransfer::transferEdge(const BasicBlock &From, const BasicBlock &To, BitVector &V) const {
+  for (const PHINode &Phi : To.phis()) {
+    int use = Values.lookup(Phi.getIncomingValueForBlock(&From));
+    if (use >= 0)
+      V.set(use);
+  }
+}
+
+// ---------- Espressioni (Available / Very Busy) ----------
+
+ExpressionKey ExpressionTransfer::getKey(const Instruction &I) {
+  unsigned opcode = I.getOpcode();
+  if (auto *Cmp = dyn_cast<CmpInst>(&I))
+    opcode = (opcode << 8) | Cmp->getPredicate(); // Il predicato distingue i confronti
+
+  const Value *LHS = I.getOperand(0);
+  const Value *RHS = I.getOperand(1);
+  if (I.isCommutative() && RHS < LHS)
+    std::swap(LHS, RHS); // a + b e b + a sono la stessa espressione
+
+  return {opcode, I.getType(), LHS, RHS};
+}
+
+int ExpressionTransfer::getExpression(const Instruction &I) const {
+  return isExpression(I) ? Exprs.lookup(getKey(I)) : -1;
+}
+
+void ExpressionTransfer::collectExpressions(Function &F) {
+  DenseMap<const Value*, SmallVector<unsigned>> exprsUsing; // Espressioni che usano un certo operando
+
+  for (Instruction &I : instructions(F)) {
+    if (!isExpression(I)) continue;
+
+    unsigned expr = Exprs.insert(getKey(I));
+    for (Value *Op : I.operands())
+      exprsUsing[Op].push_back(expr);
+  }
+
+  initSets(F, Exprs.size());
+
+  // Un'espressione è uccisa dal blocco che (ri)definisce un suo operando:
+  // in SSA succede per i PHINode nei loop, che assegnano un nuovo valore ad ogni iterazione
+  for (BasicBlock &BB : F) {
+    BlockSets &S = getSets(BB);
+    for (Instruction &I : BB) {
+      auto It = exprsUsing.find(&I);
+      if (It == exprsUsing.end()) continue;
+
+      for (unsigned expr : It->second)
+        S.Kill.set(expr);
+    }
+  }
+}
+
+AvailableExpressionsTransfer::AvailableExpressionsTransfer(Function &F) {
+  collectExpressions(F);
+
+  // Gen = espressioni calcolate nel blocco (dopo la definizione dei loro operandi)
+  for (BasicBlock &BB : F) {
+    BlockSets &S = getSets(BB);
+    for (Instruction &I : BB) {
+      int expr = getExpression(I);
+      if (expr >= 0)
+        S.Gen.set(expr);
+    }
+  }
+}
+
+VeryBusyExpressionsTransfer::VeryBusyExpressionsTransfer(Function &F) {
+  collectExpressions(F);
+
+  // Gen = espressioni calcolate nel blocco i cui operandi non sono definiti nel blocco stesso
+  // (altrimenti non possono essere anticipate all'inizio del blocco)
+  for (BasicBlock &BB : F) {
+    BlockSets &S = getSets(BB);
+    for (Instruction &I : BB) {
+      int expr = getExpression(I);
+      if (expr < 0) continue;
+
+      bool definedHere = false;
+      for (Value *Op : I.operands()) {
+        if (auto *OpInst = dyn_cast<Instruction>(Op))
+          definedHere |= (OpInst->getParent() == &BB);
+      }
+
+      if (!definedHere)
+        S.Gen.set(expr);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Passi di stampa dei risultati
+//-----------------------------------------------------------------------------
+
+void printElement(const Value *V) {
+  if (V->hasName() || !isa<Instruction>(V) || !V->getType()->isVoidTy())
+    V->printAsOperand(outs(), false);
+  else
+    outs() << "(" << *V << " )"; // Store: non hanno un nome
+}
+
+void printElement(const ExpressionKey &K) {
+  if (K.Opcode > 0xFF)
+    outs() << CmpInst::getPredicateName((CmpInst::Predicate)(K.Opcode & 0xFF));
+  else
+    outs() << Instruction::getOpcodeName(K.Opcode);
+
+  outs() << " ";
+  K.LHS->printAsOperand(outs(), false);
+  outs() << ", ";
+  K.RHS->printAsOperand(outs(), false);
+}
+
+template <typename T>
+void printSet(std::string s, const BitVector &Set, const DataFlowDomain<T> &Domain) {
+  outs() << "  " << s << ": { ";
+  for (unsigned I : Set.set_bits()) {
+    printElement(Domain[I]);
+    outs() << "; ";
+  }
+  outs() << "}\n";
+}
+
+template <typename Analysis>
+void printAnalysis(std::string name, Function &F) {
+  Analysis A(F);
+  unsigned visits = A.solve();
+
+  outs() << "=== " << name << ": " << F.getName() << " === \n";
+  outs() << "Dominio: " << A.getTransfer().getNumBits() << " elementi, "
+         << F.size() << " blocchi, " << visits << " visite\n";
+
+  for (BasicBlock &BB : F) {
+    outs() << "Blocco ";
+    BB.printAsOperand(outs(), false);
+    outs() << "\n";
+    printSet("IN ", A.getIn(BB), A.getTransfer().getDomain());
+    printSet("OUT", A.getOut(BB), A.getTransfer().getDomain());
+  }
+  outs() << "\n";
+}
+
+PreservedAnalyses ReachingDefinitionsPass::run(Function &F, FunctionAnalysisManager &) {
+  printAnalysis<ReachingDefinitions>("Reaching Definitions", F);
+  return PreservedAnalyses::all();
+}
+
+PreservedAnalyses LivenessPass::run(Function &F, FunctionAnalysisManager &) {
+  printAnalysis<Liveness>("Liveness", F);
+  return PreservedAnalyses::all();
+}
+
+PreservedAnalyses AvailableExpressionsPass::run(Function &F, FunctionAnalysisManager &) {
+  printAnalysis<AvailableExpressions>("Available Expressions", F);
+  return PreservedAnalyses::all();
+}
+
+PreservedAnalyses VeryBusyExpressionsPass::run(Function &F, FunctionAnalysisManager &) {
+  printAnalysis<VeryBusyExpressions>("Very Busy Expressions", F);
+  return PreservedAnalyses::all();
+}
@@ -0,0 +1,294 @@
+//-----------------------------------------------------------------------------
+// Framework generico per l'analisi Data-Flow (bit-vector)
+//-----------------------------------------------------------------------------
+
+/*
+  Ogni problema data-flow è definito da:
+    • Direzione:   Forward (In -> Out) oppure Backward (Out -> In)
+    • Meet:        unione (problemi "may") oppure intersezione (problemi "must")
+    • Transfer:    Out = Gen ∪ (In - Kill) per ogni blocco (o il duale per i problemi backward)
+    • Boundary:    valore all'entry (forward) o alle uscite della funzione (backward)
+
+  Lo stato di ogni blocco è un BitVector denso (un bit per elemento del dominio):
+  meet e transfer lavorano a parole di 64 bit, non su insiemi di puntatori.
+  Il solver è un worklist in reverse post-order (RPO sul CFG per i problemi forward,
+  RPO sul CFG inverso, ossia post-order, per quelli backward):
+  un blocco viene rivisitato solo se lo stato di un suo vicino è cambiato.
+*/
+
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+enum class DataFlowDirection { Forward, Backward };
+
+// ---------- Meet operator (policy) ----------
+
+// Problemi "may" (es. reaching definitions, liveness): top = insieme vuoto
+struct UnionMeet {
+  static BitVector top(unsigned N) { return BitVector(N, false); }
+  static void meet(BitVector &Acc, const BitVector &V) { Acc |= V; }
+};
+
+// Problemi "must" (es. available expressions, very busy expressions): top = insieme universo
+struct IntersectionMeet {
+  static BitVector top(unsigned N) { return BitVector(N, true); }
+  static void meet(BitVector &Acc, const BitVector &V) { Acc &= V; }
+};
+
+// ---------- Dominio dell'analisi ----------
+
+// Associa ad ogni elemento del dominio (istruzione, valore, espressione) un indice nel BitVector
+template <typename T>
+class DataFlowDomain {
+public:
+  // Ritorna l'indice dell'elemento, inserendolo se non presente
+  unsigned insert(T Elem) {
+    auto It = Index.try_emplace(Elem, Elements.size());
+    if (It.second)
+      Elements.push_back(Elem);
+    return It.first->second;
+  }
+
+  // Ritorna -1 se l'elemento non fa parte del dominio
+  int lookup(T Elem) const {
+    auto It = Index.find(Elem);
+    return It == Index.end() ? -1 : (int)It->second;
+  }
+
+  T operator[](unsigned I) const { return Elements[I]; }
+  unsigned size() const { return Elements.size(); }
+
+private:
+  DenseMap<T, unsigned> Index;
+  SmallVector<T> Elements;
+};
+
+// ---------- Transfer function (policy) ----------
+
+/*
+  Transfer Gen/Kill: i BitVector di gen e kill sono calcolati una sola volta per blocco,
+  quindi ogni applicazione della transfer costa O(N/64) (operazioni word-wise).
+  Le istanze concrete riempiono Gen e Kill nel costruttore e, se serve,
+  ridefiniscono transferEdge per aggiungere informazione dipendente dall'arco (es. PHINode).
+*/
+class GenKillTransfer {
+public:
+  unsigned getNumBits() const { return NumBits; }
+
+  // Out = Gen ∪ (In - Kill)
+  void transfer(const BasicBlock &BB, const BitVector &In, BitVector &Out) const {
+    const BlockSets &S = Sets.find(&BB)->second;
+    Out = In;
+    Out.reset(S.Kill);
+    Out |= S.Gen;
+  }
+
+  // Informazione che attraversa l'arco From -> To (di default nessuna modifica)
+  void transferEdge(const BasicBlock &/*From*/, const BasicBlock &/*To*/, BitVector &/*V*/) const {}
+
+  const BitVector &getGen(const BasicBlock &BB) const { return Sets.find(&BB)->second.Gen; }
+  const BitVector &getKill(const BasicBlock &BB) const { return Sets.find(&BB)->second.Kill; }
+
+protected:
+  struct BlockSets {
+    BitVector Gen;
+    BitVector Kill;
+  };
+
+  // Da chiamare una volta nota la dimensione del dominio
+  void initSets(Function &F, unsigned N) {
+    NumBits = N;
+    for (BasicBlock &BB : F)
+      Sets[&BB] = {BitVector(N, false), BitVector(N, false)};
+  }
+
+  BlockSets &getSets(const BasicBlock &BB) { return Sets[&BB]; }
+
+  unsigned NumBits = 0;
+  DenseMap<const BasicBlock*, BlockSets> Sets;
+};
+
+// ---------- Solver ----------
+
+template <DataFlowDirection Dir, typename Meet, typename Transfer>
+class DataFlowAnalysis {
+public:
+  explicit DataFlowAnalysis(Function &F) : F(F), T(F) {}
+
+  // Risolve il problema con un worklist in RPO, ritorna il numero di blocchi visitati
+  unsigned solve() {
+    const unsigned N = T.getNumBits();
+    const bool Forward = (Dir == DataFlowDirection::Forward);
+
+    // Ordine di visita: RPO per i problemi forward, post-order (RPO del CFG inverso) per quelli backward
+    Order.clear();
+    Position.clear();
+    if (Forward) {
+      ReversePostOrderTraversal<Function*> RPOT(&F);
+      for (BasicBlock *BB : RPOT) Order.push_back(BB);
+    } else {
+      for (BasicBlock *BB : post_order(&F)) Order.push_back(BB);
+    }
+    for (unsigned I = 0; I < Order.size(); I++)
+      Position[Order[I]] = I;
+
+    // Inizializzazione: tutti i blocchi (anche quelli non raggiungibili) partono dal top del meet
+    In.assign(F.size(), Meet::top(N));
+    Out.assign(F.size(), Meet::top(N));
+    unsigned Idx = 0;
+    for (BasicBlock &BB : F)
+      Slot[&BB] = Idx++;
+
+    BitVector Pending(Order.size(), true);
+    BitVector Boundary(N, false);
+    BitVector Tmp(N);
+    unsigned Visits = 0;
+
+    int Cur = Pending.find_first();
+    while (Cur != -1) {
+      Pending.reset(Cur);
+      BasicBlock *BB = Order[Cur];
+      Visits++;
+
+      // Meet sui vicini (predecessori se forward, successori se backward)
+      BitVector Acc = Meet::top(N);
+      bool HasNeighbour = false;
+      auto MeetWith = [&](BasicBlock *Other, bool OtherIsSource) {
+        Tmp = Forward ? Out[Slot[Other]] : In[Slot[Other]];
+        if (OtherIsSource) T.transferEdge(*Other, *BB, Tmp);
+        else               T.transferEdge(*BB, *Other, Tmp);
+        Meet::meet(Acc, Tmp);
+        HasNeighbour = true;
+      };
+
+      if (Forward) for (BasicBlock *P : predecessors(BB)) MeetWith(P, true);
+      else         for (BasicBlock *S : successors(BB))   MeetWith(S, false);
+
+      // Entry (forward) o uscita della funzione (backward): si usa il valore di boundary
+      if (!HasNeighbour) Acc = Boundary;
+
+      BitVector &Inp = Forward ? In[Slot[BB]] : Out[Slot[BB]];
+      BitVector &Res = Forward ? Out[Slot[BB]] : In[Slot[BB]];
+      Inp = Acc;
+      T.transfer(*BB, Inp, Tmp);
+
+      // Se il risultato è cambiato, i vicini "a valle" vanno rivisitati
+      if (Tmp != Res) {
+        Res = Tmp;
+        auto Enqueue = [&](BasicBlock *Next) {
+          auto It = Position.find(Next);
+          if (It != Position.end()) Pending.set(It->second);
+        };
+        if (Forward) for (BasicBlock *S : successors(BB))   Enqueue(S);
+        else         for (BasicBlock *P : predecessors(BB)) Enqueue(P);
+      }
+
+      // Prosegue in ordine, ricominciando dall'inizio quando arriva in fondo
+      Cur = Pending.find_next(Cur);
+      if (Cur == -1) Cur = Pending.find_first();
+    }
+
+    return Visits;
+  }
+
+  const BitVector &getIn(const BasicBlock &BB) const { return In[Slot.find(&BB)->second]; }
+  const BitVector &getOut(const BasicBlock &BB) const { return Out[Slot.find(&BB)->second]; }
+  const Transfer &getTransfer() const { return T; }
+
+private:
+  Function &F;
+  Transfer T;
+  SmallVector<BasicBlock*> Order;
+  DenseMap<const BasicBlock*, unsigned> Position; // Posizione nell'ordine di visita
+  DenseMap<const BasicBlock*, unsigned> Slot;     // Indice dello stato del blocco
+  std::vector<BitVector> In, Out;
+};
+
+// ---------- Istanze ----------
+
+// Reaching definitions: definizioni SSA (sempre raggiungenti) e store, uccise da store sullo stesso puntatore
+class ReachingDefinitionsTransfer : public GenKillTransfer {
+public:
+  explicit ReachingDefinitionsTransfer(Function &F);
+  const DataFlowDomain<const Instruction*> &getDomain() const { return Defs; }
+
+private:
+  DataFlowDomain<const Instruction*> Defs;
+};
+
+// Liveness: valori SSA (istruzioni e argomenti) vivi, i PHINode usano il valore sull'arco entrante
+class LivenessTransfer : public GenKillTransfer {
+public:
+  explicit LivenessTransfer(Function &F);
+  void transferEdge(const BasicBlock &From, const BasicBlock &To, BitVector &V) const;
+  const DataFlowDomain<const Value*> &getDomain() const { return Values; }
+
+private:
+  DataFlowDomain<const Value*> Values;
+};
+
+// Chiave di un'espressione: opcode (con predicato per i confronti), tipo e operandi
+struct ExpressionKey {
+  unsigned Opcode;
+  Type *Ty;
+  const Value *LHS;
+  const Value *RHS;
+  bool operator==(const ExpressionKey &O) const {
+    return Opcode == O.Opcode && Ty == O.Ty && LHS == O.LHS && RHS == O.RHS;
+  }
+};
+
+namespace llvm {
+template <> struct DenseMapInfo<ExpressionKey> {
+  static ExpressionKey getEmptyKey() { return {~0U, nullptr, nullptr, nullptr}; }
+  static ExpressionKey getTombstoneKey() { return {~0U - 1, nullptr, nullptr, nullptr}; }
+  static unsigned getHashValue(const ExpressionKey &K) { return hash_combine(K.Opcode, K.Ty, K.LHS, K.RHS); }
+  static bool isEqual(const ExpressionKey &A, const ExpressionKey &B) { return A == B; }
+};
+}
+
+// Espressioni considerate: operazioni binarie e confronti
+class ExpressionTransfer : public GenKillTransfer {
+public:
+  const DataFlowDomain<ExpressionKey> &getDomain() const { return Exprs; }
+  int getExpression(const Instruction &I) const;
+  static bool isExpression(const Instruction &I) { return I.isBinaryOp() || isa<CmpInst>(I); }
+
+protected:
+  // Costruisce il dominio e il Kill (espressioni con un operando definito nel blocco), comune ai due problemi
+  void collectExpressions(Function &F);
+  static ExpressionKey getKey(const Instruction &I);
+
+  DataFlowDomain<ExpressionKey> Exprs;
+};
+
+// Available expressions: espressioni calcolate su ogni cammino che raggiunge il punto
+class AvailableExpressionsTransfer : public ExpressionTransfer {
+public:
+  explicit AvailableExpressionsTransfer(Function &F);
+};
+
+// Very busy expressions: espressioni calcolate su ogni cammino che parte dal punto,
+// prima che un loro operando venga ridefinito
+class VeryBusyExpressionsTransfer : public ExpressionTransfer {
+public:
+  explicit VeryBusyExpressionsTransfer(Function &F);
+};
+
+using ReachingDefinitions  = DataFlowAnalysis<DataFlowDirection::Forward,  UnionMeet,        ReachingDefinitionsTransfer>;
+using Liveness             = DataFlowAnalysis<DataFlowDirection::Backward, UnionMeet,        LivenessTransfer>;
+using AvailableExpressions = DataFlowAnalysis<DataFlowDirection::Forward,  IntersectionMeet, AvailableExpressionsTransfer>;
+using VeryBusyExpressions  = DataFlowAnalysis<DataFlowDirection::Backward, IntersectionMeet, VeryBusyExpressionsTransfer>;
+
+#endif
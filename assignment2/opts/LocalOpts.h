@@ -0,0 +1,30 @@
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+// Reaching Definitions
+struct ReachingDefinitionsPass : PassInfoMixin<ReachingDefinitionsPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Liveness
+struct LivenessPass : PassInfoMixin<LivenessPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Available Expressions
+struct AvailableExpressionsPass : PassInfoMixin<AvailableExpressionsPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Very Busy Expressions
+struct VeryBusyExpressionsPass : PassInfoMixin<VeryBusyExpressionsPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
@@ -0,0 +1,24 @@
+// Test per le analisi data-flow (rd, lv, ae, vb)
+int dataflow_test(int a, int b, int n, int *p){
+    int x = a + b;  // available all'ingresso del loop, very busy all'entry
+    *p = x;         // reaching definition uccisa dalla store nel loop
+    int s = 0;
+
+    for(int i = 0; i < n; i++){
+        int y = b + a;  // stessa espressione di x (commutativa)
+        s += i * y;     // i è un PHINode: uccide le espressioni che lo usano
+        *p = s;
+    }
+
+    if(n > 10)
+        s = s - x;  // x è viva fino a qui
+    else
+        s = s - x;  // s - x è very busy prima dell'if (calcolata su entrambi i rami)
+
+    return s;
+}
+
+int main(){
+    int v;
+    return dataflow_test(1, 2, 5, &v);
+}
@@ -19,12 +19,22 @@ ALGORITMO:
     • Le istruzioni candidate alla code motion:
       • Sono loop invariant
       • Si trovano in blocchi che dominano tutte le uscite del loop OPPURE la variabile definita dall’istruzione è dead all’uscita del loop
+        (in questo caso l'istruzione può non essere eseguita dal loop: si sposta solo se speculabile, isSafeToSpeculativelyExecute)
       • Assegnano un valore a variabili non assegnate altrove nel loop
       • Si trovano in blocchi che dominano tutti i blocchi nel loop che usano la variabile a cui si sta assegnando un valore
       • Eseguire una ricerca depth-first dei blocchi
       • Spostare l’istruzione candidata nel preheader se tutte le istruzioni invarianti da cui questa dipende sono state spostate
   
   • SPOSTIAMO LE ISTRUZIONI
+
+  • PROFILO (BlockFrequencyInfo, ProfileSummaryInfo con profili instrumentation o sample):
+    • I loop vengono visitati dal più caldo (frequenza dell'header) e consumano un budget di istruzioni spostate
+      (ogni istruzione spostata allunga un live range nel preheader): i loop caldi lo usano per primi
+    • I loop freddi per il profilo (PSI) non vengono trasformati
+    • Un'istruzione non viene spostata se il suo blocco è più freddo del preheader: es. un loop che sul percorso
+      caldo esegue zero iterazioni, il preheader la eseguirebbe ogni volta, il corpo quasi mai
+    Senza profilo (PSI senza summary) le frequenze sarebbero solo stimate staticamente (BranchProbabilityInfo):
+    i loop vengono comunque visitati in quell'ordine, ma budget e controllo dei blocchi freddi non si applicano
   
 */
 
@@ -33,9 +43,70 @@ ALGORITMO:
 #include <llvm/Analysis/LoopInfo.h>
 #include "llvm/IR/Dominators.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include <optional>
+
+// Parametri di li<...>, separati da ';' (es. li<budget=16>)
+Expected<LICMOptions> parseLICMOptions(StringRef Params) {
+  LICMOptions Opts;
+  while (!Params.empty()) {
+    StringRef Param;
+    std::tie(Param, Params) = Params.split(';');
+    if (Param.consume_front("budget=")) {
+      if (Param.getAsInteger(0, Opts.HoistBudget))
+        return createStringError(inconvertibleErrorCode(), "li: budget non valido '" + Param + "'");
+    } else {
+      return createStringError(inconvertibleErrorCode(), "li: parametro sconosciuto '" + Param + "'");
+    }
+  }
+  return Opts;
+}
+
+// Chiamate: il preheader le esegue anche quando il loop non lo farebbe, quindi devono terminare (willreturn) senza
+// eccezioni. Effetti sulla memoria (MemoryEffects, dagli attributi della chiamata e della funzione chiamata):
+//   • nessun accesso (readnone, es. sqrt con -fno-math-errno): invariante come un'operazione aritmetica
+//   • sola lettura (readonly, es. strlen): invariante se la scrittura più vicina che può modificare la memoria letta
+//     (clobber di MemorySSA) è fuori dal loop
+//   • scrittura: resta nel loop
+// NB: le dichiarazioni delle funzioni di libreria hanno questi attributi solo dopo inferattrs (es. p='inferattrs,function(li)')
+bool isCallInvariant(AAResults &AA, MemorySSA &MSSA, Loop &L, CallBase &Call) {
+  if (!Call.willReturn() || Call.mayThrow() || Call.isConvergent() || Call.isInlineAsm() || Call.hasOperandBundles())
+    return false;
+
+  MemoryEffects ME = AA.getMemoryEffects(&Call);
+  if (ME.doesNotAccessMemory()) return true;
+  if (!ME.onlyReadsMemory()) return false;
+
+  MemoryAccess *Clobber = MSSA.getWalker()->getClobberingMemoryAccess(&Call);
+  return MSSA.isLiveOnEntryDef(Clobber) || !L.contains(Clobber->getBlock());
+}
+
+// Istruzioni che accedono alla memoria: un load è invariante se nessuna istruzione del loop può scrivere la locazione letta
+// (AA: basi diverse, oppure i metadati no-alias del clone creato dal loop versioning "lvr"), gli store restano nel loop
+bool isMemoryInvariant(AAResults &AA, MemorySSA &MSSA, Loop &L, Instruction &Inst) {
+  if (auto *Call = dyn_cast<CallBase>(&Inst)) return isCallInvariant(AA, MSSA, L, *Call);
+  if (!Inst.mayReadOrWriteMemory()) return true;
+
+  auto *Load = dyn_cast<LoadInst>(&Inst);
+  if (!Load || !Load->isSimple()) return false;
+
+  MemoryLocation Loc = MemoryLocation::get(Load);
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (I.mayWriteToMemory() && isModSet(AA.getModRefInfo(&I, Loc))) return false;
+    }
+  }
+  return true;
+}
 
 // Funzione per controllare se un'istruzione è loop invariant 
-bool isLoopInvariant(SetVector<Instruction*> invariants, Loop &L, Instruction &Inst) {
+bool isLoopInvariant(SetVector<Instruction*> invariants, Loop &L, Instruction &Inst, AAResults &AA, MemorySSA &MSSA) {
+  if (!isMemoryInvariant(AA, MSSA, L, Inst)) return false;
+
   for (Value* op : Inst.operands()) { 
     // Sono loop invariant gli operandi costanti o argomenti di funzione
     if (isa<Constant>(op) || isa<Argument>(op)) continue;
@@ -61,7 +132,7 @@ bool isMovable(DominatorTree &DT, Loop &L, Instruction &I) {
   outs() << " - Istruzione: " << I << " -> ";
 
   // ---------- Controllo "Dominanza delle uscite" ---------- 
-  bool domExit;
+  bool domExit = true;
   for (BasicBlock* block : exitBB){ 
     domExit = DT.dominates(I.getParent(), block); // getParent() restituisce il blocco dell'istruzione
     
@@ -78,6 +149,15 @@ bool isMovable(DominatorTree &DT, Loop &L, Instruction &I) {
       Se non domina tutte le uscite del loop ED è alive */
 
   if (!domExit){
+    // Un'istruzione che il loop può non eseguire si sposta solo se eseguirla nel preheader è sempre sicuro:
+    // load da puntatori dereferenziabili lì (non if (p) s += *p), divisioni per costanti diverse da 0
+    // (non if (d) x = a / d), chiamate speculatable (willreturn e nounwind non escludono comportamenti indefiniti
+    // sugli argomenti, es. strlen(nullptr) in un ramo che lo esclude)
+    if (!isSafeToSpeculativelyExecute(&I, L.getLoopPreheader()->getTerminator(), nullptr, &DT)) {
+      outs() << "not guaranteed to execute, not safe to speculate\n";
+      return false;
+    }
+
     for(Use &U : I.uses()){
       if (Instruction* user = dyn_cast<Instruction>(U.getUser())){ 
         // Se ogni uso è al di fuori del loop, l'istruzione è alive (altrimenti è morta)
@@ -101,7 +181,8 @@ bool isMovable(DominatorTree &DT, Loop &L, Instruction &I) {
 
     // "Si trovano in blocchi che dominano tutti i blocchi nel loop che usano la variabile a cui si sta assegnando un valore"
     // Per fare la code motion, il blocco dell'istruzione deve dominare ogni suo uso
-    if(!DT.dominates(I.getParent(), U)){
+    // NB: dominates(BasicBlock, Use) considera la fine del blocco, quindi gli usi nello stesso blocco non sarebbero dominati
+    if(!DT.dominates(&I, U)){
       outs() << "don't dominate all uses \n";
       return false; // Se trovo un uso non dominato dal blocco dell'istruzione, non posso fare la code motion
     }
@@ -130,9 +211,34 @@ bool hasDependencies(SetVector<Instruction*> moved, Loop &L, Instruction &I) {
 PreservedAnalyses LoopInvariantCodeMotionPass::run(Function &F, FunctionAnalysisManager &AM) {
   LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
   DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  AAResults &AA = AM.getResult<AAManager>(F);
+  MemorySSA &MSSA = AM.getResult<MemorySSAAnalysis>(F).getMSSA();
+  BlockFrequencyInfo &BFI = AM.getResult<BlockFrequencyAnalysis>(F);
+
+  // PSI è un'analisi di modulo: se nessuno l'ha calcolata (es. require<profile-summary>) la si legge dal modulo
+  std::optional<ProfileSummaryInfo> localPSI;
+  ProfileSummaryInfo *PSI = AM.getResult<ModuleAnalysisManagerFunctionProxy>(F).getCachedResult<ProfileSummaryAnalysis>(*F.getParent());
+  if (!PSI) PSI = &localPSI.emplace(*F.getParent());
+  bool hasProfile = PSI->hasProfileSummary();
+
+  // Loop esterni dal più caldo
+  SmallVector<Loop*> loops(LI.begin(), LI.end());
+  stable_sort(loops, [&](Loop *A, Loop *B) { return BFI.getBlockFreq(A->getHeader()) > BFI.getBlockFreq(B->getHeader()); });
+  unsigned budget = Opts.HoistBudget;
+  bool changed = false;
 
   // Cicla sui loop (solo quelli esterni)
-  for (Loop *L : LI) {   
+  for (Loop *L : loops) {   
+    BasicBlock *preheader = L->getLoopPreheader();
+    if (!preheader) continue; // Nessun posto in cui spostare le istruzioni (serve loop-simplify)
+
+    if (hasProfile && PSI->isColdBlock(L->getHeader(), &BFI)) {
+      outs() << "Loop ";
+      L->getHeader()->printAsOperand(outs(), false);
+      outs() << ": freddo per il profilo, non trasformato\n";
+      continue;
+    }
+
     SetVector<Instruction*> invariants;       // Istruzioni loop invariant
     SetVector<Instruction*> movable;          // Istruzioni candidate alla code motion
     SetVector<Instruction*> moved;            // Istruzioni spostate
@@ -147,7 +253,7 @@ PreservedAnalyses LoopInvariantCodeMotionPass::run(Function &F, FunctionAnalysis
 
       // Aggiorno il vettore delle istruzioni loop invariant
       for (Instruction &I : *BB){ 
-        if (isLoopInvariant(invariants, *L, I))
+        if (isLoopInvariant(invariants, *L, I, AA, MSSA))
           invariants.insert(&I); // Se l'istruzione è loop invariant, la inserisco nell'insieme
       }
     }
@@ -169,8 +275,20 @@ PreservedAnalyses LoopInvariantCodeMotionPass::run(Function &F, FunctionAnalysis
 
     // Per ogni istruzione movable, se non ha dipendenze non moved allora faccio la code motion
     for (Instruction *I : movable) {
+      // Il blocco dell'istruzione è eseguito meno spesso del preheader: spostarla allungherebbe il percorso caldo
+      if (hasProfile && BFI.getBlockFreq(I->getParent()) < BFI.getBlockFreq(preheader)) {
+        outs() << "  blocco più freddo del preheader, non spostata: " << *I << "\n";
+        continue;
+      }
+      if (hasProfile && !budget) {
+        outs() << "  budget esaurito, non spostata: " << *I << "\n";
+        continue;
+      }
+
       if (!hasDependencies(moved, *L, *I)){
-        I->moveBefore(L->getLoopPreheader()->getTerminator());  // Sposta l'istruzione alla fine del preheader (ma prima del branch)
+        I->moveBefore(preheader->getTerminator());              // Sposta l'istruzione alla fine del preheader (ma prima del branch)
+        if (hasProfile) budget--;
+        changed = true;
         moved.insert(I);                                        // Aggiungo l'istruzione spostata al vettore
       }
     } 
@@ -184,5 +302,9 @@ PreservedAnalyses LoopInvariantCodeMotionPass::run(Function &F, FunctionAnalysis
     //F.print(outs()); // Stampa la funzione aggiornata
   }
 
-  return PreservedAnalyses::all();
+  // Le istruzioni spostate invalidano MemorySSA (gli accessi hanno cambiato blocco), il CFG non cambia
+  if (!changed) return PreservedAnalyses::all();
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  return PA;
 }
@@ -1,8 +1,26 @@
 #include "LocalOpts.h"
 
 bool add_passes(StringRef Name, FunctionPassManager &FPM){
-  if (Name == "li") {
-    FPM.addPass(LoopInvariantCodeMotionPass());
+  if (PassBuilder::checkParametrizedPassName(Name, "li")) {
+    Expected<LICMOptions> Opts = PassBuilder::parsePassParameters(parseLICMOptions, Name, "li");
+    if (!Opts) {
+      errs() << toString(Opts.takeError()) << "\n";
+      return false;
+    }
+    FPM.addPass(LoopInvariantCodeMotionPass(*Opts));
+    return true;
+  }
+  if (PassBuilder::checkParametrizedPassName(Name, "lu")) {
+    Expected<LoopUnswitchingOptions> Opts = PassBuilder::parsePassParameters(parseLoopUnswitchingOptions, Name, "lu");
+    if (!Opts) {
+      errs() << toString(Opts.takeError()) << "\n";
+      return false;
+    }
+    FPM.addPass(LoopUnswitchingPass(*Opts));
+    return true;
+  }
+  if (Name == "lsr") {
+    FPM.addPass(LoopStrengthReductionPass());
     return true;
   }
 
@@ -5,8 +5,34 @@
 
 using namespace llvm;
 
-// LICM
+// LICM (li<budget=N>)
+struct LICMOptions {
+  unsigned HoistBudget = 64; // Istruzioni spostate per funzione, ai loop più caldi per primi (solo con profilo)
+};
+Expected<LICMOptions> parseLICMOptions(StringRef Params); // LICM.cpp
+
 struct LoopInvariantCodeMotionPass : PassInfoMixin<LoopInvariantCodeMotionPass> {
+  LoopInvariantCodeMotionPass(LICMOptions Opts = {}) : Opts(Opts) {}
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+  LICMOptions Opts;
+};
+
+// Loop Unswitching (lu<budget=N>)
+struct LoopUnswitchingOptions {
+  unsigned Budget = 256; // Istruzioni clonate per funzione (gli unswitch banali non clonano)
+};
+Expected<LoopUnswitchingOptions> parseLoopUnswitchingOptions(StringRef Params); // LoopUnswitching.cpp
+
+struct LoopUnswitchingPass : PassInfoMixin<LoopUnswitchingPass> {
+  LoopUnswitchingPass(LoopUnswitchingOptions Opts = {}) : Opts(Opts) {}
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+  LoopUnswitchingOptions Opts;
+};
+
+// Loop Strength Reduction
+struct LoopStrengthReductionPass : PassInfoMixin<LoopStrengthReductionPass> {
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
   static bool isRequired() { return true; }
 };
@@ -0,0 +1,237 @@
+//-----------------------------------------------------------------------------
+// Loop Strength Reduction implementation
+//-----------------------------------------------------------------------------
+
+/*
+ALGORITMO:
+  • Per ogni loop (dal più interno) si cercano le istruzioni "costose" calcolate ad ogni iterazione
+    a partire dall'induction variable: mul, shl e GEP con indici non costanti (A[i] = A + i * sizeof)
+  • ScalarEvolution le descrive come SCEVAddRecExpr affini {start,+,step}<L>, con start e step
+    loop invariant: il valore all'iterazione k è start + k * step
+  • Le GEP vengono separate in base (puntatore invariante) + offset intero {start,+,step},
+    così A[i], B[i], C[i] condividono lo stesso offset
+  • MERGE DELLE IV: i candidati con lo stesso tipo e lo stesso step vengono raggruppati,
+    e per ogni gruppo si sceglie una sola IV di base:
+    • Una IV già presente nell'header (costo 0), oppure una nuova IV con lo start di uno dei candidati
+      (costo: un add per iterazione)
+    • Gli altri candidati diventano "IV + (start_k - start_base)", con la differenza calcolata nel preheader
+      (costo: un add per iterazione se la differenza non è 0)
+    • Si sceglie la base di costo minimo e si trasforma il gruppo solo se non costa più delle istruzioni
+      che diventano morte (i candidati e gli operandi usati solo da loro, es. sext + mul)
+    I costi sono quelli del target (TargetTransformInfo, latenza)
+  • La nuova IV è un PHINode nell'header: [start, preheader], [IV + step, latch]
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+// Espressione da ridurre: Base + {Start,+,Step}<L> (Base == nullptr per gli interi)
+struct ReductionCandidate {
+  Instruction *I;
+  Value *Base;
+  const SCEV *Start;
+};
+
+// IV di base di un gruppo: esistente (Phi != nullptr) oppure da creare con lo start di un candidato
+struct BaseIV {
+  PHINode *Phi;
+  const SCEV *Start;
+};
+
+// Costo (per iterazione) delle istruzioni che diventano morte sostituendo i candidati:
+// i candidati e gli operandi nel loop usati solo da istruzioni morte (es. la sext condivisa da A[i] e B[i])
+InstructionCost getDeadCost(TargetTransformInfo &TTI, Loop &L, ArrayRef<ReductionCandidate> Group) {
+  SmallPtrSet<Instruction*, 16> dead;
+  SmallVector<Instruction*, 16> worklist;
+  for (const ReductionCandidate &C : Group) {
+    if (dead.insert(C.I).second) worklist.push_back(C.I);
+  }
+
+  InstructionCost Cost = 0;
+  while (!worklist.empty()) {
+    Instruction *I = worklist.pop_back_val();
+    Cost += TTI.getInstructionCost(I, TargetTransformInfo::TCK_Latency);
+
+    for (Value *Op : I->operands()) {
+      auto *OpI = dyn_cast<Instruction>(Op);
+      if (!OpI || !L.contains(OpI) || isa<PHINode>(OpI) || dead.count(OpI)) continue;
+      if (all_of(OpI->users(), [&](User *U) { return dead.count(cast<Instruction>(U)); })) {
+        dead.insert(OpI);
+        worklist.push_back(OpI);
+      }
+    }
+  }
+  return Cost;
+}
+
+// Istruzioni che calcolano una moltiplicazione (esplicita o implicita nell'indirizzo)
+bool isExpensive(Instruction &I) {
+  if (I.getOpcode() == Instruction::Mul || I.getOpcode() == Instruction::Shl) return true;
+  if (auto *GEP = dyn_cast<GetElementPtrInst>(&I)) return !GEP->hasAllConstantIndices();
+  return false;
+}
+
+// Espressione affine del loop L: {start,+,step}<L> con start e step invarianti
+const SCEVAddRecExpr *getAffineRec(ScalarEvolution &SE, Loop &L, const SCEV *S) {
+  auto *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (!AR || AR->getLoop() != &L || !AR->isAffine()) return nullptr;
+  if (!SE.isLoopInvariant(AR->getStart(), &L) || !SE.isLoopInvariant(AR->getStepRecurrence(SE), &L)) return nullptr;
+  return AR;
+}
+
+bool runOnLoopLSR(Loop &L, ScalarEvolution &SE, TargetTransformInfo &TTI, const DataLayout &DL) {
+  if (!L.isLoopSimplifyForm()) return false;
+
+  BasicBlock *Header = L.getHeader();
+  BasicBlock *Preheader = L.getLoopPreheader();
+  BasicBlock *Latch = L.getLoopLatch();
+  SCEVExpander Expander(SE, DL, "lsr");
+
+  // Candidati raggruppati per (tipo dell'offset, step)
+  MapVector<std::pair<Type*, const SCEV*>, SmallVector<ReductionCandidate, 4>> groups;
+  SmallPtrSet<Instruction*, 16> candidates;
+
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (!isExpensive(I) || !SE.isSCEVable(I.getType())) continue;
+
+      const SCEV *S = SE.getSCEV(&I);
+      Value *Base = nullptr;
+      if (I.getType()->isPointerTy()) {
+        // Base + offset: la base deve essere un puntatore invariante (argomento, globale, ...)
+        auto *BaseS = dyn_cast<SCEVUnknown>(SE.getPointerBase(S));
+        if (!BaseS || !SE.isLoopInvariant(BaseS, &L)) continue;
+        Base = BaseS->getValue();
+        S = SE.getMinusSCEV(S, BaseS);
+      }
+
+      const SCEVAddRecExpr *AR = getAffineRec(SE, L, S);
+      if (!AR || !Expander.isSafeToExpand(AR->getStart()) || !Expander.isSafeToExpand(AR->getStepRecurrence(SE)))
+        continue;
+
+      groups[{AR->getType(), AR->getStepRecurrence(SE)}].push_back({&I, Base, AR->getStart()});
+      candidates.insert(&I);
+    }
+  }
+
+  // Un candidato usato solo da altri candidati muore insieme a loro (es. la mul nell'indice di una GEP)
+  for (auto &[key, group] : groups) {
+    erase_if(group, [&](ReductionCandidate &C) {
+      return !C.I->use_empty() && all_of(C.I->users(), [&](User *U) { return candidates.count(cast<Instruction>(U)); });
+    });
+  }
+
+  bool changed = false;
+  SmallVector<WeakTrackingVH, 16> dead;
+
+  for (auto &[key, group] : groups) {
+    if (group.empty()) continue;
+    auto [Ty, Step] = key;
+    InstructionCost AddCost = TTI.getArithmeticInstrCost(Instruction::Add, Ty, TargetTransformInfo::TCK_Latency);
+
+    // IV possibili: quelle già presenti nell'header e una nuova per ogni start dei candidati
+    SmallVector<BaseIV, 8> options;
+    for (PHINode &Phi : Header->phis()) {
+      if (Phi.getType() != Ty || !SE.isSCEVable(Ty)) continue;
+      const SCEVAddRecExpr *AR = getAffineRec(SE, L, SE.getSCEV(&Phi));
+      if (AR && AR->getStepRecurrence(SE) == Step) options.push_back({&Phi, AR->getStart()});
+    }
+    for (ReductionCandidate &C : group) options.push_back({nullptr, C.Start});
+
+    InstructionCost Saved = getDeadCost(TTI, L, group);
+
+    BaseIV *Best = nullptr;
+    InstructionCost BestCost;
+    for (BaseIV &Option : options) {
+      InstructionCost Cost = Option.Phi ? 0 : AddCost;
+      for (ReductionCandidate &C : group) {
+        if (C.Start != Option.Start) Cost += AddCost;
+      }
+      if (!Best || Cost < BestCost) {
+        Best = &Option;
+        BestCost = Cost;
+      }
+    }
+
+    outs() << "Loop " << Header->getName() << ": " << group.size() << " espressioni con step " << *Step
+           << " (costo " << Saved << " -> " << BestCost << ")";
+    // A parità di costo si trasforma comunque: un add al posto di una mul non è mai più lento
+    if (Saved == 0 || Saved < BestCost) {
+      outs() << " non conveniente\n";
+      continue;
+    }
+
+    // IV di base
+    Instruction *Term = Preheader->getTerminator();
+    PHINode *IV = Best->Phi;
+    if (!IV) {
+      Value *StartV = Expander.expandCodeFor(Best->Start, Ty, Term);
+      Value *StepV = Expander.expandCodeFor(Step, Ty, Term);
+
+      IRBuilder<> Builder(&Header->front());
+      IV = Builder.CreatePHI(Ty, 2, "lsr.iv");
+      Builder.SetInsertPoint(Latch->getTerminator());
+      Value *Next = Builder.CreateAdd(IV, StepV, "lsr.iv.next");
+      IV->addIncoming(StartV, Preheader);
+      IV->addIncoming(Next, Latch);
+      outs() << ", nuova IV " << *IV << "\n";
+    } else {
+      outs() << ", riuso della IV " << *IV << "\n";
+    }
+
+    // Ogni candidato diventa IV (+ differenza degli start) (+ base)
+    for (ReductionCandidate &C : group) {
+      IRBuilder<> Builder(C.I);
+      Value *Offset = IV;
+      if (C.Start != Best->Start) {
+        Value *Delta = Expander.expandCodeFor(SE.getMinusSCEV(C.Start, Best->Start), Ty, Term);
+        Offset = Builder.CreateAdd(IV, Delta, "lsr.off");
+      }
+
+      Value *New = Offset;
+      if (C.Base) New = Builder.CreateGEP(Builder.getInt8Ty(), C.Base, Offset, "lsr.addr");
+      else if (New->getType() != C.I->getType()) New = Builder.CreateTruncOrBitCast(New, C.I->getType());
+
+      outs() << "  - " << *C.I << " -> " << *New << "\n";
+      C.I->replaceAllUsesWith(New);
+      dead.push_back(C.I);
+    }
+    changed = true;
+  }
+
+  // Eliminazione dei candidati sostituiti e delle catene di operandi rimaste senza usi
+  RecursivelyDeleteTriviallyDeadInstructionsPermissive(dead);
+  return changed;
+}
+
+PreservedAnalyses LoopStrengthReductionPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  TargetTransformInfo &TTI = AM.getResult<TargetIRAnalysis>(F);
+
+  bool changed = false;
+
+  // Dal loop più interno: le espressioni dei loop interni non dipendono dalle IV aggiunte a quelli esterni
+  SmallVector<Loop*> loops = LI.getLoopsInPreorder();
+  for (Loop *L : reverse(loops)) {
+    if (runOnLoopLSR(*L, SE, TTI, F.getParent()->getDataLayout())) {
+      SE.forgetLoop(L->getOutermostLoop());
+      changed = true;
+    }
+  }
+
+  if (!changed) return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>(); // Vengono aggiunte solo istruzioni, i blocchi non cambiano
+  return PA;
+}
@@ -0,0 +1,303 @@
+//-----------------------------------------------------------------------------
+// Loop Unswitching implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Un branch con condizione loop invariant (es. if (mode == 2) nel corpo) viene valutato ad ogni iterazione e divide
+  il corpo in più blocchi: LoopFusion e il vettorizzatore vedono un loop con control flow e rinunciano.
+  Il passo "lu" sposta la decisione prima del loop, con una versione del loop per ogni esito.
+
+ALGORITMO:
+  • Candidati: branch condizionali dei blocchi del loop (non dei sottoloop) con condizione non costante e loop
+    invariant; le istruzioni del loop da cui dipende la condizione vengono spostate nel preheader se possibile
+    (Loop::makeLoopInvariant: niente accessi alla memoria né istruzioni che possono fallire, es. divisioni)
+  • UNSWITCH BANALE (nessun costo): un successore esce dal loop e il branch viene raggiunto ad ogni iterazione
+    dall'header, lungo blocchi con un solo predecessore e senza side effect: il branch si sposta nel preheader,
+    nel loop resta il salto al successore interno
+
+      preheader: br cond, uscita, preheader.us ──> loop (senza il branch)
+
+    Le PHI dell'uscita devono ricevere dal branch valori invarianti (calcolati prima del loop); il loop è in forma
+    LCSSA, quindi ogni valore del loop usato dopo l'uscita passa da queste PHI
+  • UNSWITCH CON CLONE: il loop (in forma LCSSA) viene clonato insieme al preheader; l'originale è la versione con
+    la condizione vera, il clone quella con la condizione falsa. In ognuna il branch diventa un salto
+    incondizionato e i blocchi del ramo non preso spariscono
+
+      preheader: br cond, loop.ph ──> loop (ramo vero)  ──┐
+                     └──> loop.ph.us ──> loop.us (ramo falso) ──┴──> uscite (PHI LCSSA con i valori dei due loop)
+
+    Il branch ora viene eseguito anche quando il loop non l'avrebbe raggiunto: la condizione viene congelata
+    (freeze) se può essere poison/undef
+  • Budget: le istruzioni clonate per funzione non superano Budget (un loop che non ci sta viene saltato);
+    gli unswitch banali non lo consumano
+  • Si ripete finché ci sono candidati, dal loop più interno: le versioni di un loop possono avere altri branch
+    invarianti, e il branch spostato nel preheader di un sottoloop può essere invariante anche nel loop esterno
+  Dopo ogni trasformazione DominatorTree e LoopInfo vengono ricalcolati e le uscite tornano dedicate (loop-simplify)
+*/
+
+#include "LocalOpts.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LCSSA.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+
+// Parametri di lu<...>, separati da ';' (es. lu<budget=500>)
+Expected<LoopUnswitchingOptions> parseLoopUnswitchingOptions(StringRef Params) {
+  LoopUnswitchingOptions Opts;
+  while (!Params.empty()) {
+    StringRef Param;
+    std::tie(Param, Params) = Params.split(';');
+    if (Param.consume_front("budget=")) {
+      if (Param.getAsInteger(0, Opts.Budget))
+        return createStringError(inconvertibleErrorCode(), "lu: budget non valido '" + Param + "'");
+    } else {
+      return createStringError(inconvertibleErrorCode(), "lu: parametro sconosciuto '" + Param + "'");
+    }
+  }
+  return Opts;
+}
+
+struct UnswitchStats {
+  unsigned trivial = 0;    // Branch spostati senza clonare
+  unsigned nonTrivial = 0; // Loop clonati
+  unsigned cloned = 0;     // Istruzioni clonate
+};
+
+void printLoopHeader(Loop &L) {
+  outs() << "Loop ";
+  L.getHeader()->printAsOperand(outs(), false);
+  outs() << ": ";
+}
+
+// Branch condizionale di BB con condizione invariante in L (resa tale se possibile), nullptr altrimenti
+BranchInst *getInvariantBranch(Loop &L, BasicBlock &BB, bool &changed) {
+  auto *BI = dyn_cast<BranchInst>(BB.getTerminator());
+  if (!BI || !BI->isConditional() || BI->getSuccessor(0) == BI->getSuccessor(1)) return nullptr;
+
+  Value *Cond = BI->getCondition();
+  if (isa<Constant>(Cond)) return nullptr; // Lo ripiega simplifycfg
+  return L.makeLoopInvariant(Cond, changed) ? BI : nullptr;
+}
+
+// Branch invariante raggiunto ad ogni iterazione senza side effect prima, con un successore fuori dal loop
+BranchInst *findTrivialUnswitch(Loop &L, bool &changed) {
+  BasicBlock *BB = L.getHeader();
+  while (true) {
+    for (Instruction &I : *BB) {
+      if (&I != BB->getTerminator() && I.mayHaveSideEffects()) return nullptr;
+    }
+
+    auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI) return nullptr;
+
+    if (BI->isUnconditional()) {
+      BasicBlock *Succ = BI->getSuccessor(0);
+      if (!L.contains(Succ) || Succ == L.getHeader() || !Succ->getSinglePredecessor()) return nullptr;
+      BB = Succ;
+      continue;
+    }
+
+    if (!getInvariantBranch(L, *BB, changed)) return nullptr;
+
+    // Serve un successore nel loop e uno fuori (entrambi nel loop: serve il clone)
+    bool inLoop0 = L.contains(BI->getSuccessor(0)), inLoop1 = L.contains(BI->getSuccessor(1));
+    if (inLoop0 == inLoop1) return nullptr;
+    BasicBlock *Exit = BI->getSuccessor(inLoop0 ? 1 : 0);
+
+    // L'uscita viene raggiunta dal preheader: i valori che riceve dal branch devono esistere già lì
+    for (PHINode &Phi : Exit->phis()) {
+      if (!L.isLoopInvariant(Phi.getIncomingValueForBlock(BB))) return nullptr;
+    }
+    return BI;
+  }
+}
+
+// Il loop può essere clonato: niente istruzioni non duplicabili (es. chiamate convergent) e ingressi solo dall'header
+bool canCloneLoop(Loop &L) {
+  for (BasicBlock *BB : L.blocks()) {
+    if (BB->hasAddressTaken() || isa<IndirectBrInst>(BB->getTerminator()) || isa<CallBrInst>(BB->getTerminator()))
+      return false;
+    for (Instruction &I : *BB) {
+      auto *Call = dyn_cast<CallBase>(&I);
+      if (Call && (Call->cannotDuplicate() || Call->isConvergent())) return false;
+    }
+  }
+  return true;
+}
+
+unsigned getLoopSize(Loop &L) {
+  unsigned size = 0;
+  for (BasicBlock *BB : L.blocks()) size += BB->size();
+  return size;
+}
+
+// Primo branch invariante di L (nei blocchi di L, non dei sottoloop), nullptr se non ce ne sono
+BranchInst *findNonTrivialUnswitch(Loop &L, LoopInfo &LI, bool &changed) {
+  for (BasicBlock *BB : L.blocks()) {
+    if (LI.getLoopFor(BB) != &L) continue;
+    if (BranchInst *BI = getInvariantBranch(L, *BB, changed)) return BI;
+  }
+  return nullptr;
+}
+
+// Il branch diventa un salto al successore Taken; l'altro successore perde il predecessore
+void replaceWithTakenSuccessor(BranchInst *BI, bool Taken) {
+  BasicBlock *BB = BI->getParent();
+  BasicBlock *Kept = BI->getSuccessor(Taken ? 0 : 1);
+  BasicBlock *Dropped = BI->getSuccessor(Taken ? 1 : 0);
+
+  Dropped->removePredecessor(BB);
+  BranchInst::Create(Kept, BI);
+  BI->eraseFromParent();
+}
+
+void unswitchTrivial(Loop &L, BranchInst *BI, DominatorTree &DT, LoopInfo &LI) {
+  BasicBlock *BB = BI->getParent();
+  bool exitOnTrue = !L.contains(BI->getSuccessor(0));
+  BasicBlock *Exit = BI->getSuccessor(exitOnTrue ? 0 : 1);
+
+  // STEP 1: Il preheader viene diviso: il branch resta nel vecchio, il nuovo preheader salta all'header
+  BasicBlock *Preheader = L.getLoopPreheader();
+  BasicBlock *NewPreheader = SplitBlock(Preheader, Preheader->getTerminator(), &DT, &LI, nullptr, L.getHeader()->getName() + ".us");
+
+  // STEP 2: La decisione viene presa prima del loop (la condizione è già disponibile nel preheader)
+  BasicBlock *TrueSucc = exitOnTrue ? Exit : NewPreheader;
+  BasicBlock *FalseSucc = exitOnTrue ? NewPreheader : Exit;
+  BranchInst::Create(TrueSucc, FalseSucc, BI->getCondition(), Preheader->getTerminator());
+  Preheader->getTerminator()->eraseFromParent();
+
+  // STEP 3: Le PHI dell'uscita ricevono dal preheader i valori che ricevevano dal branch
+  Exit->replacePhiUsesWith(BB, Preheader);
+
+  // STEP 4: Nel loop resta il salto al successore interno
+  BranchInst::Create(BI->getSuccessor(exitOnTrue ? 1 : 0), BI);
+  BI->eraseFromParent();
+}
+
+void unswitchNonTrivial(Loop &L, BranchInst *BI, Function &F, DominatorTree &DT, LoopInfo &LI) {
+  // STEP 1: Il loop è in forma LCSSA (run): i valori del loop usati fuori passano dalle PHI delle uscite, che
+  // riceveranno anche quelli del clone
+  SmallVector<BasicBlock*, 4> exits;
+  L.getUniqueExitBlocks(exits);
+
+  // STEP 2: Il preheader viene diviso: la condizione resta nel vecchio, il nuovo (clonato con il loop) salta all'header
+  BasicBlock *Check = L.getLoopPreheader();
+  BasicBlock *Preheader = SplitBlock(Check, Check->getTerminator(), &DT, &LI, nullptr, L.getHeader()->getName() + ".ph");
+
+  // STEP 3: Clone del preheader e del loop
+  SmallVector<BasicBlock*, 16> blocks = {Preheader};
+  blocks.append(L.block_begin(), L.block_end());
+
+  ValueToValueMapTy VMap;
+  SmallVector<BasicBlock*, 16> clones;
+  for (BasicBlock *BB : blocks) {
+    BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".us", &F);
+    VMap[BB] = Clone;
+    clones.push_back(Clone);
+  }
+  remapInstructionsInBlocks(clones, VMap);
+
+  // STEP 4: Le PHI delle uscite ricevono anche i valori del clone
+  for (BasicBlock *Exit : exits) {
+    for (PHINode &Phi : Exit->phis()) {
+      for (unsigned k = 0, e = Phi.getNumIncomingValues(); k < e; k++) {
+        BasicBlock *Pred = Phi.getIncomingBlock(k);
+        if (!L.contains(Pred)) continue;
+        Value *V = Phi.getIncomingValue(k);
+        Value *Mapped = VMap.lookup(V);
+        Phi.addIncoming(Mapped ? Mapped : V, cast<BasicBlock>(VMap[Pred]));
+      }
+    }
+  }
+
+  // STEP 5: Scelta prima del loop, con la condizione congelata se il branch poteva non essere eseguito
+  Value *Cond = BI->getCondition();
+  if (!isGuaranteedNotToBeUndefOrPoison(Cond, nullptr, Check->getTerminator(), &DT))
+    Cond = new FreezeInst(Cond, Cond->getName() + ".fr", Check->getTerminator());
+  BranchInst::Create(Preheader, cast<BasicBlock>(VMap[Preheader]), Cond, Check->getTerminator());
+  Check->getTerminator()->eraseFromParent();
+
+  // STEP 6: Originale = ramo vero, clone = ramo falso
+  auto *ClonedBI = cast<BranchInst>(VMap[BI]);
+  replaceWithTakenSuccessor(BI, true);
+  replaceWithTakenSuccessor(ClonedBI, false);
+}
+
+PreservedAnalyses LoopUnswitchingPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+
+  UnswitchStats stats;
+  unsigned budget = Opts.Budget;
+  bool changed = false;
+
+  while (true) {
+    // Dal loop più interno (preorder al contrario: i sottoloop prima dei loop che li contengono)
+    SmallVector<Loop*, 4> loops = LI.getLoopsInPreorder();
+    std::reverse(loops.begin(), loops.end());
+
+    bool unswitched = false;
+    for (Loop *L : loops) {
+      if (!L->getLoopPreheader() || !L->hasDedicatedExits()) continue; // Serve loop-simplify
+
+      // LCSSA (l'input di mem2reg e della pipeline di clang non lo garantisce): un valore del loop usato dopo
+      // l'uscita del branch banale non dominerebbe più l'uso quando l'uscita viene raggiunta dal preheader
+      changed |= formLCSSARecursively(*L, DT, &LI, nullptr);
+
+      if (BranchInst *BI = findTrivialUnswitch(*L, changed)) {
+        printLoopHeader(*L);
+        outs() << "unswitch banale di " << *BI << "\n";
+        unswitchTrivial(*L, BI, DT, LI);
+        stats.trivial++;
+        unswitched = true;
+        break;
+      }
+
+      BranchInst *BI = findNonTrivialUnswitch(*L, LI, changed);
+      if (!BI || !canCloneLoop(*L)) continue;
+
+      unsigned size = getLoopSize(*L) + 1; // + il preheader
+      if (size > budget) {
+        printLoopHeader(*L);
+        outs() << "unswitch saltato (" << size << " istruzioni, budget " << budget << ")\n";
+        continue;
+      }
+
+      printLoopHeader(*L);
+      outs() << "unswitch con clone di " << *BI << " (" << size << " istruzioni)\n";
+      unswitchNonTrivial(*L, BI, F, DT, LI);
+      budget -= size;
+      stats.nonTrivial++;
+      stats.cloned += size;
+      unswitched = true;
+      break;
+    }
+    if (!unswitched) break;
+    changed = true;
+
+    // I rami non presi sono irraggiungibili; i loop (e le versioni clonate) vengono ricalcolati da zero
+    removeUnreachableBlocks(F);
+    DT.recalculate(F);
+    LI.releaseMemory();
+    LI.analyze(DT);
+    for (Loop *L : LI.getLoopsInPreorder()) formDedicatedExitBlocks(L, &DT, &LI, nullptr, /*PreserveLCSSA*/ true);
+  }
+
+  if (!stats.trivial && !stats.nonTrivial) {
+    errs() << F.getName() << ": Not Transformed by LoopUnswitchingPass\n";
+    // makeLoopInvariant può aver spostato istruzioni nei preheader, il CFG non cambia
+    if (!changed) return PreservedAnalyses::all();
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+  }
+
+  errs() << F.getName() << ": Transformed by LoopUnswitchingPass (banali: " << stats.trivial << ", con clone: "
+         << stats.nonTrivial << ", istruzioni clonate: " << stats.cloned << ")\n";
+  return PreservedAnalyses::none();
+}
@@ -0,0 +1,28 @@
+int loop_strength_reduction_test(int *A, int *B, int *C, int n, int stride){
+    int sum = 0;
+
+    for(int i = 0; i < n; i++){
+        A[i] = B[i] + C[i];     // Ottimizzato (A, B e C condividono un solo offset)
+        sum += i * stride;      // Ottimizzato (nuova IV con step = stride)
+    }
+
+    for(int i = 0; i < n; i += 2){
+        B[i * 3] = A[i + 1];    // Ottimizzato (due IV: step 24 byte per B, 8 byte per A che parte da A + 4)
+    }
+
+    for(int i = 0; i < n; i++){
+        for(int j = 0; j < n; j++)
+            C[i * n + j] = i;   // Ottimizzato (il loop esterno calcola i * n con un add)
+    }
+
+    return sum;
+}
+
+int main(){
+    int A[64], B[64], C[64];
+    for(int i = 0; i < 64; i++){
+        B[i] = i;
+        C[i] = 2 * i;
+    }
+    return loop_strength_reduction_test(A, B, C, 8, 3) & 0xff;
+}
@@ -0,0 +1,30 @@
+#include <cmath>
+#include <cstring>
+
+// Compilare con -fno-math-errno (make clang ... cflags=-fno-math-errno): sqrt diventa readnone
+// Ottimizzare con p='inferattrs,function(li)': strlen diventa readonly
+__attribute__((const)) int square(int x) { return x * x; } // readnone: invariante come un'operazione aritmetica
+
+int counter = 0;
+void tick() { counter++; } // Scrive memoria: resta nel loop
+
+int fun(const char *s, char *out, double k, int a, int n){
+    int sum = 0;
+    for(int i = 0; i < (int)strlen(s); i++){  // strlen(s) resta nel loop: out può puntare a s
+        sum += square(a);                     // code motion
+        sum += (int)sqrt(k);                  // code motion
+        out[i] = s[i];
+    }
+    for(int i = 0; i < n; i++)
+        sum += (int)strlen(s);                // code motion: nel loop nessuna scrittura
+    for(int i = 0; i < n; i++){
+        sum += (int)strlen(s);                // Resta nel loop: tick può scrivere s
+        tick();                               // Non considerato (scrive memoria)
+    }
+    return sum;
+}
+
+int main(){
+    char out[8];
+    return fun("abc", out, 16.0, 3, 4);
+}
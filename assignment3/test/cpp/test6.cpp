@@ -0,0 +1,46 @@
+// Ottimizzare con p='loop(loop-rotate),lu' (p='loop(loop-rotate),lu<budget=N>' per cambiare il budget delle istruzioni clonate)
+// Senza rotazione il primo branch dell'header è il controllo di uscita: anche il primo loop richiede il clone
+
+int fun(int *A, int *B, int n, int mode, bool verbose){
+    int sum = 0;
+
+    for(int i = 0; i < n; i++){
+        if(mode < 0)              // Unswitch banale: esce dal loop prima di ogni side effect
+            break;
+        A[i] = B[i] + mode;
+    }
+
+    for(int i = 0; i < n; i++){
+        if(mode == 2)             // Unswitch con clone: un loop per mode == 2, uno per gli altri valori
+            A[i] = B[i] * 2;
+        else
+            A[i] = B[i] + 1;
+        sum += A[i];              // Il valore finale di sum arriva dalle due versioni (PHI LCSSA)
+    }
+
+    for(int i = 0; i < n; i++){
+        for(int j = 0; j < n; j++){
+            if(verbose)           // Unswitch del loop interno: il branch spostato nel suo preheader è invariante anche nel loop esterno
+                sum += i * j;
+            B[j] += i;
+        }
+    }
+
+    return sum;
+}
+
+int find(int *A, int n, bool stop){
+    for(int i = 0; i < n; i++){
+        if(stop)                  // Non banale: l'uscita usa i (PHI LCSSA con un valore del loop) -> clone
+            return i;
+        A[i] = i;
+    }
+    return -1;
+}
+
+int main(){
+    int A[16], B[16];
+    for(int i = 0; i < 16; i++)
+        B[i] = i;
+    return (fun(A, B, 16, 2, false) + fun(A, B, 16, 1, true) + fun(A, B, 16, -1, true) + find(A, 16, false) + find(A, 16, true)) & 0xff;
+}
@@ -0,0 +1,19 @@
+// Istruzioni invarianti in blocchi che il loop può non eseguire (p=li): si spostano solo se speculabili
+int fun(int *p, int a, int d, int n){
+    int s = 0;
+    int x = 0;
+    for(int i = 0; i < n; i++){
+        if(p)
+            s += *p;        // Resta nel loop: nel preheader p può essere nullptr
+        if(d)
+            x += a / d;     // Resta nel loop: nel preheader d può essere 0
+        else
+            x += a * 3;     // code motion (non può fallire)
+    }
+    return s + x;
+}
+
+int main(){
+    int v = 4;
+    return fun(&v, 10, 2, 8) + fun(nullptr, 10, 0, 8);
+}
@@ -0,0 +1,202 @@
+//-----------------------------------------------------------------------------
+// Array Contraction implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Dopo la fusione un array temporaneo viene scritto e letto nella stessa iterazione (test5.cpp):
+    int A[10];
+    for(i...){ A[i] = a + b; B[i] = A[i]; }   ...   return A[0] + ...;
+  Ogni elemento vive per un'iterazione: l'array (e la sua occupazione in cache) non serve.
+  Il passo "ac" sostituisce l'array con scalari (poi promossi a registri).
+
+ALGORITMO (array allocati con alloca di dimensione costante):
+  • Usi noti: solo GEP, load e store sull'array (come indirizzo) e lifetime marker. Qualunque altro uso
+    (chiamata, puntatore salvato in memoria, ...) può far uscire l'array dalla funzione
+  • Load nei loop con indirizzo variabile: vengono prima sostituiti con il valore salvato (Scalar Replacement,
+    anche a distanza di qualche iterazione con i registri rotanti). Se ne resta qualcuno l'array non si contrae
+  • Restano i load con indirizzo costante (es. A[0] dopo il loop): ogni elemento letto diventa uno scalare
+    • Store con indirizzo costante: sullo scalare dell'elemento, oppure eliminato se l'elemento non viene mai letto
+    • Store con indirizzo variabile (nel loop): scalare = (offset == offset dell'elemento) ? valore : scalare
+  • Gli scalari vengono promossi a registri (PromoteMemToReg), l'array viene eliminato
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+static const unsigned MaxScalars = 8; // Elementi letti con indirizzo costante
+
+// Load e store sull'array, seguendo le GEP. False se l'array può essere usato in altro modo
+bool collectAccesses(AllocaInst *AI, SmallVectorImpl<Instruction*> &accesses, SmallVectorImpl<Instruction*> &markers) {
+  SmallVector<Value*, 8> worklist = {AI};
+  while (!worklist.empty()) {
+    Value *Ptr = worklist.pop_back_val();
+    for (User *U : Ptr->users()) {
+      if (auto *GEP = dyn_cast<GetElementPtrInst>(U); GEP && GEP->getPointerOperand() == Ptr)
+        worklist.push_back(GEP);
+      else if (auto *Load = dyn_cast<LoadInst>(U); Load && Load->isSimple())
+        accesses.push_back(Load);
+      else if (auto *S = dyn_cast<StoreInst>(U); S && S->isSimple() && S->getValueOperand() != Ptr)
+        accesses.push_back(S);
+      else if (auto *II = dyn_cast<IntrinsicInst>(U); II && II->isLifetimeStartOrEnd())
+        markers.push_back(II);
+      else
+        return false;
+    }
+  }
+  return true;
+}
+
+// Offset multiplo della dimensione dell'elemento: costante oppure ricorrenza (anche annidata) con start e step costanti
+bool isElementAligned(const SCEV *Offset, uint64_t Size, ScalarEvolution &SE) {
+  if (auto *C = dyn_cast<SCEVConstant>(Offset)) return C->getAPInt().urem(Size) == 0;
+  if (auto *AR = dyn_cast<SCEVAddRecExpr>(Offset))
+    return AR->isAffine() && isElementAligned(AR->getStart(), Size, SE) && isElementAligned(AR->getStepRecurrence(SE), Size, SE);
+  return false;
+}
+
+// Offset in byte dell'accesso dall'inizio dell'array
+const SCEV *getOffset(Instruction *I, AllocaInst *AI, ScalarEvolution &SE) {
+  return SE.getMinusSCEV(SE.getSCEV(getLoadStorePointerOperand(I)), SE.getSCEV(AI));
+}
+
+// True se l'array è stato eliminato; changed indica anche le sostituzioni della Scalar Replacement
+bool contractArray(AllocaInst *AI, LoopInfo &LI, ScalarEvolution &SE, DominatorTree &DT, AAResults &AA, const DataLayout &DL,
+                   bool &changed) {
+  SmallVector<Instruction*, 16> accesses, markers;
+  if (!AI->isStaticAlloca() || !AI->getAllocatedType()->isArrayTy() || !collectAccesses(AI, accesses, markers)) return false;
+  if (accesses.empty()) return false;
+
+  outs() << "Array ";
+  AI->printAsOperand(outs(), false);
+  outs() << " (" << AI->getFunction()->getName() << "):\n";
+
+  // Load nei loop con indirizzo variabile: prima la Scalar Replacement sui loop che li contengono
+  SmallPtrSet<Loop*, 4> forwarded;
+  for (Instruction *I : accesses) {
+    Loop *L = LI.getLoopFor(I->getParent());
+    if (isa<LoadInst>(I) && L && !isa<SCEVConstant>(getOffset(I, AI, SE)) && forwarded.insert(L).second &&
+        replaceLoopLoads(*L, SE, DT, AA, DL)) {
+      SE.forgetLoop(L);
+      changed = true;
+    }
+  }
+  if (!forwarded.empty()) {
+    accesses.clear();
+    markers.clear();
+    collectAccesses(AI, accesses, markers);
+  }
+
+  // Tutti gli accessi sugli elementi interi dello stesso tipo
+  Type *EltTy = getLoadStoreType(accesses[0]);
+  uint64_t Size = DL.getTypeStoreSize(EltTy);
+  SCEVExpander Expander(SE, DL, "ac");
+  MapVector<int64_t, AllocaInst*> scalars; // Offset dell'elemento letto -> scalare
+
+  for (Instruction *I : accesses) {
+    const SCEV *Offset = getOffset(I, AI, SE);
+    if (getLoadStoreType(I) != EltTy || DL.getTypeAllocSize(EltTy) != Size || !isElementAligned(Offset, Size, SE)) {
+      outs() << "  - Accesso non allineato agli elementi: " << *I << "\n";
+      return false;
+    }
+    if (isa<StoreInst>(I)) {
+      if (!isa<SCEVConstant>(Offset) && !Expander.isSafeToExpand(Offset)) return false;
+      continue;
+    }
+    auto *C = dyn_cast<SCEVConstant>(Offset);
+    if (!C) {
+      outs() << "  - Load con indirizzo variabile: " << *I << "\n";
+      return false;
+    }
+    scalars.insert({C->getAPInt().getSExtValue(), nullptr});
+  }
+
+  if (scalars.size() > MaxScalars) {
+    outs() << "  - Troppi elementi letti (" << scalars.size() << ")\n";
+    return false;
+  }
+
+  // Uno scalare per ogni elemento letto
+  for (auto &[Off, Scalar] : scalars) {
+    Scalar = new AllocaInst(EltTy, AI->getAddressSpace(), AI->getName() + "." + Twine(Off / Size), AI);
+    Scalar->setAlignment(AI->getAlign());
+  }
+
+  SmallVector<WeakTrackingVH, 16> dead;
+  for (Instruction *I : accesses) {
+    const SCEV *Offset = getOffset(I, AI, SE);
+    dead.push_back(getLoadStorePointerOperand(I));
+
+    if (auto *Load = dyn_cast<LoadInst>(I)) {
+      AllocaInst *Scalar = scalars.lookup(cast<SCEVConstant>(Offset)->getAPInt().getSExtValue());
+      Load->setOperand(Load->getPointerOperandIndex(), Scalar);
+      continue;
+    }
+
+    auto *S = cast<StoreInst>(I);
+    if (auto *C = dyn_cast<SCEVConstant>(Offset)) {
+      if (AllocaInst *Scalar = scalars.lookup(C->getAPInt().getSExtValue()))
+        S->setOperand(S->getPointerOperandIndex(), Scalar);
+      else
+        S->eraseFromParent(); // Elemento mai letto
+      continue;
+    }
+
+    // Indirizzo variabile: aggiorna gli scalari degli elementi che lo store può scrivere
+    IRBuilder<> Builder(S);
+    Value *OffsetV = nullptr;
+    for (auto &[Off, Scalar] : scalars) {
+      const SCEV *EltOffset = SE.getConstant(Offset->getType(), Off, /*isSigned*/ true);
+      if (SE.isKnownPredicate(CmpInst::ICMP_NE, Offset, EltOffset)) continue;
+
+      if (!OffsetV) OffsetV = Expander.expandCodeFor(Offset, Offset->getType(), S);
+      Value *Old = Builder.CreateAlignedLoad(EltTy, Scalar, Scalar->getAlign());
+      Value *Hit = Builder.CreateICmpEQ(OffsetV, ConstantInt::get(Offset->getType(), Off, /*IsSigned*/ true));
+      Builder.CreateAlignedStore(Builder.CreateSelect(Hit, S->getValueOperand(), Old), Scalar, Scalar->getAlign());
+    }
+    S->eraseFromParent();
+  }
+
+  // GEP rimaste senza usi e l'array
+  for (Instruction *Marker : markers) Marker->eraseFromParent();
+  dead.push_back(AI);
+  RecursivelyDeleteTriviallyDeadInstructionsPermissive(dead);
+
+  SmallVector<AllocaInst*, 8> promoted;
+  for (auto &[Off, Scalar] : scalars) promoted.push_back(Scalar);
+  if (!promoted.empty()) PromoteMemToReg(promoted, DT);
+
+  outs() << "  => " << promoted.size() << " scalari\n";
+  changed = true;
+  return true;
+}
+
+PreservedAnalyses ArrayContractionPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  AAResults &AA = AM.getResult<AAManager>(F);
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  SmallVector<AllocaInst*, 8> arrays;
+  for (Instruction &I : F.getEntryBlock()) {
+    if (auto *AI = dyn_cast<AllocaInst>(&I)) arrays.push_back(AI);
+  }
+
+  bool changed = false;
+  for (AllocaInst *AI : arrays) {
+    if (contractArray(AI, LI, SE, DT, AA, DL, changed))
+      SE.forgetAllLoops(); // Gli accessi eliminati possono essere in qualunque loop
+  }
+
+  if (!changed) return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>(); // Cambiano solo le istruzioni, non i blocchi
+  return PA;
+}
@@ -0,0 +1,136 @@
+//-----------------------------------------------------------------------------
+// Induction Variable Canonicalization implementation
+//-----------------------------------------------------------------------------
+
+/*
+  La LoopFusion (merge) usa la variabile di induzione canonica del loop (getCanonicalInductionVariable:
+  PHINode nell'header che parte da 0 e viene incrementato di 1), quindi i loop come
+    for(int i=9; i>=0; i--)   oppure   for(int i=3; i<n; i+=2)
+  non vengono fusi. Il passo "ic" li riscrive in forma canonica.
+
+ALGORITMO:
+  • Servono un solo exiting block (con branch condizionale) e un backedge-taken count (BTC) calcolabile da SCEV
+  • Si inserisce (o si riusa) la IV canonica {0,+,1}
+  • Il test di uscita diventa "IV canonica == BTC": il loop esce all'iterazione numero BTC,
+    qualunque fosse il predicato originale (<, <=, >=, !=, ...)
+  • Ogni altra IV affine {start,+,step} (step costante, anche negativo) diventa start + step * IV canonica:
+    start viene espanso da SCEV nel preheader, il PHINode originale e il suo incremento vengono eliminati
+*/
+
+#include "LocalOpts.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+// IV canonica del loop (creata se non c'è): PHINode {0,+,1} nell'header, incrementato nel latch
+PHINode *getOrInsertCanonicalIV(Loop &L, Type *Ty) {
+  PHINode *IndVar = L.getCanonicalInductionVariable();
+  if (IndVar && IndVar->getType() == Ty) return IndVar;
+
+  IRBuilder<> Builder(&L.getHeader()->front());
+  IndVar = Builder.CreatePHI(Ty, 2, "indvar");
+  Builder.SetInsertPoint(L.getLoopLatch()->getTerminator());
+  Value *Next = Builder.CreateAdd(IndVar, ConstantInt::get(Ty, 1), "indvar.next");
+  IndVar->addIncoming(ConstantInt::get(Ty, 0), L.getLoopPreheader());
+  IndVar->addIncoming(Next, L.getLoopLatch());
+  return IndVar;
+}
+
+bool canonicalizeLoop(Loop &L, ScalarEvolution &SE, const DataLayout &DL) {
+  if (!L.isLoopSimplifyForm()) return false;
+
+  BasicBlock *Header = L.getHeader();
+  BasicBlock *Preheader = L.getLoopPreheader();
+  BasicBlock *Latch = L.getLoopLatch();
+  BasicBlock *Exiting = L.getExitingBlock();
+  if (!Exiting) return false;
+
+  auto *ExitBr = dyn_cast<BranchInst>(Exiting->getTerminator());
+  if (!ExitBr || !ExitBr->isConditional()) return false;
+
+  const SCEV *BTC = SE.getBackedgeTakenCount(&L);
+  SCEVExpander Expander(SE, DL, "ic");
+  if (isa<SCEVCouldNotCompute>(BTC) || !Expander.isSafeToExpand(BTC)) return false;
+
+  // Induction variable affini con step costante
+  SmallVector<std::pair<PHINode*, const SCEVAddRecExpr*>, 4> ivs;
+  for (PHINode &Phi : Header->phis()) {
+    if (!Phi.getType()->isIntegerTy()) continue;
+
+    auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&Phi));
+    if (AR && AR->getLoop() == &L && AR->isAffine() && isa<SCEVConstant>(AR->getStepRecurrence(SE)) &&
+        SE.isLoopInvariant(AR->getStart(), &L) && Expander.isSafeToExpand(AR->getStart()))
+      ivs.push_back({&Phi, AR});
+  }
+
+  // Già canonico: l'unica IV è quella canonica
+  PHINode *Canonical = L.getCanonicalInductionVariable();
+  if (ivs.empty() || (ivs.size() == 1 && ivs[0].first == Canonical)) return false;
+
+  outs() << "Loop " << Header->getName() << " (BTC: " << *BTC << ")\n";
+
+  // IV canonica e test di uscita "IV == BTC"
+  PHINode *IndVar = getOrInsertCanonicalIV(L, BTC->getType());
+  Value *BTCV = Expander.expandCodeFor(BTC, BTC->getType(), Preheader->getTerminator());
+
+  SmallVector<WeakTrackingVH, 8> dead;
+  dead.push_back(ExitBr->getCondition());
+
+  IRBuilder<> Builder(ExitBr);
+  CmpInst::Predicate Pred = L.contains(ExitBr->getSuccessor(0)) ? CmpInst::ICMP_NE : CmpInst::ICMP_EQ;
+  ExitBr->setCondition(Builder.CreateICmp(Pred, IndVar, BTCV, "ic.exitcond"));
+  outs() << "  - Test di uscita: " << *ExitBr->getCondition() << "\n";
+
+  // Le altre IV diventano start + step * IV canonica
+  Builder.SetInsertPoint(&*Header->getFirstInsertionPt());
+  for (auto [Phi, AR] : ivs) {
+    if (Phi == IndVar) continue;
+
+    Type *Ty = Phi->getType();
+    Value *Start = Expander.expandCodeFor(AR->getStart(), Ty, Preheader->getTerminator());
+    const APInt &Step = cast<SCEVConstant>(AR->getStepRecurrence(SE))->getAPInt();
+    Value *Index = Builder.CreateZExtOrTrunc(IndVar, Ty);
+
+    Value *New;
+    if (Step.isOne())
+      New = Builder.CreateAdd(Start, Index, Phi->getName() + ".ic");
+    else if (Step.isAllOnes())
+      New = Builder.CreateSub(Start, Index, Phi->getName() + ".ic");
+    else
+      New = Builder.CreateAdd(Start, Builder.CreateMul(Index, ConstantInt::get(Ty, Step)), Phi->getName() + ".ic");
+
+    outs() << "  - IV " << *AR << ": " << *Phi << " -> " << *New << "\n";
+
+    // Anche l'incremento usa il nuovo valore: rimossa la PHI, muore se non ha altri usi
+    Value *Inc = Phi->getIncomingValueForBlock(Latch);
+    Phi->replaceAllUsesWith(New);
+    Phi->eraseFromParent();
+    dead.push_back(Inc);
+  }
+
+  RecursivelyDeleteTriviallyDeadInstructionsPermissive(dead);
+  return true;
+}
+
+PreservedAnalyses InductionVariableCanonicalizationPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+
+  bool changed = false;
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    if (canonicalizeLoop(*L, SE, F.getParent()->getDataLayout())) {
+      SE.forgetLoop(L);
+      changed = true;
+    }
+  }
+
+  if (!changed) return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>(); // Cambiano solo le istruzioni, non i blocchi
+  return PA;
+}
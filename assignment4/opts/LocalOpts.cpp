@@ -1,8 +1,46 @@
 #include "LocalOpts.h"
 
 bool add_passes(StringRef Name, FunctionPassManager &FPM){
-  if (Name == "lf") {
-    FPM.addPass(LoopFusionPass());
+  if (PassBuilder::checkParametrizedPassName(Name, "lf")) {
+    Expected<LoopFusionOptions> Opts = PassBuilder::parsePassParameters(parseLoopFusionOptions, Name, "lf");
+    if (!Opts) {
+      errs() << toString(Opts.takeError()) << "\n";
+      return false;
+    }
+    FPM.addPass(LoopFusionPass(*Opts));
+    return true;
+  }
+  if (Name == "ic") {
+    FPM.addPass(InductionVariableCanonicalizationPass());
+    return true;
+  }
+  if (Name == "lvr") {
+    FPM.addPass(LoopVersioningPass());
+    return true;
+  }
+  if (Name == "vec") {
+    FPM.addPass(LoopVectorizationPass());
+    return true;
+  }
+  if (Name == "scr") {
+    FPM.addPass(ScalarReplacementPass());
+    return true;
+  }
+  if (Name == "ac") {
+    FPM.addPass(ArrayContractionPass());
+    return true;
+  }
+  if (PassBuilder::checkParametrizedPassName(Name, "par")) {
+    Expected<LoopParallelizationOptions> Opts = PassBuilder::parsePassParameters(parseLoopParallelizationOptions, Name, "par");
+    if (!Opts) {
+      errs() << toString(Opts.takeError()) << "\n";
+      return false;
+    }
+    FPM.addPass(LoopParallelizationPass(*Opts));
+    return true;
+  }
+  if (Name == "print<access-summary>") {
+    FPM.addPass(LoopAccessSummaryPrinterPass());
     return true;
   }
 
@@ -15,6 +53,10 @@ bool add_passes(StringRef Name, FunctionPassManager &FPM){
 llvm::PassPluginLibraryInfo getTestPassPluginInfo() {
   return {
     LLVM_PLUGIN_API_VERSION, "LocalOpt", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+      PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager &FAM) {
+          FAM.registerPass([] { return LoopAccessSummaryAnalysis(); });
+        }
+      );
       PB.registerPipelineParsingCallback([](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
           return add_passes(Name, FPM);
         }
@@ -1,12 +1,123 @@
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Support/raw_ostream.h"
+#include <optional>
 
 using namespace llvm;
 
-// LICM
+// Utilità condivise tra i passi
+BasicBlock* getExitGuardSuccessor(Loop &L);                                 // LoopFusion.cpp
+bool mayAliasAcrossArrays(Instruction &I1, Instruction &I2, AAResults &AA); // LoopFusion.cpp
+bool replaceLoopLoads(Loop &L, ScalarEvolution &SE, DominatorTree &DT, AAResults &AA, const DataLayout &DL); // ScalarReplacement.cpp
+
+// Loop Access Summary (LoopAccessSummary.cpp): accessi in memoria e live-out di un loop, calcolati una volta sola
+struct MemoryAccessInfo {
+  Instruction *I;               // Load o store
+  const SCEV *Start;            // Indirizzo alla prima iterazione (l'indirizzo stesso se non è affine sul loop)
+  const SCEV *End;              // Indirizzo all'iterazione del backedge-taken count (per eccesso), nullptr se non calcolabile
+  std::optional<int64_t> Step;  // Step costante in byte (0: invariante), vuoto se non affine
+  uint64_t Size;                // Byte letti o scritti
+  bool IsWrite;
+};
+
+struct BaseAccessGroup {
+  SmallVector<MemoryAccessInfo, 4> Accesses;
+  bool HasWrites = false;
+};
+
+struct LoopAccessSummary {
+  MapVector<const Value*, BaseAccessGroup> Groups; // Oggetto base (getUnderlyingObject) -> accessi
+  SmallVector<WeakVH, 4> LiveOuts;             // Istruzioni del loop usate fuori
+  SmallVector<Instruction*, 2> UnknownAccesses; // Accessi in memoria non riassumibili (chiamate, memset/memcpy, volatile)
+  void print(raw_ostream &OS) const;
+};
+
+class LoopAccessSummaries {
+public:
+  LoopAccessSummaries(ScalarEvolution &SE, const DataLayout &DL) : SE(SE), DL(DL) {}
+
+  const LoopAccessSummary &get(Loop &L);                // Calcolato alla prima richiesta
+  void merge(BasicBlock *Header1, BasicBlock *Header2); // Fusione: il loop di Header1 assorbe quello di Header2
+  void forget(BasicBlock *Header);                      // Loop trasformato (es. ruotato)
+  // I riassunti contengono SCEV: vanno scartati anche quando viene invalidata la ScalarEvolution
+  bool invalidate(Function &F, const PreservedAnalyses &PA, FunctionAnalysisManager::Invalidator &Inv);
+
+private:
+  ScalarEvolution &SE;
+  const DataLayout &DL;
+  DenseMap<BasicBlock*, LoopAccessSummary> summaries;   // Per header
+};
+
+struct LoopAccessSummaryAnalysis : AnalysisInfoMixin<LoopAccessSummaryAnalysis> {
+  using Result = LoopAccessSummaries;
+  Result run(Function &F, FunctionAnalysisManager &AM);
+  static AnalysisKey Key;
+};
+
+struct LoopAccessSummaryPrinterPass : PassInfoMixin<LoopAccessSummaryPrinterPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Loop Fusion (lf<max-chain=N>)
+struct LoopFusionOptions {
+  unsigned MaxChain = 0; // Loop fusi al più in uno solo (0: nessun limite)
+};
+Expected<LoopFusionOptions> parseLoopFusionOptions(StringRef Params); // LoopFusion.cpp
+
 struct LoopFusionPass : PassInfoMixin<LoopFusionPass> {
+  LoopFusionPass(LoopFusionOptions Opts = {}) : Opts(Opts) {}
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+  LoopFusionOptions Opts;
+};
+
+// Induction Variable Canonicalization
+struct InductionVariableCanonicalizationPass : PassInfoMixin<InductionVariableCanonicalizationPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Loop Versioning
+struct LoopVersioningPass : PassInfoMixin<LoopVersioningPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Loop Vectorization
+struct LoopVectorizationPass : PassInfoMixin<LoopVectorizationPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Scalar Replacement
+struct ScalarReplacementPass : PassInfoMixin<ScalarReplacementPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Array Contraction
+struct ArrayContractionPass : PassInfoMixin<ArrayContractionPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Loop Parallelization (par<min-iterations=N>)
+struct LoopParallelizationOptions {
+  unsigned MinIterations = 1024; // I loop con trip count costante minore restano sequenziali
+};
+Expected<LoopParallelizationOptions> parseLoopParallelizationOptions(StringRef Params); // LoopParallelization.cpp
+
+struct LoopParallelizationPass : PassInfoMixin<LoopParallelizationPass> {
+  LoopParallelizationPass(LoopParallelizationOptions Opts = {}) : Opts(Opts) {}
   PreservedAnalyses run(Function &F, FunctionAnalysisManager &);
   static bool isRequired() { return true; }
+  LoopParallelizationOptions Opts;
 };
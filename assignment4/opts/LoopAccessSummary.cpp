@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+// Loop Access Summary implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Analisi di funzione usata dalla LoopFusion (punto 4): invece di riscandire i corpi di entrambi i loop
+  per ogni coppia candidata, ogni loop viene riassunto una volta sola:
+    • Accessi in memoria raggruppati per oggetto base (getUnderlyingObject), per ognuno:
+      indirizzo alla prima e all'ultima iterazione (SCEV, range degli indirizzi), step costante, byte, lettura/scrittura
+    • Valori scalari definiti nel loop e usati fuori (live-out)
+    • Le altre istruzioni che toccano la memoria (chiamate, intrinseche come memset/memcpy, load/store volatili
+      o atomiche) non hanno un indirizzo e uno step: vengono solo elencate come accessi sconosciuti
+  I riassunti sono indicizzati per header (i Loop vengono ricreati quando la LoopFusion rianalizza LoopInfo)
+  e calcolati solo quando servono. Dopo una fusione il riassunto del loop fuso è l'unione dei due:
+  l'iterazione k del loop fuso esegue l'iterazione k di entrambi, quindi start e step restano validi.
+  Il risultato viene scartato insieme alla ScalarEvolution (invalidate): gli SCEV salvati non sarebbero più validi.
+
+  Stampa: opt -load-pass-plugin libLocalOpt.so -p "print<access-summary>" test.ll
+*/
+
+#include "LocalOpts.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+AnalysisKey LoopAccessSummaryAnalysis::Key;
+
+const LoopAccessSummary &LoopAccessSummaries::get(Loop &L) {
+  auto [It, inserted] = summaries.try_emplace(L.getHeader());
+  LoopAccessSummary &S = It->second;
+  if (!inserted) return S;
+
+  const SCEV *BTC = SE.getBackedgeTakenCount(&L);
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (any_of(I.users(), [&](User *U) { return !L.contains(cast<Instruction>(U)); }))
+        S.LiveOuts.push_back(&I);
+      if (!I.mayReadOrWriteMemory()) continue;
+      if (auto *II = dyn_cast<IntrinsicInst>(&I); II && II->isAssumeLikeIntrinsic()) continue; // assume, lifetime
+      auto *LI = dyn_cast<LoadInst>(&I);
+      auto *SI = dyn_cast<StoreInst>(&I);
+      if (!(LI && LI->isSimple()) && !(SI && SI->isSimple())) {
+        S.UnknownAccesses.push_back(&I);
+        continue;
+      }
+
+      Value *Ptr = getLoadStorePointerOperand(&I);
+      MemoryAccessInfo A = {&I, SE.getSCEV(Ptr), nullptr, std::nullopt, DL.getTypeStoreSize(getLoadStoreType(&I)),
+                            isa<StoreInst>(I)};
+
+      // Indirizzo affine sul loop con step costante, oppure invariante (step 0)
+      auto *AR = dyn_cast<SCEVAddRecExpr>(A.Start);
+      if (AR && AR->getLoop() == &L && AR->isAffine()) {
+        if (auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE))) A.Step = Step->getAPInt().getSExtValue();
+        A.Start = AR->getStart();
+        if (!isa<SCEVCouldNotCompute>(BTC)) A.End = AR->evaluateAtIteration(BTC, SE);
+      } else if (SE.isLoopInvariant(A.Start, &L)) {
+        A.Step = 0;
+        A.End = A.Start;
+      }
+
+      BaseAccessGroup &G = S.Groups[getUnderlyingObject(Ptr)];
+      G.Accesses.push_back(A);
+      G.HasWrites |= A.IsWrite;
+    }
+  }
+  return S;
+}
+
+void LoopAccessSummaries::merge(BasicBlock *Header1, BasicBlock *Header2) {
+  auto It2 = summaries.find(Header2);
+  auto It1 = summaries.find(Header1);
+  if (It1 == summaries.end() || It2 == summaries.end()) {
+    // Senza uno dei due riassunti quello del loop fuso verrà ricalcolato
+    summaries.erase(Header1);
+    summaries.erase(Header2);
+    return;
+  }
+
+  LoopAccessSummary &S1 = It1->second;
+  LoopAccessSummary S2 = std::move(It2->second);
+  summaries.erase(It2);
+  for (auto &[Base, G2] : S2.Groups) {
+    BaseAccessGroup &G1 = S1.Groups[Base];
+    G1.Accesses.append(G2.Accesses.begin(), G2.Accesses.end());
+    G1.HasWrites |= G2.HasWrites;
+  }
+  // NB: i live-out di L1 usati solo da L2 diventano interni, tenerli è conservativo (non ce ne sono se L2 non
+  // dipendeva da L1); le istruzioni eliminate dalla fusione (es. la IV di L2) vengono azzerate dai WeakVH
+  S1.LiveOuts.append(S2.LiveOuts.begin(), S2.LiveOuts.end());
+  S1.UnknownAccesses.append(S2.UnknownAccesses.begin(), S2.UnknownAccesses.end());
+}
+
+void LoopAccessSummaries::forget(BasicBlock *Header) { summaries.erase(Header); }
+
+bool LoopAccessSummaries::invalidate(Function &F, const PreservedAnalyses &PA, FunctionAnalysisManager::Invalidator &Inv) {
+  auto PAC = PA.getChecker<LoopAccessSummaryAnalysis>();
+  return !(PAC.preserved() || PAC.preservedSet<AllAnalysesOn<Function>>()) ||
+         Inv.invalidate<ScalarEvolutionAnalysis>(F, PA);
+}
+
+void LoopAccessSummary::print(raw_ostream &OS) const {
+  for (auto &[Base, G] : Groups) {
+    OS << "  Base ";
+    Base->printAsOperand(OS, false);
+    OS << (G.HasWrites ? " (read/write)" : " (read)") << ":\n";
+    for (const MemoryAccessInfo &A : G.Accesses) {
+      OS << "    " << (A.IsWrite ? "W " : "R ") << *A.Start;
+      if (A.Step) OS << " step " << *A.Step;
+      else OS << " step ?";
+      if (A.End) OS << " -> " << *A.End;
+      OS << " (" << A.Size << " bytes)\n";
+    }
+  }
+  for (Instruction *I : UnknownAccesses)
+    OS << "  Unknown access: " << *I << "\n";
+  for (const WeakVH &V : LiveOuts) {
+    if (V) OS << "  Live-out: " << *V << "\n";
+  }
+}
+
+LoopAccessSummaries LoopAccessSummaryAnalysis::run(Function &F, FunctionAnalysisManager &AM) {
+  return LoopAccessSummaries(AM.getResult<ScalarEvolutionAnalysis>(F), F.getParent()->getDataLayout());
+}
+
+PreservedAnalyses LoopAccessSummaryPrinterPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  LoopAccessSummaries &LAS = AM.getResult<LoopAccessSummaryAnalysis>(F);
+
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    outs() << "Loop ";
+    L->getHeader()->printAsOperand(outs(), false);
+    outs() << " (" << F.getName() << "):\n";
+    LAS.get(*L).print(outs());
+  }
+  return PreservedAnalyses::all();
+}
@@ -10,21 +10,45 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/APInt.h"        // per APInt
 #include "llvm/Analysis/PostDominators.h"
-#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"     // per isSafeToSpeculativelyExecute
+#include "llvm/Analysis/IVDescriptors.h"    // per RecurrenceDescriptor
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopRotationUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+#include <optional>
 
 using namespace llvm;
 
-int loop_counter; // Serve solo per l'output
+thread_local int loop_counter; // Serve solo per l'output (thread_local: ParallelOpt esegue il passo su più funzioni insieme)
 
 // Prototipi delle funzioni di utilità (sotto ogni corrispettivo punto)
 BasicBlock* getExitGuardSuccessor(Loop &L);                                                          // Punto 1 
-bool areGuardsEqual(BranchInst *G1, BranchInst *G2);                                                 // Punto 3
-bool haveNotNegativeMemoryDependencies(Loop &L1, Loop &L2, ScalarEvolution &SE, DependenceInfo &DI); // Punto 4
-bool haveNotNegativeScalarDependencies(Loop &L1, Loop &L2);                                          // Punto 4
-bool isLoopFusionValid(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE, DependenceInfo &DI);
+bool areGuardsEqual(Loop &L1, Loop &L2, ScalarEvolution &SE);                                        // Punto 3
+bool haveNotNegativeMemoryDependencies(const LoopAccessSummary &S1, const LoopAccessSummary &S2, ScalarEvolution &SE); // Punto 4
+bool haveNotNegativeScalarDependencies(const LoopAccessSummary &S1, Loop &L1, Loop &L2, ScalarEvolution &SE,
+                                       DominatorTree &DT);                                                      // Punto 4
+void collectUsesInLoop(Instruction *Def, Loop &L1, Loop &L2, DominatorTree &DT, SmallVectorImpl<Use*> &uses); // Punto 4
+const SCEV *getPrecomputableExitValue(Value *V, Loop &L1, ScalarEvolution &SE, SCEVExpander &Expander);       // Punto 4
+void rewriteExitValueUses(Loop &L1, Loop &L2, const LoopAccessSummary &S1, ScalarEvolution &SE, DominatorTree &DT); // Punto 4
+PHINode *getReductionOf(Instruction *I, Loop &L, ScalarEvolution &SE, DominatorTree &DT);                        // Punto 4
+bool haveNoUnknownAccesses(const LoopAccessSummary &S1, const LoopAccessSummary &S2);                             // Punto 4
+bool haveNoAliasBetweenArrays(const LoopAccessSummary &S1, const LoopAccessSummary &S2, AAResults &AA);            // Punto 4
+bool isLoopFusionValid(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE, AAResults &AA,
+                       LoopAccessSummaries &LAS);
+const SCEV *mapToLoop(const SCEV *S, Loop &From, Loop &To, ScalarEvolution &SE);                     // Punto 4 e merge
+bool canMergeRotated(Loop &L1, Loop &L2, const LoopAccessSummary &S1, ScalarEvolution &SE, DominatorTree &DT); // Punto 5
+bool collectHoistable(BasicBlock *BB, Instruction *InsertPt, DominatorTree &DT, SmallPtrSetImpl<Instruction*> &hoisted); // Punto 5
+bool isReplaceableInduction(PHINode &Phi, Loop &L, ScalarEvolution &SE);                                  // Punto 5 e merge
+bool canMergeHeaderPhis(Loop &L2, ScalarEvolution &SE);                                                   // Punto 5
 void printBlock(std::string s, BasicBlock *BB); // Stampa un blocco con il suo nome
 
 
@@ -40,7 +64,7 @@ void printBlock(std::string s, BasicBlock *BB); // Stampa un blocco con il suo n
 bool areAdjacent(Loop &L1, Loop &L2){
 
   //Controllo che i due Loop siano adiacenti
-  bool blocksAdjacent = (L1.isGuarded() && getExitGuardSuccessor(L1) == L2.getLoopGuardBranch()->getParent()) || // Guarded
+  bool blocksAdjacent = (L1.isGuarded() && L2.isGuarded() && getExitGuardSuccessor(L1) == L2.getLoopGuardBranch()->getParent()) || // Guarded
                         (!L1.isGuarded() && L1.getExitBlock() == L2.getLoopPreheader());
   printBlock("L1 exit block", L1.getExitBlock());
   printBlock("L2 preheader block", L2.getLoopPreheader());
@@ -52,11 +76,15 @@ bool areAdjacent(Loop &L1, Loop &L2){
 
     for (Instruction &I : *firstL2) {
       if (isa<BranchInst>(&I)) break; // Fino all'istruzione di branch 
+      // Non guarded: le PHI (LCSSA) del preheader di L2 portano i valori finali di L1 dopo i loop, i loro usi
+      // dentro L2 sono controllati al punto 4
+      if (!L1.isGuarded() && isa<PHINode>(&I)) continue;
 
       for (Value *Op : I.operands()) {
         outs() << "Operando: " << *Op << "\n";
         if (Instruction *Def = dyn_cast<Instruction>(Op)) {
-          if (L1.contains(Def)) {
+          // NB: un'istruzione che usa una PHI LCSSA dipende da L1 come se usasse il valore direttamente
+          if (L1.contains(Def) || (!L1.isGuarded() && isa<PHINode>(Def) && Def->getParent() == firstL2)) {
             if (L1.isGuarded()){
               // Controlliamo se ha un uso dentro il Loop 2
               for (User *U : I.users()) {
@@ -123,9 +151,9 @@ bool haveSameIteration(Loop &L1, Loop &L2, ScalarEvolution &SE){
 * When Lj executes Lk also executes or when Lk executes Lj also executes 
 * NB: Punto 0 -> se L1 è guarded, L2 è guarded e viceversa
 **/
-bool isControlFlowEquivalent(Loop &L1, Loop &L2, DominatorTree &DT, PostDominatorTree &PDT) {
+bool isControlFlowEquivalent(Loop &L1, Loop &L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE) {
   // Se sono guarded: le guardie devono essere semanticamente equivalenti, altrimenti controllo *solo* dominanza/post-dominanza
-  if (L1.isGuarded() && !areGuardsEqual(L1.getLoopGuardBranch(), L2.getLoopGuardBranch())){
+  if (L1.isGuarded() && !areGuardsEqual(L1, L2, SE)){
     outs() << "-> le guardie non sono semanticamente uguali \n";
     return false;
   }
@@ -137,16 +165,41 @@ bool isControlFlowEquivalent(Loop &L1, Loop &L2, DominatorTree &DT, PostDominato
   return (DT.dominates(L1_block, L2_block) && PDT.dominates(L2_block, L1_block)); // True se L1 domina L2 ed L2 postdomina L1
 }
 
+// Condizione con cui la guardia entra nel loop, come predicato tra due SCEV
+// NB: se il loop è sul ramo "false" della guardia si usa il predicato inverso (es. br (n <= 0), exit, loop -> n > 0)
+bool getGuardCondition(Loop &L, ScalarEvolution &SE, ICmpInst::Predicate &Pred, const SCEV *&LHS, const SCEV *&RHS) {
+  BranchInst *guard = L.getLoopGuardBranch();
+  auto *icmp = dyn_cast<ICmpInst>(guard->getCondition());
+  if (!icmp || !SE.isSCEVable(icmp->getOperand(0)->getType())) return false;
+
+  Pred = guard->getSuccessor(0) == L.getLoopPreheader() ? icmp->getPredicate() : icmp->getInversePredicate();
+  LHS = SE.getSCEV(icmp->getOperand(0));
+  RHS = SE.getSCEV(icmp->getOperand(1));
+
+  // Forma normale: costanti a destra, predicati non stretti resi stretti (es. 0 < n -> n > 0, n >= 1 -> n > 0)
+  SE.SimplifyICmpOperands(Pred, LHS, RHS);
+  return true;
+}
+
 // Controlla se le due guardie sono semanticamente equivalenti
-bool areGuardsEqual(BranchInst *G1, BranchInst *G2) {
+// Le condizioni sono confrontate con SCEV e non come istruzioni: "n > 0" e "0 < n", oppure la stessa condizione
+// ricalcolata dopo il primo loop, sono la stessa guardia
+bool areGuardsEqual(Loop &L1, Loop &L2, ScalarEvolution &SE) {
   bool areEqual = false;
+  ICmpInst::Predicate Pred1, Pred2;
+  const SCEV *LHS1, *RHS1, *LHS2, *RHS2;
 
-  // Se sono entrambi Branch Condizionali, ritorna se le condizioni sono equivalenti
-  if (G1->isConditional() && G2->isConditional()) {
-    auto *icmp1 = dyn_cast<ICmpInst>(G1->getCondition());
-    auto *icmp2 = dyn_cast<ICmpInst>(G2->getCondition());
+  if (getGuardCondition(L1, SE, Pred1, LHS1, RHS1) && getGuardCondition(L2, SE, Pred2, LHS2, RHS2)) {
+    outs() << "-> Guard L1: " << *LHS1 << " " << CmpInst::getPredicateName(Pred1) << " " << *RHS1 << "\n";
+    outs() << "-> Guard L2: " << *LHS2 << " " << CmpInst::getPredicateName(Pred2) << " " << *RHS2 << "\n";
 
-    areEqual = (icmp1 && icmp2 && icmp1->isIdenticalTo(icmp2)); 
+    if (Pred1 != Pred2) {
+      Pred2 = CmpInst::getSwappedPredicate(Pred2);
+      std::swap(LHS2, RHS2);
+    }
+
+    areEqual = Pred1 == Pred2 && SE.isKnownPredicate(ICmpInst::ICMP_EQ, LHS1, LHS2) &&
+               SE.isKnownPredicate(ICmpInst::ICMP_EQ, RHS1, RHS2);
   }
 
   if (areEqual) 
@@ -164,105 +217,398 @@ bool areGuardsEqual(BranchInst *G1, BranchInst *G2) {
 * A negative distance dependence occurs between Lj and Lk, Lj before Lk, when at iteration m from Lk uses 
 * a value that is computed by Lj at a future iteration m+n (where n > 0).
 **/
-bool haveNotNegativeDependencies(Loop &L1, Loop &L2, ScalarEvolution &SE, DependenceInfo &DI) {
-  return (haveNotNegativeMemoryDependencies(L1, L2, SE, DI) && haveNotNegativeScalarDependencies(L1, L2));
+// I controlli usano i riassunti dei due loop (LoopAccessSummary.cpp), calcolati una volta sola per loop
+bool haveNotNegativeDependencies(Loop &L1, Loop &L2, ScalarEvolution &SE, DominatorTree &DT, AAResults &AA,
+                                 LoopAccessSummaries &LAS) {
+  const LoopAccessSummary &S1 = LAS.get(L1);
+  const LoopAccessSummary &S2 = LAS.get(L2);
+  return (haveNoUnknownAccesses(S1, S2) && haveNoAliasBetweenArrays(S1, S2, AA) && haveNotNegativeMemoryDependencies(S1, S2, SE) &&
+          haveNotNegativeScalarDependencies(S1, L1, L2, SE, DT));
 }
 
-bool haveNotNegativeMemoryDependencies(Loop &L1, Loop &L2, ScalarEvolution &SE, DependenceInfo &DI) {
-  // Ci serve l'indirizzo di A
-  // Poi dobbiamo vedere se l'offset di A nel secondo loop è un phi o un add di un valore positivo
-  // Allora non c'è distanza negativa se anche nel primo loop c'è un'istruzione con un phi o un'istruzione con lo stesso valore positivo (corrispettivamente) 
-  
-  for(BasicBlock* BB: L1.blocks()) {
-    for(Instruction &I : *BB) {
-      auto *storeGEP = dyn_cast<GetElementPtrInst>(&I);
-      if (!storeGEP) continue;
-      
-      auto *storeInst = dyn_cast<StoreInst>(storeGEP->getNextNode()); 
-      if (!storeInst) continue; // In L1 consideriamo solo Store
-
-      for (auto &U : storeGEP->getPointerOperand()->uses()) {
-        Instruction* user = dyn_cast<Instruction>(U.getUser());
-        if (!user || !L2.contains(user)) continue; 
-
-        // Accediamo allo stesso array
-        auto *storeOrLoadGEP = dyn_cast<GetElementPtrInst>(user);
-        if (!storeOrLoadGEP) continue;
-
-        outs() << "   Store instruction after GEP: " << *storeGEP << "\n";
-        outs() << "   Load instruction after GEP2: " << *storeOrLoadGEP << "\n";
-
-        // NB: evitiamo di usare depends perchè la dipendenza è controllata manualmente
-        // Calcoliamo la differenza tra i due valori SCEV degli ElementPtr
-        const SCEV *storeSCEV = SE.getSCEVAtScope(storeGEP, &L1); // SCEV con il contesto del loop
-        const SCEV *storeOrLoadSCEV = SE.getSCEVAtScope(storeOrLoadGEP, &L2);
-        const SCEV *Diff = SE.getMinusSCEV(storeOrLoadSCEV, storeSCEV);
-
-        // 5 -> AddExpr
-        // 8 -> AddRecExpr ("dipendente dall'indice del loop")
-        outs() << "   Normalized SCEV (type: " << storeSCEV->getSCEVType() << ") Store: " << *storeSCEV << "\n"; 
-        outs() << "   Normalized SCEV (type: " << storeOrLoadSCEV->getSCEVType() << ") Load: " << *storeOrLoadSCEV << "\n";
-        outs() << "   Difference SCEV (type: " << Diff->getSCEVType() << ") Diff: " << *Diff << "\n"; 
-
-        // Preleviamo il primissimo operando, differenza i due offset 
-        const SCEV *temp = Diff; 
-        const SCEVConstant *ConstDiff = dyn_cast<SCEVConstant>(temp);
-        
-        while(!ConstDiff){
-          temp = temp->operands()[0]; 
-          ConstDiff = dyn_cast<SCEVConstant>(temp);
+// Chiamate, memset/memcpy e accessi volatili non hanno indirizzo e step nel riassunto: la distanza dagli accessi
+// dell'altro loop non è calcolabile, quindi non si fonde
+bool haveNoUnknownAccesses(const LoopAccessSummary &S1, const LoopAccessSummary &S2) {
+  for (const LoopAccessSummary *S : {&S1, &S2}) {
+    if (!S->UnknownAccesses.empty()) {
+      outs() << "-> Unknown memory access: " << *S->UnknownAccesses.front() << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+// Accessi a basi diverse (es. A[i] e B[i]) vengono confrontati solo se non possono sovrapporsi:
+// con array passati come puntatori AA non lo sa dimostrare, a meno dei metadati no-alias del passo "lvr" (LoopVersioning.cpp)
+bool haveNoAliasBetweenArrays(const LoopAccessSummary &S1, const LoopAccessSummary &S2, AAResults &AA) {
+  for (auto &[Base1, G1] : S1.Groups) {
+    for (auto &[Base2, G2] : S2.Groups) {
+      if (Base1 == Base2 || (!G1.HasWrites && !G2.HasWrites)) continue; // Due letture non sono una dipendenza
+      // Oggetti diversi e identificati (alloca, globali, argomenti noalias): nessun accesso dell'uno tocca l'altro
+      if (isIdentifiedObject(Base1) && isIdentifiedObject(Base2)) continue;
+
+      for (const MemoryAccessInfo &A1 : G1.Accesses) {
+        for (const MemoryAccessInfo &A2 : G2.Accesses) {
+          if (!A1.IsWrite && !A2.IsWrite) continue;
+          if (mayAliasAcrossArrays(*A1.I, *A2.I, AA)) {
+            outs() << "-> Possible alias: " << *A1.I << " / " << *A2.I << "\n";
+            return false;
+          }
         }
-        
-        int offset = ConstDiff->getValue()->getSExtValue();
-        outs() << "   Offset: " << offset << "\n";
+      }
+    }
+  }
+  return true;
+}
 
-        // Verifichiamo che la differenza tra le due SCEV sia una SCEVAddRecExpr
-        // NB: SCEVAddRecExpr -> ricorrenza polinomiale sul trip count del ciclo specificato
-        const SCEVAddRecExpr *DiffRec = dyn_cast<SCEVAddRecExpr>(Diff);
-        if (!DiffRec) return false;
+// Load/store su basi diverse che AA non sa separare
+// NB: con la stessa base la distanza tra gli accessi è controllata con SCEV (haveNotNegativeMemoryDependencies)
+// Gli accessi vengono confrontati in iterazioni diverse: MemoryLocation::get (stessa iterazione, dimensione esatta)
+// potrebbe separare puntatori che si sovrappongono più avanti (es. select/PHI di basi, sotto-oggetti sovrapposti),
+// quindi si confronta tutto l'oggetto base (come ScalarReplacement.cpp), tenendo i metadati no-alias di "lvr"
+bool mayAliasAcrossArrays(Instruction &I1, Instruction &I2, AAResults &AA) {
+  const Value *Base1 = getUnderlyingObject(getLoadStorePointerOperand(&I1));
+  const Value *Base2 = getUnderlyingObject(getLoadStorePointerOperand(&I2));
+  if (Base1 == Base2) return false;
+  return !AA.isNoAlias(MemoryLocation::getBeforeOrAfter(Base1, I1.getAAMetadata()),
+                       MemoryLocation::getBeforeOrAfter(Base2, I2.getAAMetadata()));
+}
 
-        const SCEV *Step = DiffRec->getStepRecurrence(SE); // Dove tra L1 e L2 dovrebbe essere uguale dato il secondo punto e nel caso stessa guardia
-        const SCEVConstant *ConstStep = dyn_cast<SCEVConstant>(Step);
-        if(!ConstStep) return false;
+// Range degli indirizzi [Lo, Hi) toccati da un accesso in tutte le iterazioni, false se non calcolabile
+bool getAccessRange(const MemoryAccessInfo &A, ScalarEvolution &SE, const SCEV *&Lo, const SCEV *&Hi) {
+  if (!A.Step || !A.End) return false;
+  Lo = *A.Step >= 0 ? A.Start : A.End;
+  Hi = SE.getAddExpr(*A.Step >= 0 ? A.End : A.Start, SE.getConstant(SE.getEffectiveSCEVType(A.Start->getType()), A.Size));
+  return true;
+}
 
-        int step = ConstStep->getValue()->getSExtValue();
+// Gli accessi toccano range di indirizzi disgiunti (es. L1 scrive A[0..n), L2 legge A[n..2n))
+bool areDisjoint(const MemoryAccessInfo &A1, const MemoryAccessInfo &A2, ScalarEvolution &SE) {
+  const SCEV *Lo1, *Hi1, *Lo2, *Hi2;
+  if (!getAccessRange(A1, SE, Lo1, Hi1) || !getAccessRange(A2, SE, Lo2, Hi2)) return false;
+
+  // NB: con basi SCEV diverse la differenza non è calcolabile
+  auto isKnownLE = [&](const SCEV *X, const SCEV *Y) {
+    const SCEV *Diff = SE.getMinusSCEV(Y, X);
+    return !isa<SCEVCouldNotCompute>(Diff) && SE.isKnownNonNegative(Diff);
+  };
+  return isKnownLE(Hi1, Lo2) || isKnownLE(Hi2, Lo1);
+}
+
+bool haveNotNegativeMemoryDependencies(const LoopAccessSummary &S1, const LoopAccessSummary &S2, ScalarEvolution &SE) {
+  // Stesso oggetto base in entrambi i loop, almeno una scrittura (anche L1 che legge e L2 che scrive:
+  // dopo la fusione L1 leggerebbe il valore già scritto da L2 in un'iterazione precedente)
+  for (auto &[Base, G1] : S1.Groups) {
+    auto It = S2.Groups.find(Base);
+    if (It == S2.Groups.end()) continue;
+    const BaseAccessGroup &G2 = It->second;
+    if (!G1.HasWrites && !G2.HasWrites) continue;
+
+    for (const MemoryAccessInfo &A1 : G1.Accesses) {
+      for (const MemoryAccessInfo &A2 : G2.Accesses) {
+        if (!A1.IsWrite && !A2.IsWrite) continue;
+
+        outs() << "   L1 access: " << *A1.I << "\n";
+        outs() << "   L2 access: " << *A2.I << "\n";
+
+        if (areDisjoint(A1, A2, SE)) {
+          outs() << "   Disjoint address ranges\n";
+          continue;
+        }
+
+        // Entrambi gli indirizzi devono essere ricorrenze con lo stesso step costante: con step diversi
+        // la distanza cambia ad ogni iterazione (e non possiamo escludere una dipendenza negativa)
+        // NB: l'iterazione k di L2 viene eseguita insieme all'iterazione k di L1, anche se le variabili di induzione
+        // sono diverse (es. una cresce e l'altra decresce): basta confrontare start e step
+        if (!A1.Step || !A2.Step || *A1.Step == 0 || *A1.Step != *A2.Step) {
+          outs() << "-> The accesses do not have the same constant step\n";
+          return false;
+        }
+
+        const SCEVConstant *ConstDiff = dyn_cast<SCEVConstant>(SE.getMinusSCEV(A2.Start, A1.Start));
+        if (!ConstDiff) {
+          outs() << "-> The distance between the accesses is not constant\n";
+          return false;
+        }
+
+        int64_t offset = ConstDiff->getAPInt().getSExtValue();
+        int64_t step = *A1.Step;
+        int64_t size1 = A1.Size, size2 = A2.Size;
+        outs() << "   Offset: " << offset << "\n";
         outs() << "   Step value: " << step << "\n";
-      
-        // Se step è negativo, allora offset negativo = dipendenza negativa
-        if ((step > 0 && offset > 0) || (step < 0 && offset < 0)) {
+        outs() << "   Sizes: " << size1 << ", " << size2 << "\n";
+
+        // L'iterazione k di L2 non deve toccare i byte di un'iterazione successiva di L1 (k+1 è la più vicina).
+        // Rispetto all'accesso di L1 all'iterazione k: con step positivo i byte di L2 [offset, offset + size2)
+        // devono finire entro step, con step negativo quelli di L1 alla k+1 [step, step + size1) entro offset
+        // NB: non basta il segno di offset, es. una lettura di 8 byte a offset 0 su un array di i32 scritto con step 4
+        if ((step > 0 && offset + size2 > step) || (step < 0 && step + size1 > offset)) {
           outs() << "-> Negative dependency found due to offset " << offset << " with step " << step << "\n";
           return false;
         }
+      }
+    }
+  }
+
+  return true;
+}
+
+// Riporta una ricorrenza {start,+,step}<From> sul loop To (stesso trip count: stessa iterazione k)
+const SCEV *mapToLoop(const SCEV *S, Loop &From, Loop &To, ScalarEvolution &SE) {
+  auto *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (!AR || AR->getLoop() != &From) return S;
+
+  SmallVector<const SCEV*, 4> operands(AR->operands());
+  return SE.getAddRecExpr(operands, &To, SCEV::FlagAnyWrap);
+}
+
+// Usi dentro L2 di un valore di L1, anche attraverso le PHI tra i due loop (LCSSA nell'exit di L1, PHI della guardia di L2)
+void collectUsesInLoop(Instruction *Def, Loop &L1, Loop &L2, DominatorTree &DT, SmallVectorImpl<Use*> &uses) {
+  SmallVector<Instruction*, 4> worklist = {Def};
+  SmallPtrSet<Instruction*, 4> visited;
+  while (!worklist.empty()) {
+    Instruction *I = worklist.pop_back_val();
+    if (!visited.insert(I).second) continue;
+
+    for (Use &U : I->uses()) {
+      auto *UserInst = cast<Instruction>(U.getUser());
+      if (L2.contains(UserInst))
+        uses.push_back(&U);
+      else if (isa<PHINode>(UserInst) && !L1.contains(UserInst) && DT.dominates(UserInst->getParent(), L2.getLoopPreheader()))
+        worklist.push_back(UserInst);
+    }
+  }
+}
+
+// Valore finale di V dopo L1 calcolabile prima di L1 (es. la IV: start + trip count * step), nullptr altrimenti
+const SCEV *getPrecomputableExitValue(Value *V, Loop &L1, ScalarEvolution &SE, SCEVExpander &Expander) {
+  if (!SE.isSCEVable(V->getType())) return nullptr;
+
+  const SCEV *S = SE.getSCEVAtScope(V, L1.getParentLoop());
+  if (isa<SCEVCouldNotCompute>(S) || !SE.isLoopInvariant(S, &L1) ||
+      !Expander.isSafeToExpandAt(S, L1.getLoopPreheader()->getTerminator()))
+    return nullptr;
+  return S;
+}
 
-        // Nessuna condizione negativa, quindi controlliamo le prossime istruzioni
-      }  
-    } 
+// PHI della riduzione di L (RecurrenceDescriptor) di cui I è il valore (la PHI o il valore al latch), nullptr se nessuna
+PHINode *getReductionOf(Instruction *I, Loop &L, ScalarEvolution &SE, DominatorTree &DT) {
+  for (PHINode &Phi : L.getHeader()->phis()) {
+    RecurrenceDescriptor RD;
+    if (RecurrenceDescriptor::isReductionPHI(&Phi, &L, RD, nullptr, nullptr, &DT, &SE) &&
+        (I == &Phi || I == RD.getLoopExitInstr()))
+      return &Phi;
   }
+  return nullptr;
+}
+
+// Controlla se c'è una dipendenza negativa tra scalari tra due loop: L2 usa un valore calcolato dentro L1
+// Dopo i loop L2 vede solo il valore finale di L1: se SCEV lo sa calcolare prima di L1 (IV e ricorrenze affini)
+// l'uso viene sostituito prima della fusione (rewriteExitValueUses), altrimenti (es. riduzioni) la fusione
+// farebbe leggere a L2 un valore parziale
+bool haveNotNegativeScalarDependencies(const LoopAccessSummary &S1, Loop &L1, Loop &L2, ScalarEvolution &SE,
+                                       DominatorTree &DT) {
+  SCEVExpander Expander(SE, L1.getHeader()->getModule()->getDataLayout(), "lf");
+  for (const WeakVH &V : S1.LiveOuts) {
+    auto *Def = dyn_cast_or_null<Instruction>(V);
+    if (!Def) continue;
+
+    SmallVector<Use*, 4> uses;
+    collectUsesInLoop(Def, L1, L2, DT, uses);
+    for (Use *U : uses) {
+      auto *I2 = cast<Instruction>(U->getUser());
+      if (getPrecomputableExitValue(U->get(), L1, SE, Expander)) {
+        outs() << "-> " << *I2 << " uses the final value of " << *Def << ", computed before L1\n";
+        continue;
+      }
 
+      if (PHINode *Reduction = getReductionOf(Def, L1, SE, DT))
+        outs() << "-> Negative dependency: " << *I2 << " -> uses the final value of the reduction: " << *Reduction << "\n";
+      else
+        outs() << "-> Negative dependency: " << *I2 << " -> depends on non-invariant: " << *Def << "\n";
+      return false;
+    }
+  }
   return true;
 }
 
-// Controlla se c'è una dipendenza negativa tra scalari tra due loop (scalari)
-bool haveNotNegativeScalarDependencies(Loop &L1, Loop &L2) {
-  for (BasicBlock *BB2 : L2.blocks()) {
-    for (Instruction &I2 : *BB2) {
-      for (Value *Op : I2.operands()) {
-        if (Instruction *Def = dyn_cast<Instruction>(Op)) {
-          if (L1.contains(Def) && !L1.isLoopInvariant(Def)) {
-            outs() << "-> Negative dependency: " << I2 << " -> depends on non-invariant: " << *Def << "\n";
-            return false;
-          }
+// Gli usi in L2 dei valori finali calcolabili di L1 (controllati da haveNotNegativeScalarDependencies) vengono
+// calcolati nel preheader di L1: nel loop fuso L2 non li legge più da L1 a metà
+void rewriteExitValueUses(Loop &L1, Loop &L2, const LoopAccessSummary &S1, ScalarEvolution &SE, DominatorTree &DT) {
+  SCEVExpander Expander(SE, L1.getHeader()->getModule()->getDataLayout(), "lf");
+  for (const WeakVH &V : S1.LiveOuts) {
+    auto *Def = dyn_cast_or_null<Instruction>(V);
+    if (!Def) continue;
+
+    SmallVector<Use*, 4> uses;
+    collectUsesInLoop(Def, L1, L2, DT, uses);
+    for (Use *U : uses) {
+      const SCEV *S = getPrecomputableExitValue(U->get(), L1, SE, Expander);
+      Value *Exit = Expander.expandCodeFor(S, U->get()->getType(), L1.getLoopPreheader()->getTerminator());
+      outs() << "Final value of " << *U->get() << " used by L2: " << *Exit << "\n";
+      U->set(Exit);
+    }
+  }
+}
+
+/** ----- Punto 5 ----- 
+* Solo per i loop ruotati (test di uscita nel latch, guarded oppure no): la struttura deve essere quella che mergeRotated sa fondere
+*
+* Guarded:      G1 -> PH1 -> L1 -> Exit1 -> G2 -> PH2 -> L2 -> Exit2 -> Join2   (G1 e G2 saltano a Join1 = G2 e Join2 se n <= 0)
+* Non guarded:  PH1 -> L1 -> Exit1 = PH2 -> L2 -> Exit2
+* Le istruzioni di G2 (tranne le PHI) e di PH2 vengono anticipate in G1 e PH1: devono essere speculabili e non toccare la memoria
+* Non ruotati: merge elimina il latch di L2, che deve contenere solo l'aggiornamento delle IV (canMergeHeaderPhis)
+**/
+bool canMergeRotated(Loop &L1, Loop &L2, const LoopAccessSummary &S1, ScalarEvolution &SE, DominatorTree &DT) {
+  for (Loop *L : {&L1, &L2}) {
+    auto *latchBranch = dyn_cast<BranchInst>(L->getLoopLatch()->getTerminator());
+    if (!L->isLoopSimplifyForm() || L->getExitingBlock() != L->getLoopLatch() || !latchBranch ||
+        !latchBranch->isConditional() || !L->getUniqueExitBlock()) {
+      outs() << "-> Loop " << L->getHeader()->getName() << " has not a single exit in the latch\n";
+      return false;
+    }
+  }
+
+  BasicBlock *preHeaderL1 = L1.getLoopPreheader();
+  BasicBlock *preHeaderL2 = L2.getLoopPreheader();
+  SmallPtrSet<Instruction*, 16> hoisted;
+
+  if (L1.isGuarded()) {
+    BasicBlock *guardL1 = L1.getLoopGuardBranch()->getParent();
+    BasicBlock *guardL2 = L2.getLoopGuardBranch()->getParent();
+    BasicBlock *joinL2 = getExitGuardSuccessor(L2);
+
+    if (L1.getExitBlock()->getSingleSuccessor() != guardL2 || L2.getExitBlock()->getSingleSuccessor() != joinL2 ||
+        pred_size(guardL2) != 2 || pred_size(joinL2) != 2 || isa<PHINode>(preHeaderL2->front())) {
+      outs() << "-> The blocks between the guards are not in the expected form\n";
+      return false;
+    }
+
+    if (!collectHoistable(guardL2, guardL1->getTerminator(), DT, hoisted)) {
+      outs() << "-> The guard of L2 cannot be hoisted in the guard of L1\n";
+      return false;
+    }
+  } else if (L1.getExitBlock() != preHeaderL2) {
+    outs() << "-> The exit block of L1 is not the preheader of L2\n";
+    return false;
+  }
+
+  if (!collectHoistable(preHeaderL2, preHeaderL1->getTerminator(), DT, hoisted)) {
+    outs() << "-> The preheader of L2 cannot be hoisted in the preheader of L1\n";
+    return false;
+  }
+
+  // Gli usi dei valori finali di L1 calcolabili prima di L1 vengono sostituiti da rewriteExitValueUses prima del merge
+  SCEVExpander Expander(SE, L1.getHeader()->getModule()->getDataLayout(), "lf");
+  SmallPtrSet<Use*, 8> rewritten;
+  for (const WeakVH &V : S1.LiveOuts) {
+    auto *Def = dyn_cast_or_null<Instruction>(V);
+    if (!Def) continue;
+
+    SmallVector<Use*, 4> uses;
+    collectUsesInLoop(Def, L1, L2, DT, uses);
+    for (Use *U : uses)
+      if (getPrecomputableExitValue(U->get(), L1, SE, Expander))
+        rewritten.insert(U);
+  }
+
+  // Dopo la fusione L2 parte da PH1: i valori che usa da fuori devono essere già disponibili lì
+  for (BasicBlock *BB : L2.blocks()) {
+    for (Instruction &I : *BB) {
+      for (Use &U : I.operands()) {
+        auto *Def = dyn_cast<Instruction>(U.get());
+        if (Def && !L2.contains(Def) && !hoisted.count(Def) && !rewritten.count(&U) &&
+            !DT.dominates(Def, preHeaderL1->getTerminator())) {
+          outs() << "-> " << I << " uses " << *Def << ", not available before L1\n";
+          return false;
         }
       }
     }
   }
+
   return true;
 }
 
-// Fonde i due loop L1 e L2
-void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE, DependenceInfo &DI, Function &F){
+// Istruzioni di BB (escluse PHI e terminatore) che si possono spostare prima di InsertPt
+// NB: gli operandi devono dominare InsertPt oppure essere a loro volta spostati (hoisted)
+bool collectHoistable(BasicBlock *BB, Instruction *InsertPt, DominatorTree &DT, SmallPtrSetImpl<Instruction*> &hoisted) {
+  for (Instruction &I : *BB) {
+    if (isa<PHINode>(&I) || &I == BB->getTerminator()) continue;
+    if (I.mayReadOrWriteMemory() || !isSafeToSpeculativelyExecute(&I)) {
+      outs() << "-> Cannot hoist: " << I << "\n";
+      return false;
+    }
+
+    for (Value *Op : I.operands()) {
+      auto *Def = dyn_cast<Instruction>(Op);
+      if (Def && !hoisted.count(Def) && !DT.dominates(Def, InsertPt)) {
+        outs() << "-> Cannot hoist: " << I << " (operand " << *Def << ")\n";
+        return false;
+      }
+    }
+    hoisted.insert(&I);
+  }
+  return true;
+}
+
+// Non ruotati: le PHI di L2 che non sono IV (riduzioni e altre ricorrenze) restano separate nell'header fuso con il
+// valore che arriva dal corpo di L2; non possono prenderlo dal latch di L2, che viene eliminato
+bool canMergeHeaderPhis(Loop &L2, ScalarEvolution &SE) {
+  BasicBlock *latchL2 = L2.getLoopLatch();
+  for (PHINode &Phi : L2.getHeader()->phis()) {
+    if (isReplaceableInduction(Phi, L2, SE)) continue;
+
+    RecurrenceDescriptor RD;
+    bool isReduction = RecurrenceDescriptor::isReductionPHI(&Phi, &L2, RD, nullptr, nullptr, nullptr, &SE);
+    outs() << "-> " << (isReduction ? "Reduction" : "Recurrence") << " of L2: " << Phi << "\n";
+
+    auto *Next = dyn_cast<Instruction>(Phi.getIncomingValueForBlock(latchL2));
+    if (Next && Next->getParent() == latchL2) {
+      outs() << "-> Its next value is computed in the latch of L2: " << *Next << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Sostituzione delle variabili di induzione di L2
+* Ogni IV di L2 è una ricorrenza affine {start,+,step}<L2>: con lo stesso trip count, all'iterazione k vale start + step * k,
+* cioè la stessa ricorrenza su L1. SCEVExpander la calcola nell'header di L1 a partire dalla IV canonica di L1
+* (creandola se L1 non ne ha una, es. loop che decresce) oppure riusa direttamente una IV di L1 con gli stessi valori.
+* Così si fondono anche loop con IV diverse: for(i=9; i>=0; i--) con for(j=0; j<10; j++) -> j = 9 - i
+* Le riduzioni (es. b += 1, affine anche lei) restano PHI separate nell'header fuso, accanto a quelle di L1
+**/
+bool isReplaceableInduction(PHINode &Phi, Loop &L, ScalarEvolution &SE) {
+  if (!SE.isSCEVable(Phi.getType())) return false;
+
+  auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&Phi));
+  if (!AR || AR->getLoop() != &L || !AR->isAffine() || !SE.isLoopInvariant(AR->getStepRecurrence(SE), &L)) return false;
+
+  RecurrenceDescriptor RD;
+  return !RecurrenceDescriptor::isReductionPHI(&Phi, &L, RD, nullptr, nullptr, nullptr, &SE);
+}
+
+void replaceInductionVariables(Loop &L1, Loop &L2, ScalarEvolution &SE, const DataLayout &DL) {
+  SCEVExpander Expander(SE, DL, "lf");
+  SmallVector<PHINode*> inductionVariablesL2;
+
+  for (PHINode &Phi : L2.getHeader()->phis()) {
+    if (isReplaceableInduction(Phi, L2, SE)) inductionVariablesL2.push_back(&Phi);
+  }
+
+  for (PHINode *Phi : inductionVariablesL2) {
+    const SCEV *IV = mapToLoop(SE.getSCEV(Phi), L2, L1, SE);
+    Value *New = Expander.expandCodeFor(IV, Phi->getType(), &*L1.getHeader()->getFirstInsertionPt());
+
+    outs() << "Induction Variable L2: " << *Phi << " -> " << *New << "\n";
+    Phi->replaceAllUsesWith(New);
+    Phi->eraseFromParent();
+  }
+}
+
+// Fonde i due loop L1 e L2 (non ruotati: test di uscita nell'header, senza guardia)
+void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE, Function &F){
   // Blocchi L1
-  BasicBlock *guardL1 = L1->isGuarded() ? L1->getLoopGuardBranch()->getParent() : nullptr;
   BasicBlock *preHeaderL1 = L1->getLoopPreheader();
   BasicBlock *headerL1 = L1->getHeader();
   BasicBlock *latchL1 = L1->getLoopLatch();
@@ -281,7 +627,6 @@ void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, Scalar
   printBlock("L1 Exit Block", exitL1);
 
   // Blocchi L2
-  BasicBlock *guardL2 = L2->isGuarded() ? L2->getLoopGuardBranch()->getParent() : nullptr;
   BasicBlock *preHeaderL2 = L2->getLoopPreheader();
   BasicBlock *headerL2 = L2->getHeader();
   BasicBlock *latchL2 = L2->getLoopLatch();
@@ -299,53 +644,11 @@ void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, Scalar
   printBlock("L2 Exiting Block", exitingL2);
   printBlock("L2 Exit Block", exitL2);
 
-  /* Sostituzione degli usi della induction variable di L2 con quella di L1 */
-  PHINode *inductionVariableL1 = L1->getCanonicalInductionVariable();
-  PHINode *inductionVariableL2 = L2->getCanonicalInductionVariable();
-
-  outs() << "Induction Variable L1: " << *inductionVariableL1 << "\n";
-  outs() << "Induction Variable L2: " << *inductionVariableL2 << "\n";
-  
-  // STEP 1: Sostituzione della variabile di induzione di L2 con quella di L1
-  inductionVariableL2->replaceAllUsesWith(inductionVariableL1);
-  inductionVariableL2->eraseFromParent(); // Rimuove l'induction variable di L2
-  
-  // GUARDIA: non ben funzionante
-  if(guardL1) {
-    // GUARDIA 1: Modificando la variabile di induzione potremmo avere delle dipendenze negative
-    if(!haveNotNegativeDependencies(*L1, *L2, SE, DI)){
-      outs() << "Dipendenza negativa con stesso indice di loop \n";
-      return;
-    }
-
-    printBlock("L1 Guard successor exit old: ", getExitGuardSuccessor(*L1));
-    printBlock("L1 guard successor exit new is successor 1 guard l2: ", getExitGuardSuccessor(*L2));
-
-    // GUARDIA 2: Il successore della guardia di L2 diventa la guardia di L1
-    guardL1->getTerminator()->setSuccessor(1, getExitGuardSuccessor(*L2)); 
-
-    // Spostamento delle istruzioni non branch dalla Guardia di L2 alla Guardia di L1
-    std::vector<Instruction*> instGuardL2toMove;
-
-    // Raccogli le istruzioni non-branch da spostare
-    for (Instruction &inst : *guardL2) {
-      if (&inst != guardL2->getTerminator()) {
-        instGuardL2toMove.push_back(&inst);
-      }
-    }
-    
-    // Sposta le istruzioni prima del terminatore del preheader di L1
-    // NB: i phiNode non avranno mai usi nel loop 2, 
-    for (Instruction *inst : instGuardL2toMove) {
-      if(isa<PHINode>(inst)){
-        // Lo spostiamo alla fine, non ha usi in L2
-        inst->moveBefore(getExitGuardSuccessor(*L2)->getFirstNonPHI());
-      } else {
-        // Altrimenti spostala prima del terminatore della guardia di L1
-        inst->moveBefore(guardL1->getTerminator());
-      }
-      outs () << "Instruzione da spostare dalla Guardia di L2: " << *inst << "\n";
-    }
+  // STEP 1: Le PHI (LCSSA) dell'exit di L1 (= preheader di L2) vanno nell'exit di L2: il loop fuso esce sempre
+  // dall'header di L1, quindi l'incoming block resta lo stesso (i loro usi dentro L2 sono esclusi dal punto 4)
+  for (PHINode &Phi : make_early_inc_range(preHeaderL2->phis())) {
+    outs() << "Moving LCSSA PHI of L1 to the exit of L2: " << Phi << "\n";
+    Phi.moveBefore(exitL2->getFirstNonPHI());
   }
 
   // STEP 2: Sostituzione dei blocchi del preheader di L2 con quello di L1
@@ -364,7 +667,10 @@ void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, Scalar
     inst->moveBefore(preHeaderL1->getTerminator());
   }
 
-  // STEP 2.3: Sostituzione nei PHINodes dei blocchi del preheader di L2 con quello di L1
+  // STEP 2.3: Sostituzione delle variabili di induzione di L2 (ora i loro valori iniziali sono nel preheader di L1)
+  replaceInductionVariables(*L1, *L2, SE, F.getParent()->getDataLayout());
+
+  // STEP 2.4: Sostituzione nei PHINodes dei blocchi del preheader di L2 con quello di L1
   // NB: lo facciamo appositamente prima di spostare eventuali istruzioni dall'headerL2 all'headerL1 per avere i valori corretti
   preHeaderL2->replaceSuccessorsPhiUsesWith(preHeaderL1);
   
@@ -390,8 +696,9 @@ void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, Scalar
       inst->moveBefore(headerL1->getTerminator());
   }
 
-  // STEP 5: L1 esce con l'exit di L2
+  // STEP 5: L1 esce con l'exit di L2, le cui PHI (LCSSA) ora arrivano dall'header di L1
   exitingL1->getTerminator()->setSuccessor(1, exitL2);
+  exitL2->replacePhiUsesWith(exitingL2, exitingL1);
 
   // Step 6: Dopo il body di L1 viene eseguito il body di L2
   lastBlockBodyL1->getTerminator()->setSuccessor(0, firstBlockBodyL2);
@@ -406,6 +713,165 @@ void merge(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, Scalar
 }
 
 
+// Fonde i due loop L1 e L2 ruotati (test di uscita nel latch): il risultato ha un solo loop e, se guarded, una sola guardia
+// NB: la validità della struttura è controllata da canMergeRotated (Punto 5)
+void mergeRotated(Loop *L1, Loop *L2, ScalarEvolution &SE, Function &F) {
+  bool guarded = L1->isGuarded();
+  BranchInst *guardBranchL1 = guarded ? L1->getLoopGuardBranch() : nullptr;
+  BranchInst *guardBranchL2 = guarded ? L2->getLoopGuardBranch() : nullptr;
+
+  // Blocchi L1
+  BasicBlock *guardL1 = guarded ? guardBranchL1->getParent() : nullptr;
+  BasicBlock *preHeaderL1 = L1->getLoopPreheader();
+  BasicBlock *headerL1 = L1->getHeader();
+  BasicBlock *latchL1 = L1->getLoopLatch();
+  BasicBlock *exitL1 = L1->getExitBlock();
+
+  // Blocchi L2
+  BasicBlock *guardL2 = guarded ? guardBranchL2->getParent() : nullptr;
+  BasicBlock *preHeaderL2 = L2->getLoopPreheader();
+  BasicBlock *headerL2 = L2->getHeader();
+  BasicBlock *latchL2 = L2->getLoopLatch();
+  BasicBlock *exitL2 = L2->getExitBlock();
+  BasicBlock *joinL2 = guarded ? getExitGuardSuccessor(*L2) : nullptr;
+
+  outs() << "*** ROTATED LOOPS (guarded: " << guarded << ") ***\n";
+  if (guarded) {
+    printBlock("L1 Guard", guardL1);
+    printBlock("L2 Guard", guardL2);
+    printBlock("L2 Guard Exit", joinL2);
+  }
+  printBlock("L1 PreHeader", preHeaderL1);
+  printBlock("L1 Header", headerL1);
+  printBlock("L1 Latch", latchL1);
+  printBlock("L1 Exit Block", exitL1);
+  printBlock("L2 PreHeader", preHeaderL2);
+  printBlock("L2 Header", headerL2);
+  printBlock("L2 Latch", latchL2);
+  printBlock("L2 Exit Block", exitL2);
+
+  SmallVector<WeakTrackingVH, 4> dead;
+  dead.push_back(cast<BranchInst>(latchL1->getTerminator())->getCondition());
+
+  // STEP 1: Le istruzioni della guardia di L2 (tranne le PHI) vanno nella guardia di L1, quelle del preheader di L2 nel preheader di L1
+  if (guarded) {
+    dead.push_back(guardBranchL2->getCondition());
+    for (Instruction &inst : make_early_inc_range(*guardL2)) {
+      if (isa<PHINode>(&inst) || &inst == guardBranchL2) continue;
+      outs() << "Instruzione da spostare dalla guardia di L2: " << inst << "\n";
+      inst.moveBefore(guardBranchL1);
+    }
+  } else {
+    // Exit di L1 = preheader di L2: le sue PHI (LCSSA) vanno nell'exit di L2, il loop fuso esce dal latch di L2
+    for (PHINode &Phi : make_early_inc_range(preHeaderL2->phis())) {
+      outs() << "Moving LCSSA PHI of L1 to the exit of L2: " << Phi << "\n";
+      Phi.moveBefore(exitL2->getFirstNonPHI());
+      Phi.replaceIncomingBlockWith(latchL1, latchL2);
+    }
+  }
+
+  for (Instruction &inst : make_early_inc_range(*preHeaderL2)) {
+    if (&inst == preHeaderL2->getTerminator()) continue;
+    outs() << "Instruzione da spostare dal PreheaderL2: " << inst << "\n";
+    inst.moveBefore(preHeaderL1->getTerminator());
+  }
+
+  // STEP 2: Sostituzione delle variabili di induzione di L2
+  replaceInductionVariables(*L1, *L2, SE, F.getParent()->getDataLayout());
+
+  // STEP 3: Le PHI rimaste nell'header di L2 vanno nell'header di L1 (entrano dal preheader di L1)
+  for (PHINode &Phi : make_early_inc_range(headerL2->phis())) {
+    outs() << "Moving PHI from L2 header: " << Phi << "\n";
+    Phi.moveBefore(headerL1->getFirstNonPHI());
+    Phi.replaceIncomingBlockWith(preHeaderL2, preHeaderL1);
+  }
+
+  // STEP 4: Dopo il latch di L1 viene eseguito l'header (il body) di L2, il backedge parte dal latch di L2
+  BranchInst::Create(headerL2, latchL1->getTerminator());
+  latchL1->getTerminator()->eraseFromParent();
+  headerL1->replacePhiUsesWith(latchL1, latchL2);
+
+  // STEP 5: Il latch di L2 torna all'header di L1 ed esce dall'exit di L1 (guarded) o di L2 (non guarded)
+  BranchInst *latchBranchL2 = cast<BranchInst>(latchL2->getTerminator());
+  for (unsigned i = 0; i < latchBranchL2->getNumSuccessors(); i++) {
+    if (latchBranchL2->getSuccessor(i) == headerL2)
+      latchBranchL2->setSuccessor(i, headerL1);
+    else if (guarded)
+      latchBranchL2->setSuccessor(i, exitL1);
+  }
+
+  // STEP 6: Una sola guardia: se n <= 0 la guardia di L1 salta direttamente dopo L2,
+  // altrimenti il loop fuso esce in Exit1 -> G2 -> Exit2 -> Join2 (G2 non controlla più nulla)
+  if (guarded) {
+    // STEP 6.1: Le PHI (LCSSA) dell'exit di L1 ora arrivano dal latch di L2
+    exitL1->replacePhiUsesWith(latchL1, latchL2);
+
+    // STEP 6.2: Nelle PHI dopo L2 il ramo "n <= 0" ora arriva dalla guardia di L1
+    for (PHINode &Phi : joinL2->phis()) {
+      int idx = Phi.getBasicBlockIndex(guardL2);
+      Value *V = Phi.getIncomingValue(idx);
+      if (auto *P = dyn_cast<PHINode>(V); P && P->getParent() == guardL2)
+        Phi.setIncomingValue(idx, P->getIncomingValueForBlock(guardL1));
+      Phi.setIncomingBlock(idx, guardL1);
+    }
+
+    // STEP 6.3: Le PHI di G2 usate dopo L2 non dominano più Join2: serve una PHI in Join2
+    for (PHINode &Phi : guardL2->phis()) {
+      SmallVector<Use*, 4> outside;
+      for (Use &U : Phi.uses()) {
+        auto *UserInst = cast<Instruction>(U.getUser());
+        BasicBlock *UseBB = UserInst->getParent();
+        if (auto *UserPhi = dyn_cast<PHINode>(UserInst)) UseBB = UserPhi->getIncomingBlock(U);
+        if (UseBB != guardL2 && UseBB != exitL2 && !L2->contains(UseBB)) outside.push_back(&U);
+      }
+      if (outside.empty()) continue;
+
+      PHINode *New = PHINode::Create(Phi.getType(), 2, Phi.getName() + ".lf", &joinL2->front());
+      New->addIncoming(&Phi, exitL2);
+      New->addIncoming(Phi.getIncomingValueForBlock(guardL1), guardL1);
+      for (Use *U : outside) U->set(New);
+      outs() << "New PHI after L2: " << *New << "\n";
+    }
+
+    // STEP 6.4: Le PHI (LCSSA) dell'exit di L2 ora arrivano da G2
+    exitL2->replacePhiUsesWith(latchL2, guardL2);
+
+    // STEP 6.5: G2 va direttamente all'exit di L2
+    BranchInst::Create(exitL2, guardBranchL2);
+    guardBranchL2->eraseFromParent();
+
+    // STEP 6.6: La guardia di L1 salta dopo L2
+    for (unsigned i = 0; i < guardBranchL1->getNumSuccessors(); i++) {
+      if (guardBranchL1->getSuccessor(i) == guardL2) guardBranchL1->setSuccessor(i, joinL2);
+    }
+
+    // STEP 6.7: G2 ora ha come unico predecessore l'exit di L1
+    for (PHINode &Phi : guardL2->phis()) Phi.removeIncomingValue(guardL1, false);
+  }
+
+  // STEP 7: Elimina i blocchi non raggiungibili (preheader di L2, exit di L1 se non guarded) e i confronti rimasti senza usi
+  EliminateUnreachableBlocks(F);
+  RecursivelyDeleteTriviallyDeadInstructionsPermissive(dead);
+
+  F.print(outs());
+}
+
+
+// Parametri di lf<...>, separati da ';' (es. lf<max-chain=8>)
+Expected<LoopFusionOptions> parseLoopFusionOptions(StringRef Params) {
+  LoopFusionOptions Opts;
+  while (!Params.empty()) {
+    StringRef Param;
+    std::tie(Param, Params) = Params.split(';');
+    if (Param.consume_front("max-chain=")) {
+      if (Param.getAsInteger(0, Opts.MaxChain))
+        return createStringError(inconvertibleErrorCode(), "lf: max-chain non valido '" + Param + "'");
+    } else {
+      return createStringError(inconvertibleErrorCode(), "lf: parametro sconosciuto '" + Param + "'");
+    }
+  }
+  return Opts;
+}
 
 /**  Esecuzione del passo di analisi "LoopFusionPass"  **/ 
 PreservedAnalyses LoopFusionPass::run(Function &F, FunctionAnalysisManager &AM) {
@@ -413,7 +879,16 @@ PreservedAnalyses LoopFusionPass::run(Function &F, FunctionAnalysisManager &AM)
   DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
   PostDominatorTree &PDT = AM.getResult<PostDominatorTreeAnalysis>(F);
   ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
-  DependenceInfo &DI = AM.getResult<DependenceAnalysis>(F);
+  LoopAccessSummaries &LAS = AM.getResult<LoopAccessSummaryAnalysis>(F);
+  AAResults &AA = AM.getResult<AAManager>(F);
+  TargetTransformInfo &TTI = AM.getResult<TargetIRAnalysis>(F);
+  AssumptionCache &AC = AM.getResult<AssumptionAnalysis>(F);
+  BlockFrequencyInfo &BFI = AM.getResult<BlockFrequencyAnalysis>(F);
+
+  // PSI è un'analisi di modulo: se nessuno l'ha calcolata (es. require<profile-summary>) la si legge dal modulo
+  std::optional<ProfileSummaryInfo> localPSI;
+  ProfileSummaryInfo *PSI = AM.getResult<ModuleAnalysisManagerFunctionProxy>(F).getCachedResult<ProfileSummaryAnalysis>(*F.getParent());
+  if (!PSI) PSI = &localPSI.emplace(*F.getParent());
   
   // Controlla se ci sono loop nella funzione
   if (LI.rbegin() == LI.rend()) {
@@ -428,14 +903,71 @@ PreservedAnalyses LoopFusionPass::run(Function &F, FunctionAnalysisManager &AM)
   loop_counter = 1;  
   auto L1 = LI.rbegin();
   auto L2 = std::next(L1);
+
+  // Con un profilo (instrumentation o sample) le coppie di loop entrambi freddi non vengono analizzate:
+  // la fusione non porterebbe nulla e i controlli (dipendenze, rotazione) costano. Calcolato prima di qualunque
+  // trasformazione, le frequenze di BFI non sono aggiornate dalla fusione
+  SmallPtrSet<BasicBlock*, 8> coldHeaders;
+  if (PSI->hasProfileSummary()) {
+    for (Loop *L : LI) {
+      if (PSI->isColdBlock(L->getHeader(), &BFI)) coldHeaders.insert(L->getHeader());
+    }
+  }
+  bool changed = false;
+  unsigned chain = 1; // Loop originali fusi in L1
   
   while (L2 != LI.rend()){
     outs() << "* Checking Loop " << loop_counter << " and Loop " << loop_counter+1 << " *\n";
+
+    if (Opts.MaxChain && chain >= Opts.MaxChain) {
+      outs() << "=> Loop " << loop_counter << " already fuses " << chain << " loops (max-chain): fusion not attempted\n\n";
+      chain = 1;
+      loop_counter++;
+      L1++;
+      L2 = std::next(L1);
+      continue;
+    }
+
+    if (coldHeaders.contains((*L1)->getHeader()) && coldHeaders.contains((*L2)->getHeader())) {
+      outs() << "=> Loop " << loop_counter << " and Loop " << loop_counter+1 << " are cold (profile): fusion not attempted\n\n";
+      chain = 1;
+      loop_counter++;
+      L1++;
+      L2 = std::next(L1);
+      continue;
+    }
+
+    // Forma comune: se solo uno dei due è ruotato (es. un for accanto a un do-while, o dopo -O1) si ruota anche l'altro
+    // NB: un loop ruotato ha la guardia se SCEV non dimostra che esegue almeno un'iterazione
+    if ((*L1)->isRotatedForm() != (*L2)->isRotatedForm()) {
+      Loop *toRotate = (*L1)->isRotatedForm() ? *L2 : *L1;
+      outs() << "Rotating Loop " << toRotate->getHeader()->getName() << "\n";
+      LAS.forget(toRotate->getHeader()); // La rotazione duplica l'header e cambia gli accessi
+      if (LoopRotation(toRotate, &LI, &TTI, &AC, &DT, &SE, nullptr, getBestSimplifyQuery(AM, F),
+                       /*RotationOnly*/ true, /*Threshold*/ ~0U, /*IsUtilityCall*/ true)) {
+        PDT.recalculate(F); // LoopRotation aggiorna LoopInfo e DominatorTree, non la PostDominatorTree
+        changed = true;
+      }
+    }
     
-    if(isLoopFusionValid(*L1, *L2, DT, PDT, SE, DI)){
+    if(isLoopFusionValid(*L1, *L2, DT, PDT, SE, AA, LAS)){
       outs() << "\n" << "Loop " << loop_counter << " and Loop " << loop_counter+1 << " can be fused\n\n";
 
-      merge(*L1, *L2, DT, PDT, SE, DI, F);
+      // Il loop fuso contiene il corpo di almeno un loop caldo
+      coldHeaders.erase((*L1)->getHeader());
+      changed = true;
+      chain++;
+
+      // Gli usi in L2 dei valori finali delle IV di L1 vengono calcolati prima di L1
+      rewriteExitValueUses(**L1, **L2, LAS.get(**L1), SE, DT);
+
+      // Il riassunto degli accessi del loop fuso è l'unione dei due (prima del merge: l'header di L2 viene eliminato)
+      LAS.merge((*L1)->getHeader(), (*L2)->getHeader());
+
+      if ((*L1)->isRotatedForm())
+        mergeRotated(*L1, *L2, SE, F);
+      else
+        merge(*L1, *L2, DT, PDT, SE, F);
       
       // Ricostruisci le analisi dopo la trasformazione
       DT.recalculate(F);  
@@ -456,6 +988,7 @@ PreservedAnalyses LoopFusionPass::run(Function &F, FunctionAnalysisManager &AM)
       outs() << "\n" << "Loops fused - L2 is removed and L1 is updated. L3 is the new L2 \n";
     } else {
       // Passa al prossimo loop
+      chain = 1;
       loop_counter++;
       L1++;
       L2 = std::next(L1);
@@ -464,15 +997,17 @@ PreservedAnalyses LoopFusionPass::run(Function &F, FunctionAnalysisManager &AM)
     outs() << "\n";
   }
   
-  return PreservedAnalyses::all();
+  // La fusione cambia il CFG: BlockFrequencyInfo (e le altre analisi) non sono più valide
+  return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
 }
 
 // Controlla la validità della LoopFusion verificando le condizioni
-bool isLoopFusionValid(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE, DependenceInfo &DI) {
+bool isLoopFusionValid(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree &PDT, ScalarEvolution &SE, AAResults &AA,
+                       LoopAccessSummaries &LAS) {
   // --- Punto 0 --- 
-  // Ossia L1 e L2 saranno entrambi guarded oppure non guarded (mai guarded diversamente)
+  // Ossia L1 e L2 saranno entrambi guarded oppure non guarded (mai guarded diversamente), ed entrambi ruotati oppure no
   outs() << "0) Loops have the guard?\n";
-  if (L1->isGuarded() == L2->isGuarded())
+  if (L1->isGuarded() == L2->isGuarded() && L1->isRotatedForm() == L2->isRotatedForm())
     outs() << "=> Loop " << loop_counter << " and Loop " << loop_counter+1 << " are both equally guarded with guard: " << L1->isGuarded() << "\n";
   else return false;
   
@@ -490,21 +1025,35 @@ bool isLoopFusionValid(Loop *L1, Loop *L2, DominatorTree &DT, PostDominatorTree
 
   // --- Punto 3 ---
   outs() << "3) There is the Control Flow Equivalence?\n";
-  if(isControlFlowEquivalent(*L1, *L2, DT, PDT)) 
+  if(isControlFlowEquivalent(*L1, *L2, DT, PDT, SE)) 
     outs() << "=> Loop " << loop_counter << " control flow equivalent with Loop " << loop_counter+1 << "\n";
   else return false;
 
   // --- Punto 4 ---
   outs () << "4) Do Loops have negative dependencies?\n";
-  if(haveNotNegativeDependencies(*L1, *L2, SE, DI)) 
+  if(haveNotNegativeDependencies(*L1, *L2, SE, DT, AA, LAS)) 
     outs() << "=> Loop " << loop_counter << " and " << loop_counter+1 << " have no negative dependencies \n";
   else return false;
 
+  // --- Punto 5 ---
+  if (L1->isRotatedForm()) {
+    outs() << "5) Can rotated Loops be merged?\n";
+    if (canMergeRotated(*L1, *L2, LAS.get(*L1), SE, DT))
+      outs() << "=> Loop " << loop_counter << " and " << loop_counter+1 << " have a mergeable structure\n";
+    else return false;
+  } else {
+    outs() << "5) Can the PHIs of L2 be moved in the header of L1?\n";
+    if (canMergeHeaderPhis(*L2, SE))
+      outs() << "=> The PHIs of Loop " << loop_counter+1 << " can be moved\n";
+    else return false;
+  }
+
   return true;
 }
 
 void printBlock(std::string s, BasicBlock *BB) {
   outs() << s << ": ";
-  BB->printAsOperand(outs(), false);
+  if (BB) BB->printAsOperand(outs(), false);
+  else outs() << "none"; // Es. loop con più uscite
   outs() << "\n";
 }
\ No newline at end of file
@@ -0,0 +1,490 @@
+//-----------------------------------------------------------------------------
+// Loop Parallelization implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Parallelizzazione dei loop DOALL (iterazioni indipendenti) sui thread del runtime ParallelRuntime.c:
+    for(i=0; i<n; i++){ A[i] = B[i] + C[i]; sum += A[i]; }
+  diventa
+    __parrt_for(n, foo.par.0, &ctx, &result, &identity, sizeof(result), foo.par.0.combine)
+  dove foo.par.0(begin, end, ctx, partial) esegue le iterazioni [begin, end) del loop.
+
+LEGALITÀ (solo loop esterni: i loop interni vengono eseguiti dentro il corpo):
+  • Simplify form, una sola uscita, dall'header o dal latch; trip count calcolabile da SCEV (al massimo 64 bit)
+  • PHI dell'header: IV intere affini con step costante (ricalcolate dal numero dell'iterazione) o riduzioni
+    (RecurrenceDescriptor): add, mul, and, or, xor, min/max intere; fadd/fmul solo se riassociabili (reassoc)
+  • Nessuna chiamata con effetti (solo readnone, willreturn, nounwind), nessun accesso volatile o atomico
+  • DependenceInfo: nessuna dipendenza tra load/store (almeno uno store) con direzione diversa da = sul loop,
+    le dipendenze non analizzabili (confused) contano come dipendenze
+  • Valori usati dopo il loop: solo il valore finale delle riduzioni
+  • Loop con trip count costante minore di min-iterations restano sequenziali (il costo dei thread non si ripaga)
+
+TRASFORMAZIONE:
+  • Corpo: void F.par.N(i64 begin, i64 end, ptr ctx, ptr partial), i valori definiti fuori dal loop arrivano in ctx
+       par.entry ──> par.header (k = begin..end, IV = start + k * step) ──> blocchi del loop ──> par.latch (k + 1)
+                          └──> par.exit (salva le riduzioni parziali in partial)
+    L'uscita e il backedge del loop clonato portano entrambi a par.latch: il loop originale esegue BTC + 1 iterazioni
+  • Combine: void F.par.N.combine(ptr acc, ptr partial), acc = acc op partial per ogni riduzione
+  • Nel preheader: ctx, result (valori iniziali delle riduzioni) e identity, chiamata al runtime e lettura dei
+    risultati; il loop originale viene eliminato
+  Le funzioni create vengono marcate "par.outlined" e saltate dal passo (il loop del corpo non va parallelizzato)
+  I loop vengono analizzati e trasformati uno alla volta, in forma LCSSA: i valori finali delle riduzioni
+  arrivano ai loop successivi attraverso le PHI dell'uscita, che restano valide quando il loop viene eliminato
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/IVDescriptors.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LCSSA.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+static const char *OutlinedAttr = "par.outlined";
+
+// Parametri di par<...>, separati da ';' (es. par<min-iterations=64>)
+Expected<LoopParallelizationOptions> parseLoopParallelizationOptions(StringRef Params) {
+  LoopParallelizationOptions Opts;
+  while (!Params.empty()) {
+    StringRef Param;
+    std::tie(Param, Params) = Params.split(';');
+    if (Param.consume_front("min-iterations=")) {
+      if (Param.getAsInteger(0, Opts.MinIterations))
+        return createStringError(inconvertibleErrorCode(), "par: min-iterations non valido '" + Param + "'");
+    } else {
+      return createStringError(inconvertibleErrorCode(), "par: parametro sconosciuto '" + Param + "'");
+    }
+  }
+  return Opts;
+}
+
+struct ParallelInduction {
+  PHINode *Phi;
+  const SCEV *Start;
+  ConstantInt *Step;
+};
+
+struct ParallelReduction {
+  PHINode *Phi;
+  RecurKind Kind;
+  FastMathFlags FMF;
+  Value *Start;          // Valore dal preheader
+  Instruction *Next;     // Valore alla fine dell'iterazione (dal latch)
+  Instruction *LiveOut;  // Valore visto dopo il loop: Next se il loop esce dal latch, Phi se esce dall'header
+};
+
+// Analisi di un loop candidato
+struct ParallelPlan {
+  const SCEV *BTC = nullptr;
+  SmallVector<ParallelInduction, 4> ivs;
+  SmallVector<ParallelReduction, 4> reductions;
+  SetVector<Value*> liveIns;                    // Valori definiti fuori dal loop usati dal corpo
+};
+
+bool isParallelReduction(RecurKind Kind) {
+  switch (Kind) {
+    case RecurKind::Add: case RecurKind::Mul:
+    case RecurKind::And: case RecurKind::Or: case RecurKind::Xor:
+    case RecurKind::SMin: case RecurKind::SMax: case RecurKind::UMin: case RecurKind::UMax:
+    case RecurKind::FAdd: case RecurKind::FMul:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Valore neutro: il valore iniziale delle riduzioni parziali di ogni thread
+Constant *getReductionIdentity(RecurKind Kind, Type *Ty) {
+  switch (Kind) {
+    case RecurKind::Mul: return ConstantInt::get(Ty, 1);
+    case RecurKind::And: case RecurKind::UMin: return Constant::getAllOnesValue(Ty);
+    case RecurKind::SMin: return ConstantInt::get(Ty, APInt::getSignedMaxValue(Ty->getIntegerBitWidth()));
+    case RecurKind::SMax: return ConstantInt::get(Ty, APInt::getSignedMinValue(Ty->getIntegerBitWidth()));
+    case RecurKind::FAdd: return ConstantFP::getNegativeZero(Ty);
+    case RecurKind::FMul: return ConstantFP::get(Ty, 1.0);
+    default: return Constant::getNullValue(Ty); // Add, Or, Xor, UMax
+  }
+}
+
+Value *createReductionOp(IRBuilderBase &Builder, const ParallelReduction &R, Value *A, Value *B) {
+  switch (R.Kind) {
+    case RecurKind::SMin: return Builder.CreateBinaryIntrinsic(Intrinsic::smin, A, B);
+    case RecurKind::SMax: return Builder.CreateBinaryIntrinsic(Intrinsic::smax, A, B);
+    case RecurKind::UMin: return Builder.CreateBinaryIntrinsic(Intrinsic::umin, A, B);
+    case RecurKind::UMax: return Builder.CreateBinaryIntrinsic(Intrinsic::umax, A, B);
+    default:
+      Builder.setFastMathFlags(R.FMF);
+      return Builder.CreateBinOp((Instruction::BinaryOps)RecurrenceDescriptor::getOpcode(R.Kind), A, B);
+  }
+}
+
+// Dipendenze tra iterazioni diverse del loop (direzione < o > al livello del loop)
+bool hasLoopCarriedDependence(Loop &L, ArrayRef<Instruction*> memory, DependenceInfo &DI) {
+  unsigned level = L.getLoopDepth();
+  for (unsigned a = 0; a < memory.size(); a++) {
+    for (unsigned b = a; b < memory.size(); b++) { // b == a: uno store con sé stesso in un'altra iterazione
+      Instruction *Src = memory[a], *Dst = memory[b];
+      if (!isa<StoreInst>(Src) && !isa<StoreInst>(Dst)) continue;
+
+      std::unique_ptr<Dependence> D = DI.depends(Src, Dst, true);
+      if (!D) continue;
+      if (D->isConfused() || D->getLevels() < level || (D->getDirection(level) & ~Dependence::DVEntry::EQ)) {
+        outs() << "  - Dipendenza tra iterazioni: " << *Src << " / " << *Dst << "\n";
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool canParallelize(Loop &L, ParallelPlan &Plan, unsigned MinIterations, ScalarEvolution &SE, DependenceInfo &DI,
+                    DominatorTree &DT, const DataLayout &DL) {
+  if (!L.isLoopSimplifyForm() || !L.getExitBlock()) {
+    outs() << "  - Non è un loop in simplify form con una sola uscita\n";
+    return false;
+  }
+
+  BasicBlock *Header = L.getHeader(), *Latch = L.getLoopLatch(), *Preheader = L.getLoopPreheader();
+  BasicBlock *Exiting = L.getExitingBlock();
+  if (!Exiting || (Exiting != Header && Exiting != Latch)) {
+    outs() << "  - Il loop deve uscire dall'header o dal latch\n";
+    return false;
+  }
+
+  const SCEV *BTC = SE.getBackedgeTakenCount(&L);
+  SCEVExpander Expander(SE, DL, "par");
+  if (isa<SCEVCouldNotCompute>(BTC) || BTC->getType()->getScalarSizeInBits() > 64 || !Expander.isSafeToExpand(BTC)) {
+    outs() << "  - Trip count non calcolabile\n";
+    return false;
+  }
+  if (auto *C = dyn_cast<SCEVConstant>(BTC); C && MinIterations && C->getAPInt().ult(MinIterations - 1)) {
+    outs() << "  - Trip count " << C->getAPInt().getZExtValue() + 1 << " < min-iterations " << MinIterations << "\n";
+    return false;
+  }
+  Plan.BTC = BTC;
+
+  // PHI dell'header: IV affini o riduzioni riassociabili
+  for (PHINode &Phi : Header->phis()) {
+    auto *AR = SE.isSCEVable(Phi.getType()) ? dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&Phi)) : nullptr;
+    if (Phi.getType()->isIntegerTy() && AR && AR->getLoop() == &L && AR->isAffine() &&
+        isa<SCEVConstant>(AR->getStepRecurrence(SE)) && Expander.isSafeToExpand(AR->getStart())) {
+      Plan.ivs.push_back({&Phi, AR->getStart(), cast<SCEVConstant>(AR->getStepRecurrence(SE))->getValue()});
+      continue;
+    }
+
+    RecurrenceDescriptor RD;
+    if (!RecurrenceDescriptor::isReductionPHI(&Phi, &L, RD, nullptr, nullptr, &DT, &SE)) {
+      outs() << "  - PHI non supportata (ricorrenza): " << Phi << "\n";
+      return false;
+    }
+    if (!isParallelReduction(RD.getRecurrenceKind()) || RD.getExactFPMathInst() ||
+        RD.getRecurrenceType() != Phi.getType() || !RD.getCastInsts().empty()) {
+      outs() << "  - Riduzione non riassociabile: " << Phi << "\n";
+      return false;
+    }
+
+    auto *Next = cast<Instruction>(Phi.getIncomingValueForBlock(Latch));
+    Plan.reductions.push_back({&Phi, RD.getRecurrenceKind(), RD.getFastMathFlags(), Phi.getIncomingValueForBlock(Preheader),
+                               Next, Exiting == Latch ? Next : &Phi});
+  }
+
+  SmallVector<Instruction*, 16> memory;
+  bool hasStore = false;
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (isa<DbgInfoIntrinsic>(I)) continue;
+
+      if (auto *Call = dyn_cast<CallBase>(&I)) {
+        if (!isa<CallInst>(Call) || !Call->doesNotAccessMemory() || !Call->willReturn() || !Call->doesNotThrow() ||
+            Call->isConvergent()) {
+          outs() << "  - Chiamata con effetti: " << I << "\n";
+          return false;
+        }
+      } else if (isa<LoadInst>(I) || isa<StoreInst>(I)) {
+        if (I.isVolatile() || I.isAtomic()) {
+          outs() << "  - Accesso volatile o atomico: " << I << "\n";
+          return false;
+        }
+        memory.push_back(&I);
+        hasStore |= isa<StoreInst>(I);
+      } else if (isa<AllocaInst>(I) || I.mayReadOrWriteMemory()) {
+        outs() << "  - Istruzione non supportata: " << I << "\n";
+        return false;
+      }
+
+      // I valori iniziali delle PHI dell'header vengono ricalcolati (IV) o passati dal runtime (riduzioni)
+      if (!(isa<PHINode>(I) && BB == Header)) {
+        for (Value *Op : I.operands()) {
+          auto *OpI = dyn_cast<Instruction>(Op);
+          if ((OpI && !L.contains(OpI)) || isa<Argument>(Op)) Plan.liveIns.insert(Op);
+        }
+      }
+
+      for (User *U : I.users()) {
+        if (L.contains(cast<Instruction>(U))) continue;
+        if (none_of(Plan.reductions, [&](const ParallelReduction &R) { return R.LiveOut == &I; })) {
+          outs() << "  - Valore usato dopo il loop: " << I << "\n";
+          return false;
+        }
+      }
+    }
+  }
+
+  if (!hasStore && Plan.reductions.empty()) {
+    outs() << "  - Nessun effetto da parallelizzare\n";
+    return false;
+  }
+
+  return !hasLoopCarriedDependence(L, memory, DI);
+}
+
+// Corpo del loop sulle iterazioni [begin, end)
+Function *createParallelBody(Loop &L, ParallelPlan &Plan, StructType *CtxTy, StructType *RedTy, const Twine &Name) {
+  Function &F = *L.getHeader()->getParent();
+  LLVMContext &Ctx = F.getContext();
+  Type *I64 = Type::getInt64Ty(Ctx);
+  PointerType *Ptr = PointerType::getUnqual(Ctx);
+  BasicBlock *Header = L.getHeader(), *Latch = L.getLoopLatch(), *Exiting = L.getExitingBlock();
+  BasicBlock *Exit = L.getExitBlock();
+
+  FunctionType *BodyTy = FunctionType::get(Type::getVoidTy(Ctx), {I64, I64, Ptr, Ptr}, false);
+  Function *Body = Function::Create(BodyTy, GlobalValue::InternalLinkage, Name, F.getParent());
+  Body->addFnAttr(Attribute::NoUnwind);
+  Body->addFnAttr(OutlinedAttr);
+  Argument *Begin = Body->getArg(0), *End = Body->getArg(1), *CtxArg = Body->getArg(2), *Partial = Body->getArg(3);
+  Begin->setName("begin");
+  End->setName("end");
+  CtxArg->setName("ctx");
+  Partial->setName("partial");
+
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "par.entry", Body);
+  BasicBlock *ParHeader = BasicBlock::Create(Ctx, "par.header", Body);
+
+  ValueToValueMapTy VMap;
+  SmallVector<BasicBlock*, 8> blocks;
+  for (BasicBlock *BB : L.blocks()) {
+    BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".par", Body);
+    VMap[BB] = Clone;
+    blocks.push_back(Clone);
+  }
+  BasicBlock *HeaderClone = cast<BasicBlock>(VMap[Header]);
+  BasicBlock *LatchClone = cast<BasicBlock>(VMap[Latch]), *ExitingClone = cast<BasicBlock>(VMap[Exiting]);
+  BasicBlock *ParLatch = BasicBlock::Create(Ctx, "par.latch", Body);
+  BasicBlock *ParExit = BasicBlock::Create(Ctx, "par.exit", Body);
+
+  // par.entry: valori catturati, inizio delle IV e riduzioni parziali
+  IRBuilder<> Builder(Entry);
+  unsigned field = 0;
+  for (Value *V : Plan.liveIns) {
+    VMap[V] = Builder.CreateLoad(V->getType(), Builder.CreateStructGEP(CtxTy, CtxArg, field++), V->getName());
+  }
+  SmallVector<Value*, 4> ivStarts, redInit;
+  for (ParallelInduction &IV : Plan.ivs) {
+    ivStarts.push_back(Builder.CreateLoad(IV.Phi->getType(), Builder.CreateStructGEP(CtxTy, CtxArg, field++),
+                                          IV.Phi->getName() + ".start"));
+  }
+  for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+    PHINode *Phi = Plan.reductions[r].Phi;
+    redInit.push_back(Builder.CreateLoad(Phi->getType(), Builder.CreateStructGEP(RedTy, Partial, r), Phi->getName() + ".init"));
+  }
+  Builder.CreateBr(ParHeader);
+
+  // par.header: iterazione k, le PHI dell'header clonato diventano valori calcolati da k
+  Builder.SetInsertPoint(ParHeader);
+  PHINode *K = Builder.CreatePHI(I64, 2, "k");
+  K->addIncoming(Begin, Entry);
+
+  SmallVector<PHINode*, 4> redPhis;
+  for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+    PHINode *Phi = Plan.reductions[r].Phi;
+    PHINode *RedPhi = Builder.CreatePHI(Phi->getType(), 2, Phi->getName());
+    RedPhi->addIncoming(redInit[r], Entry);
+    redPhis.push_back(RedPhi);
+
+    cast<Instruction>(VMap[Phi])->eraseFromParent();
+    VMap[Phi] = RedPhi;
+  }
+  for (unsigned i = 0; i < Plan.ivs.size(); i++) {
+    PHINode *Phi = Plan.ivs[i].Phi;
+    Value *Offset = Builder.CreateMul(Builder.CreateZExtOrTrunc(K, Phi->getType()), Plan.ivs[i].Step);
+    Value *IV = Builder.CreateAdd(ivStarts[i], Offset, Phi->getName());
+
+    cast<Instruction>(VMap[Phi])->eraseFromParent();
+    VMap[Phi] = IV;
+  }
+  Builder.CreateCondBr(Builder.CreateICmpSLT(K, End), HeaderClone, ParExit);
+
+  remapInstructionsInBlocks(blocks, VMap);
+
+  // L'uscita e il backedge chiudono entrambi l'iterazione k
+  if (ExitingClone == LatchClone) {
+    ReplaceInstWithInst(LatchClone->getTerminator(), BranchInst::Create(ParLatch));
+  } else {
+    for (BasicBlock *BB : {ExitingClone, LatchClone}) {
+      Instruction *Term = BB->getTerminator();
+      for (unsigned s = 0; s < Term->getNumSuccessors(); s++) {
+        if (Term->getSuccessor(s) == Exit || Term->getSuccessor(s) == HeaderClone) Term->setSuccessor(s, ParLatch);
+      }
+    }
+  }
+
+  // par.latch: valore delle riduzioni alla fine dell'iterazione (invariato se l'iterazione esce dall'header)
+  Builder.SetInsertPoint(ParLatch);
+  for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+    PHINode *Phi = Builder.CreatePHI(redPhis[r]->getType(), 2, redPhis[r]->getName() + ".next");
+    for (BasicBlock *Pred : predecessors(ParLatch)) {
+      Phi->addIncoming(Pred == LatchClone ? (Value*)VMap[Plan.reductions[r].Next] : redPhis[r], Pred);
+    }
+    redPhis[r]->addIncoming(Phi, ParLatch);
+  }
+  K->addIncoming(Builder.CreateAdd(K, ConstantInt::get(I64, 1), "k.next", /*HasNUW*/ true, /*HasNSW*/ true), ParLatch);
+  Builder.CreateBr(ParHeader);
+
+  // par.exit: riduzioni parziali del thread
+  Builder.SetInsertPoint(ParExit);
+  for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+    Builder.CreateStore(redPhis[r], Builder.CreateStructGEP(RedTy, Partial, r));
+  }
+  Builder.CreateRetVoid();
+
+  // NB: le istruzioni clonate hanno le debug location della funzione originale
+  stripDebugInfo(*Body);
+  return Body;
+}
+
+// acc = acc op partial, per ogni riduzione
+Function *createCombine(ParallelPlan &Plan, StructType *RedTy, Module &M, const Twine &Name) {
+  LLVMContext &Ctx = M.getContext();
+  PointerType *Ptr = PointerType::getUnqual(Ctx);
+
+  FunctionType *CombineTy = FunctionType::get(Type::getVoidTy(Ctx), {Ptr, Ptr}, false);
+  Function *Combine = Function::Create(CombineTy, GlobalValue::InternalLinkage, Name, M);
+  Combine->addFnAttr(Attribute::NoUnwind);
+  Combine->addFnAttr(OutlinedAttr);
+  Argument *Acc = Combine->getArg(0), *Partial = Combine->getArg(1);
+  Acc->setName("acc");
+  Partial->setName("partial");
+
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", Combine));
+  for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+    ParallelReduction &R = Plan.reductions[r];
+    Type *Ty = R.Phi->getType();
+    Value *AccPtr = Builder.CreateStructGEP(RedTy, Acc, r);
+    Value *A = Builder.CreateLoad(Ty, AccPtr);
+    Value *P = Builder.CreateLoad(Ty, Builder.CreateStructGEP(RedTy, Partial, r));
+    Builder.CreateStore(createReductionOp(Builder, R, A, P), AccPtr);
+  }
+  Builder.CreateRetVoid();
+  return Combine;
+}
+
+// Sostituisce il loop con la chiamata al runtime
+Function *parallelize(Loop &L, ParallelPlan &Plan, unsigned id, ScalarEvolution &SE, DominatorTree &DT, LoopInfo &LI,
+                      const DataLayout &DL) {
+  Function &F = *L.getHeader()->getParent();
+  Module &M = *F.getParent();
+  LLVMContext &Ctx = F.getContext();
+  Type *I64 = Type::getInt64Ty(Ctx);
+  PointerType *Ptr = PointerType::getUnqual(Ctx);
+  Instruction *InsertPt = L.getLoopPreheader()->getTerminator();
+
+  // Nel preheader: numero di iterazioni (BTC + 1) e valori iniziali delle IV
+  SCEVExpander Expander(SE, DL, "par");
+  const SCEV *TripCount = SE.getAddExpr(SE.getTruncateOrZeroExtend(Plan.BTC, I64), SE.getOne(I64));
+  Value *N = Expander.expandCodeFor(TripCount, I64, InsertPt);
+
+  SmallVector<Value*, 8> captured(Plan.liveIns.begin(), Plan.liveIns.end());
+  for (ParallelInduction &IV : Plan.ivs) captured.push_back(Expander.expandCodeFor(IV.Start, IV.Phi->getType(), InsertPt));
+
+  SmallVector<Type*, 8> capturedTypes, redTypes;
+  for (Value *V : captured) capturedTypes.push_back(V->getType());
+  for (ParallelReduction &R : Plan.reductions) redTypes.push_back(R.Phi->getType());
+  StructType *CtxTy = StructType::get(Ctx, capturedTypes);
+  StructType *RedTy = StructType::get(Ctx, redTypes);
+
+  Function *Body = createParallelBody(L, Plan, CtxTy, RedTy, F.getName() + ".par." + Twine(id));
+  Value *Combine = ConstantPointerNull::get(Ptr), *Result = Combine, *Identity = Combine;
+
+  IRBuilder<> Allocas(&F.getEntryBlock(), F.getEntryBlock().getFirstInsertionPt());
+  AllocaInst *CtxPtr = Allocas.CreateAlloca(CtxTy, nullptr, "par.ctx");
+  IRBuilder<> Builder(InsertPt);
+  for (unsigned i = 0; i < captured.size(); i++) {
+    Builder.CreateStore(captured[i], Builder.CreateStructGEP(CtxTy, CtxPtr, i));
+  }
+
+  if (!Plan.reductions.empty()) {
+    Combine = createCombine(Plan, RedTy, M, Body->getName() + ".combine");
+    Result = Allocas.CreateAlloca(RedTy, nullptr, "par.result");
+    Identity = Allocas.CreateAlloca(RedTy, nullptr, "par.identity");
+    for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+      ParallelReduction &R = Plan.reductions[r];
+      Builder.CreateStore(R.Start, Builder.CreateStructGEP(RedTy, Result, r));
+      Builder.CreateStore(getReductionIdentity(R.Kind, R.Phi->getType()), Builder.CreateStructGEP(RedTy, Identity, r));
+    }
+  }
+
+  // void __parrt_for(i64 n, ptr body, ptr ctx, ptr result, ptr identity, i64 size, ptr combine)
+  FunctionCallee ParFor = M.getOrInsertFunction("__parrt_for", Type::getVoidTy(Ctx), I64, Ptr, Ptr, Ptr, Ptr, I64, Ptr);
+  Builder.CreateCall(ParFor, {N, Body, CtxPtr, Result, Identity, ConstantInt::get(I64, DL.getTypeAllocSize(RedTy)), Combine});
+
+  // Dopo il loop i valori finali delle riduzioni arrivano da result
+  for (unsigned r = 0; r < Plan.reductions.size(); r++) {
+    ParallelReduction &R = Plan.reductions[r];
+    Value *Final = Builder.CreateLoad(R.Phi->getType(), Builder.CreateStructGEP(RedTy, Result, r), R.LiveOut->getName() + ".par");
+    for (Use &U : make_early_inc_range(R.LiveOut->uses())) {
+      if (!L.contains(cast<Instruction>(U.getUser()))) U.set(Final);
+    }
+  }
+
+  // Il preheader salta all'uscita, i blocchi del loop vengono eliminati (DT, SE e LI aggiornati)
+  deleteDeadLoop(&L, &DT, &SE, &LI);
+  return Body;
+}
+
+PreservedAnalyses LoopParallelizationPass::run(Function &F, FunctionAnalysisManager &AM) {
+  if (F.hasFnAttribute(OutlinedAttr)) return PreservedAnalyses::all();
+
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  DependenceInfo &DI = AM.getResult<DependenceAnalysis>(F);
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  // Ogni loop viene analizzato dopo la trasformazione dei precedenti: un piano calcolato prima conterrebbe valori
+  // (es. il valore finale di una riduzione) eliminati insieme al loop parallelizzato
+  SmallVector<Loop*, 4> loops(LI.rbegin(), LI.rend()); // Loop esterni, in ordine di programma
+  unsigned id = 0;
+  bool changed = false;
+
+  for (Loop *L : loops) {
+    outs() << "Loop ";
+    L->getHeader()->printAsOperand(outs(), false);
+    outs() << " (" << F.getName() << "):\n";
+
+    // LCSSA: gli usi dopo il loop passano dalle PHI dell'uscita (l'input di mem2reg non è in questa forma)
+    changed |= formLCSSARecursively(*L, DT, &LI, &SE);
+
+    ParallelPlan Plan;
+    if (!canParallelize(*L, Plan, Opts.MinIterations, SE, DI, DT, DL)) {
+      outs() << "  => sequenziale\n";
+      continue;
+    }
+    outs() << "  => parallelo (IV: " << Plan.ivs.size() << ", riduzioni: " << Plan.reductions.size()
+           << ", valori catturati: " << Plan.liveIns.size() << ")\n";
+
+    Function *Body = parallelize(*L, Plan, id++, SE, DT, LI, DL);
+    outs() << "Creato " << Body->getName() << "\n";
+    changed = true;
+  }
+
+  return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
@@ -0,0 +1,419 @@
+//-----------------------------------------------------------------------------
+// Loop Vectorization implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Vettorizzazione dei loop più interni in forma canonica (anche dopo la LoopFusion):
+    for(i=0; i<n; i++){ A[i] = B[i] + C[i]; }
+  diventa un loop che lavora su VF elementi per iterazione (<VF x i32>), seguito dal loop originale (epilogo scalare)
+  che esegue le iterazioni rimaste.
+
+LEGALITÀ:
+  • Loop più interno in simplify form, un solo exiting block (header o latch), trip count calcolabile da SCEV
+  • Corpo senza salti interni (ogni blocco domina il latch) e senza chiamate
+  • Le PHI dell'header sono tutte induction variable affini con step costante (niente riduzioni)
+  • Load/store con indirizzo {start,+,sizeof(T)}<L> (passo unitario) o, solo per i load, invariante
+  • Dipendenze: stessi controlli della LoopFusion (LoopFusion.cpp)
+    • Basi diverse: AA deve separare gli interi oggetti base, non i singoli accessi (mayAliasAcrossArrays)
+    • Stessa base: la distanza SCEV tra gli accessi deve essere costante. Se l'accesso che viene dopo nel corpo
+      tocca l'elemento che il primo toccherà d iterazioni dopo (d > 0), VF non può superare d
+
+TRASFORMAZIONE:
+  • VF = larghezza dei registri vettoriali (TTI) / tipo più largo usato nel corpo, limitato dalle dipendenze
+  • n.vec = BTC & -VF iterazioni vettoriali (per i loop ruotati resta sempre almeno un'iterazione scalare)
+       preheader ──(n.vec == 0)──> scalar.ph ──> loop originale (epilogo)
+           └──> vec.body (vec.iv += VF) ──┘      (le IV ripartono da start + n.vec * step)
+  • Il loop scalare viene marcato llvm.loop.isvectorized: un secondo vec (o fs/tune che rieseguono la pipeline)
+    non lo vettorizza di nuovo
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+// Analisi di un loop candidato
+struct VectorizationPlan {
+  SmallVector<Instruction*, 32> body;                        // Istruzioni del corpo in ordine di esecuzione
+  SmallVector<Instruction*, 8> memory;                       // Load/store in ordine di esecuzione
+  SmallVector<std::pair<PHINode*, const SCEVAddRecExpr*>, 4> ivs;
+  SmallPtrSet<Instruction*, 16> demanded;                    // Istruzioni da vettorizzare (usate dagli store)
+  unsigned MaxVF = ~0U;                                      // Limite dato dalle dipendenze
+  unsigned WidestBits = 8;
+};
+
+// Passo unitario: {start,+,sizeof(T)}<L>
+const SCEVAddRecExpr *getUnitStrideAddress(Instruction *I, Loop &L, ScalarEvolution &SE, const DataLayout &DL) {
+  auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(getLoadStorePointerOperand(I)));
+  if (!AR || AR->getLoop() != &L || !AR->isAffine() || !SE.isLoopInvariant(AR->getStart(), &L)) return nullptr;
+
+  auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+  if (!Step || Step->getAPInt() != DL.getTypeAllocSize(getLoadStoreType(I))) return nullptr;
+  return AR;
+}
+
+// Blocchi del loop in ordine di esecuzione: header -> ... -> latch, senza salti interni
+bool getStraightLineBlocks(Loop &L, SmallVectorImpl<BasicBlock*> &blocks) {
+  BasicBlock *BB = L.getHeader();
+  while (true) {
+    blocks.push_back(BB);
+    if (BB == L.getLoopLatch()) break;
+
+    BasicBlock *Next = nullptr;
+    for (BasicBlock *Succ : successors(BB)) {
+      if (!L.contains(Succ)) continue;
+      if (Next || Succ == L.getHeader()) return false;
+      Next = Succ;
+    }
+    if (!Next || Next->getSinglePredecessor() != BB) return false;
+    BB = Next;
+  }
+  return blocks.size() == L.getNumBlocks();
+}
+
+// Tipo vettorizzabile: interi e floating point
+static bool isVectorizableType(Type *Ty) {
+  return Ty->isIntegerTy() || Ty->isFloatingPointTy();
+}
+
+// Le istruzioni usate (direttamente o no) dai valori salvati dagli store diventano vettori
+bool collectDemanded(Value *V, Loop &L, VectorizationPlan &Plan, const DenseMap<PHINode*, const SCEVAddRecExpr*> &ivs) {
+  auto *I = dyn_cast<Instruction>(V);
+  if (!I || !L.contains(I) || Plan.demanded.count(I)) return true;
+  if (!isVectorizableType(I->getType())) {
+    outs() << "  - Tipo non vettorizzabile: " << *I << "\n";
+    return false;
+  }
+
+  Plan.demanded.insert(I);
+  if (!I->getType()->isIntegerTy(1))
+    Plan.WidestBits = std::max<unsigned>(Plan.WidestBits, I->getType()->getScalarSizeInBits());
+
+  if (auto *Phi = dyn_cast<PHINode>(I)) return ivs.count(Phi); // Solo IV (le altre PHI sono già escluse)
+  if (isa<LoadInst>(I)) return true;
+
+  if (!isa<BinaryOperator>(I) && !isa<UnaryOperator>(I) && !isa<CastInst>(I) && !isa<CmpInst>(I) && !isa<SelectInst>(I)) {
+    outs() << "  - Istruzione non vettorizzabile: " << *I << "\n";
+    return false;
+  }
+
+  for (Value *Op : I->operands()) {
+    if (!collectDemanded(Op, L, Plan, ivs)) return false;
+  }
+  return true;
+}
+
+// Dipendenze tra gli accessi del loop: stesse regole della LoopFusion, con la distanza convertita in iterazioni
+bool checkDependencies(Loop &L, VectorizationPlan &Plan, ScalarEvolution &SE, AAResults &AA, const DataLayout &DL) {
+  for (unsigned a = 0; a < Plan.memory.size(); a++) {
+    for (unsigned b = a + 1; b < Plan.memory.size(); b++) {
+      Instruction *First = Plan.memory[a], *Second = Plan.memory[b];
+      if (isa<LoadInst>(First) && isa<LoadInst>(Second)) continue;
+
+      if (mayAliasAcrossArrays(*First, *Second, AA)) {
+        outs() << "  - Possible alias: " << *First << " / " << *Second << "\n";
+        return false;
+      }
+
+      Value *Ptr1 = getLoadStorePointerOperand(First), *Ptr2 = getLoadStorePointerOperand(Second);
+      if (getUnderlyingObject(Ptr1) != getUnderlyingObject(Ptr2)) continue; // Basi diverse separate da AA
+
+      const SCEV *Diff = SE.getMinusSCEV(SE.getSCEV(Ptr2), SE.getSCEV(Ptr1));
+      auto *ConstDiff = dyn_cast<SCEVConstant>(Diff);
+      uint64_t Size = DL.getTypeAllocSize(getLoadStoreType(First));
+      if (!ConstDiff || Size != DL.getTypeAllocSize(getLoadStoreType(Second)) ||
+          ConstDiff->getAPInt().srem(Size) != 0) {
+        outs() << "  - The distance between the accesses is not constant: " << *First << " / " << *Second << "\n";
+        return false;
+      }
+
+      // Second all'iterazione i tocca l'elemento di First all'iterazione i + d: nel loop vettoriale First viene
+      // eseguito per VF iterazioni prima di Second, quindi con d > 0 al massimo d iterazioni per vettore
+      int64_t d = ConstDiff->getAPInt().getSExtValue() / (int64_t)Size;
+      if (d > 0) {
+        outs() << "  - Dependence distance " << d << ": " << *First << " / " << *Second << "\n";
+        Plan.MaxVF = std::min<unsigned>(Plan.MaxVF, d);
+      }
+    }
+  }
+  return true;
+}
+
+bool canVectorize(Loop &L, VectorizationPlan &Plan, ScalarEvolution &SE, AAResults &AA, const DataLayout &DL) {
+  // Epilogo scalare di una vettorizzazione precedente (es. p=vec,vec): resta scalare
+  if (getBooleanLoopAttribute(&L, "llvm.loop.isvectorized")) {
+    outs() << "  - Già vettorizzato (llvm.loop.isvectorized)\n";
+    return false;
+  }
+
+  if (!L.isInnermost() || !L.isLoopSimplifyForm() || !L.getExitBlock()) {
+    outs() << "  - Non è un loop interno in simplify form con una sola uscita\n";
+    return false;
+  }
+
+  BasicBlock *Exiting = L.getExitingBlock();
+  if (!Exiting || (Exiting != L.getHeader() && Exiting != L.getLoopLatch())) {
+    outs() << "  - Il loop deve uscire dall'header o dal latch\n";
+    return false;
+  }
+
+  const SCEV *BTC = SE.getBackedgeTakenCount(&L);
+  SCEVExpander Expander(SE, DL, "vec");
+  if (isa<SCEVCouldNotCompute>(BTC) || !Expander.isSafeToExpand(BTC)) {
+    outs() << "  - Trip count non calcolabile\n";
+    return false;
+  }
+
+  SmallVector<BasicBlock*, 8> blocks;
+  if (!getStraightLineBlocks(L, blocks)) {
+    outs() << "  - Il corpo ha salti interni\n";
+    return false;
+  }
+
+  // PHI dell'header: solo IV affini con step costante
+  DenseMap<PHINode*, const SCEVAddRecExpr*> ivs;
+  for (PHINode &Phi : L.getHeader()->phis()) {
+    auto *AR = SE.isSCEVable(Phi.getType()) ? dyn_cast<SCEVAddRecExpr>(SE.getSCEV(&Phi)) : nullptr;
+    if (!Phi.getType()->isIntegerTy() || !AR || AR->getLoop() != &L || !AR->isAffine() ||
+        !isa<SCEVConstant>(AR->getStepRecurrence(SE)) || !Expander.isSafeToExpand(AR->getStart())) {
+      outs() << "  - PHI non supportata (riduzione o ricorrenza): " << Phi << "\n";
+      return false;
+    }
+    ivs[&Phi] = AR;
+    Plan.ivs.push_back({&Phi, AR});
+  }
+
+  for (BasicBlock *BB : blocks) {
+    for (Instruction &I : *BB) {
+      if (isa<PHINode>(I) || I.isTerminator() || isa<DbgInfoIntrinsic>(I)) continue;
+      Plan.body.push_back(&I);
+
+      if (isa<CallBase>(I)) {
+        outs() << "  - Chiamata nel corpo: " << I << "\n";
+        return false;
+      }
+      if (!isa<LoadInst>(I) && !isa<StoreInst>(I)) continue;
+
+      if (I.isVolatile() || I.isAtomic() || !isVectorizableType(getLoadStoreType(&I))) {
+        outs() << "  - Accesso non vettorizzabile: " << I << "\n";
+        return false;
+      }
+
+      bool invariantLoad = isa<LoadInst>(I) && SE.isLoopInvariant(SE.getSCEV(getLoadStorePointerOperand(&I)), &L) &&
+                           Expander.isSafeToExpand(SE.getSCEV(getLoadStorePointerOperand(&I)));
+      if (!invariantLoad) {
+        const SCEVAddRecExpr *AR = getUnitStrideAddress(&I, L, SE, DL);
+        if (!AR || !Expander.isSafeToExpand(AR->getStart())) {
+          outs() << "  - Accesso senza passo unitario: " << I << "\n";
+          return false;
+        }
+      }
+
+      Plan.memory.push_back(&I);
+      Plan.WidestBits = std::max<unsigned>(Plan.WidestBits, getLoadStoreType(&I)->getScalarSizeInBits());
+      if (auto *Store = dyn_cast<StoreInst>(&I)) {
+        if (!collectDemanded(Store->getValueOperand(), L, Plan, ivs)) return false;
+      }
+    }
+  }
+
+  // NB: i valori usati dopo il loop non vanno ricostruiti, l'ultima iterazione è sempre scalare (n.vec <= BTC)
+  if (none_of(Plan.memory, [](Instruction *I) { return isa<StoreInst>(I); })) {
+    outs() << "  - Nessuno store da vettorizzare\n";
+    return false;
+  }
+
+  return checkDependencies(L, Plan, SE, AA, DL);
+}
+
+// Vettore della IV: start + (vec.iv + <0, 1, ..., VF-1>) * step
+Value *widenInductionVariable(IRBuilder<> &Builder, PHINode *Phi, const SCEVAddRecExpr *AR, Value *Start, Value *VecIV, unsigned VF,
+                              ScalarEvolution &SE) {
+  Type *Ty = Phi->getType();
+  const APInt &Step = cast<SCEVConstant>(AR->getStepRecurrence(SE))->getAPInt();
+  Value *Base = Builder.CreateAdd(Start, Builder.CreateMul(Builder.CreateTrunc(VecIV, Ty), ConstantInt::get(Ty, Step)));
+
+  SmallVector<Constant*, 16> lanes;
+  for (unsigned k = 0; k < VF; k++) lanes.push_back(ConstantInt::get(Ty, Step * k));
+  return Builder.CreateAdd(Builder.CreateVectorSplat(VF, Base), ConstantVector::get(lanes), Phi->getName() + ".vec");
+}
+
+void vectorize(Loop &L, VectorizationPlan &Plan, unsigned VF, ScalarEvolution &SE, DominatorTree &DT, LoopInfo &LI,
+               const DataLayout &DL) {
+  Function &F = *L.getHeader()->getParent();
+  LLVMContext &C = F.getContext();
+  BasicBlock *Preheader = L.getLoopPreheader();
+  BasicBlock *Header = L.getHeader();
+  Type *IdxTy = DL.getIndexType(PointerType::get(C, 0));
+  SCEVExpander Expander(SE, DL, "vec");
+
+  // STEP 1: Nel preheader: n.vec = BTC & -VF, valori di partenza delle IV e degli indirizzi
+  Instruction *Term = Preheader->getTerminator();
+  IRBuilder<> PHBuilder(Term);
+  Value *BTC = Expander.expandCodeFor(SE.getBackedgeTakenCount(&L), nullptr, Term);
+  Value *NVec = PHBuilder.CreateAnd(PHBuilder.CreateZExtOrTrunc(BTC, IdxTy), ConstantInt::get(IdxTy, -(int64_t)VF, /*IsSigned*/ true), "n.vec");
+
+  DenseMap<PHINode*, Value*> starts;
+  for (auto [Phi, AR] : Plan.ivs) starts[Phi] = Expander.expandCodeFor(AR->getStart(), Phi->getType(), Term);
+
+  DenseMap<Instruction*, Value*> addresses;
+  for (Instruction *I : Plan.memory) {
+    Value *Ptr = getLoadStorePointerOperand(I);
+    if (const SCEVAddRecExpr *AR = getUnitStrideAddress(I, L, SE, DL))
+      addresses[I] = Expander.expandCodeFor(AR->getStart(), Ptr->getType(), Term);
+    else
+      addresses[I] = Expander.expandCodeFor(SE.getSCEV(Ptr), Ptr->getType(), Term); // Load invariante
+  }
+
+  // STEP 2: Blocchi nuovi: scalar.ph tra il preheader e l'header, vec.body prima dell'epilogo
+  BasicBlock *ScalarPH = SplitEdge(Preheader, Header, &DT, &LI);
+  ScalarPH->setName("scalar.ph");
+  BasicBlock *VecBody = BasicBlock::Create(C, "vec.body", &F, ScalarPH);
+
+  // Il loop vettoriale è fratello del loop scalare
+  Loop *VecLoop = LI.AllocateLoop();
+  if (Loop *Parent = L.getParentLoop()) Parent->addChildLoop(VecLoop);
+  else LI.addTopLevelLoop(VecLoop);
+  VecLoop->addBasicBlockToLoop(VecBody, LI);
+
+  // STEP 3: Le IV del loop scalare ripartono da start + n.vec * step
+  PHBuilder.SetInsertPoint(Preheader->getTerminator());
+  for (auto [Phi, AR] : Plan.ivs) {
+    const APInt &Step = cast<SCEVConstant>(AR->getStepRecurrence(SE))->getAPInt();
+    Value *Offset = PHBuilder.CreateMul(PHBuilder.CreateTrunc(NVec, Phi->getType()), ConstantInt::get(Phi->getType(), Step));
+    Phi->setIncomingValueForBlock(ScalarPH, PHBuilder.CreateAdd(starts[Phi], Offset, Phi->getName() + ".resume"));
+  }
+
+  Value *Skip = PHBuilder.CreateICmpEQ(NVec, ConstantInt::get(IdxTy, 0), "vec.skip");
+  BranchInst::Create(ScalarPH, VecBody, Skip, Preheader->getTerminator());
+  Preheader->getTerminator()->eraseFromParent();
+
+  // STEP 4: Corpo vettoriale, nello stesso ordine del corpo originale
+  IRBuilder<> Builder(VecBody);
+  PHINode *VecIV = Builder.CreatePHI(IdxTy, 2, "vec.iv");
+
+  DenseMap<Value*, Value*> widened;
+  std::function<Value*(Value*)> getVector = [&](Value *V) -> Value* {
+    if (Value *W = widened.lookup(V)) return W;
+    auto *I = dyn_cast<Instruction>(V);
+    if (!I || !L.contains(I)) {
+      // Invariante: splat nel preheader
+      IRBuilder<> SplatBuilder(Preheader->getTerminator());
+      return widened[V] = SplatBuilder.CreateVectorSplat(VF, V);
+    }
+    auto *Phi = cast<PHINode>(I); // Le altre istruzioni sono già state vettorizzate (ordine del corpo)
+    const SCEVAddRecExpr *AR = nullptr;
+    for (auto [P, R] : Plan.ivs) {
+      if (P == Phi) AR = R;
+    }
+    return widened[V] = widenInductionVariable(Builder, Phi, AR, starts[Phi], VecIV, VF, SE);
+  };
+
+  for (Instruction *I : Plan.body) {
+    if (auto *Load = dyn_cast<LoadInst>(I)) {
+      if (!Plan.demanded.count(I)) continue;
+      Value *Vec;
+      if (getUnitStrideAddress(I, L, SE, DL)) {
+        Value *Addr = Builder.CreateGEP(Load->getType(), addresses[I], VecIV, "vec.addr");
+        Vec = Builder.CreateAlignedLoad(FixedVectorType::get(Load->getType(), VF), Addr, Load->getAlign(), Load->getName() + ".vec");
+      } else {
+        Vec = Builder.CreateVectorSplat(VF, Builder.CreateAlignedLoad(Load->getType(), addresses[I], Load->getAlign()),
+                                        Load->getName() + ".vec");
+      }
+      cast<Instruction>(Vec)->copyMetadata(*Load, {LLVMContext::MD_alias_scope, LLVMContext::MD_noalias});
+      widened[I] = Vec;
+    } else if (auto *Store = dyn_cast<StoreInst>(I)) {
+      Type *Ty = Store->getValueOperand()->getType();
+      Value *Addr = Builder.CreateGEP(Ty, addresses[I], VecIV, "vec.addr");
+      StoreInst *VecStore = Builder.CreateAlignedStore(getVector(Store->getValueOperand()), Addr, Store->getAlign());
+      VecStore->copyMetadata(*Store, {LLVMContext::MD_alias_scope, LLVMContext::MD_noalias});
+    } else if (Plan.demanded.count(I)) {
+      SmallVector<Value*, 3> ops;
+      for (Value *Op : I->operands()) ops.push_back(getVector(Op));
+
+      Instruction *New;
+      if (auto *Cast = dyn_cast<CastInst>(I))
+        New = CastInst::Create(Cast->getOpcode(), ops[0], FixedVectorType::get(Cast->getDestTy(), VF));
+      else if (auto *Cmp = dyn_cast<CmpInst>(I))
+        New = CmpInst::Create(Cmp->getOpcode(), Cmp->getPredicate(), ops[0], ops[1]);
+      else if (isa<SelectInst>(I))
+        New = SelectInst::Create(ops[0], ops[1], ops[2]);
+      else if (auto *UnOp = dyn_cast<UnaryOperator>(I))
+        New = UnaryOperator::Create(UnOp->getOpcode(), ops[0]);
+      else
+        New = BinaryOperator::Create(cast<BinaryOperator>(I)->getOpcode(), ops[0], ops[1]);
+
+      New->copyIRFlags(I);
+      New->setName(I->getName() + ".vec");
+      Builder.Insert(New);
+      widened[I] = New;
+    }
+  }
+
+  Value *Next = Builder.CreateAdd(VecIV, ConstantInt::get(IdxTy, VF), "vec.iv.next", /*HasNUW*/ true);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Next, NVec, "vec.done"), ScalarPH, VecBody);
+  VecIV->addIncoming(ConstantInt::get(IdxTy, 0), Preheader);
+  VecIV->addIncoming(Next, VecBody);
+
+  // STEP 5: Il loop scalare (epilogo) non va più vettorizzato
+  addStringMetadataToLoop(&L, "llvm.loop.isvectorized", 1);
+}
+
+PreservedAnalyses LoopVectorizationPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  AAResults &AA = AM.getResult<AAManager>(F);
+  TargetTransformInfo &TTI = AM.getResult<TargetIRAnalysis>(F);
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  unsigned RegisterBits = TTI.getRegisterBitWidth(TargetTransformInfo::RGK_FixedWidthVector).getFixedValue();
+
+  // I loop vengono raccolti prima: la trasformazione aggiunge i loop vettoriali
+  SmallVector<Loop*, 8> loops;
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    if (L->isInnermost()) loops.push_back(L);
+  }
+
+  bool changed = false;
+  for (Loop *L : loops) {
+    outs() << "Loop ";
+    L->getHeader()->printAsOperand(outs(), false);
+    outs() << " (" << F.getName() << "):\n";
+
+    VectorizationPlan Plan;
+    if (!canVectorize(*L, Plan, SE, AA, DL)) {
+      outs() << "  => VF = 1 (non vettorizzato)\n";
+      continue;
+    }
+
+    // VF: quanti elementi del tipo più largo stanno in un registro vettoriale, al massimo la distanza delle dipendenze
+    unsigned VF = RegisterBits / Plan.WidestBits;
+    if (Plan.MaxVF < VF) VF = Plan.MaxVF;
+    VF = VF ? 1u << Log2_32(VF) : 0;
+    if (VF < 2) {
+      outs() << "  => VF = 1 (registri da " << RegisterBits << " bit, elementi da " << Plan.WidestBits
+             << " bit, limite dipendenze " << Plan.MaxVF << ")\n";
+      continue;
+    }
+
+    vectorize(*L, Plan, VF, SE, DT, LI, DL);
+    outs() << "  => VF = " << VF << " (registri da " << RegisterBits << " bit, elementi da " << Plan.WidestBits << " bit)\n";
+
+    SE.forgetLoop(L);
+    DT.recalculate(F);
+    changed = true;
+  }
+
+  return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
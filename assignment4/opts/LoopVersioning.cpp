@@ -0,0 +1,302 @@
+//-----------------------------------------------------------------------------
+// Loop Versioning implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Con array passati come puntatori (int *A, int *B) non si può dimostrare che A e B non si sovrappongano:
+  LoopFusion non può escludere dipendenze tra accessi con basi diverse e rinuncia.
+  Il passo "lvr" crea una seconda versione dei loop in cui gli accessi sono marcati no-alias,
+  eseguita solo se a runtime gli intervalli di memoria non si sovrappongono (es. p=lvr,lf).
+
+ALGORITMO:
+  • Regione: sequenza di loop (top-level) adiacenti, dalla guardia/preheader del primo all'uscita dell'ultimo,
+    così i loop da fondere vengono versionati insieme e restano adiacenti nel clone
+  • Per ogni load/store della regione: base (SE.getPointerBase) e intervallo [Low, High) degli indirizzi:
+    {start,+,step}<L> copre start ... start + step * BTC (+ la dimensione dell'accesso), dal loop più interno
+  • Servono controlli solo per le coppie di basi diverse, di cui almeno una scritta, che AA non separa già
+  • Controllo: High_A <= Low_B || High_B <= Low_A per ogni coppia
+  • La regione viene clonata: il clone (fast path) ha i metadati alias.scope/noalias (uno scope per base),
+    l'originale resta come fallback
+
+      check ──(nessuna sovrapposizione)──> regione.lver ──┐
+        └──────────────(altrimenti)───────> regione ──────┴──> uscita (PHI per i valori usati dopo la regione)
+*/
+
+#include "LocalOpts.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+// Accessi alla stessa base e intervallo [Low, High) degli indirizzi toccati nella regione
+struct AccessGroup {
+  Value *Base;
+  const SCEV *Low = nullptr;
+  const SCEV *High = nullptr;
+  bool written = false;
+  SmallVector<Instruction*, 4> accesses;
+  SmallVector<unsigned, 4> checkedWith; // Gruppi separati dal controllo a runtime
+};
+
+// Primo blocco della regione di un loop (la guardia se c'è, altrimenti il preheader) e blocco dopo la regione
+BasicBlock *getRegionEntry(Loop &L) {
+  return L.isGuarded() ? L.getLoopGuardBranch()->getParent() : L.getLoopPreheader();
+}
+
+BasicBlock *getRegionExit(Loop &L) {
+  return L.isGuarded() ? getExitGuardSuccessor(L) : L.getExitBlock();
+}
+
+// Valore minimo (o massimo) di S su tutte le iterazioni di L: S è invariante oppure una ricorrenza affine di L
+const SCEV *getExtreme(const SCEV *S, Loop *L, bool Max, ScalarEvolution &SE) {
+  auto *AR = dyn_cast<SCEVAddRecExpr>(S);
+  if (!AR || AR->getLoop() != L) return SE.isLoopInvariant(S, L) ? S : nullptr;
+
+  const SCEV *BTC = SE.getBackedgeTakenCount(L);
+  if (!AR->isAffine() || isa<SCEVCouldNotCompute>(BTC)) return nullptr;
+
+  const SCEV *Start = AR->getStart();
+  const SCEV *End = AR->evaluateAtIteration(BTC, SE);
+  const SCEV *Step = AR->getStepRecurrence(SE);
+
+  // Con lo step di segno noto gli estremi sono start ed end, altrimenti min/max
+  if (SE.isKnownNonNegative(Step)) return Max ? End : Start;
+  if (SE.isKnownNonPositive(Step)) return Max ? Start : End;
+  return Max ? SE.getSMaxExpr(Start, End) : SE.getSMinExpr(Start, End);
+}
+
+// Intervallo [Low, High) degli offset (rispetto alla base) toccati da un accesso di Size byte in L e nei loop che lo contengono
+bool getAccessRange(const SCEV *Offset, Loop *L, uint64_t Size, ScalarEvolution &SE, const SCEV *&Low, const SCEV *&High) {
+  Low = High = Offset;
+  for (; L; L = L->getParentLoop()) {
+    Low = getExtreme(Low, L, false, SE);
+    High = getExtreme(High, L, true, SE);
+    if (!Low || !High) return false;
+  }
+
+  High = SE.getAddExpr(High, SE.getConstant(Offset->getType(), Size));
+  return true;
+}
+
+// Blocchi della regione: raggiungibili da Entry senza passare da Exit, tutti dominati da Entry
+bool collectRegion(BasicBlock *Entry, BasicBlock *Exit, DominatorTree &DT, SmallSetVector<BasicBlock*, 16> &region) {
+  SmallVector<BasicBlock*, 16> worklist = {Entry};
+  region.insert(Entry);
+
+  while (!worklist.empty()) {
+    BasicBlock *BB = worklist.pop_back_val();
+    if (!DT.dominates(Entry, BB)) return false; // Più di un ingresso
+
+    for (BasicBlock *Succ : successors(BB)) {
+      if (Succ != Exit && region.insert(Succ)) worklist.push_back(Succ);
+    }
+  }
+
+  // Si esce dalla regione solo da Exit
+  return all_of(predecessors(Exit), [&](BasicBlock *Pred) { return region.contains(Pred); });
+}
+
+bool versionRegion(ArrayRef<Loop*> loops, Function &F, LoopInfo &LI, DominatorTree &DT, ScalarEvolution &SE, AAResults &AA) {
+  BasicBlock *Entry = getRegionEntry(*loops.front());
+  BasicBlock *Exit = getRegionExit(*loops.back());
+  if (!Entry || !Exit) return false;
+
+  outs() << "Regione " << Entry->getName() << " -> " << Exit->getName() << " (" << loops.size() << " loop)\n";
+
+  SmallSetVector<BasicBlock*, 16> region;
+  if (!collectRegion(Entry, Exit, DT, region)) {
+    outs() << "  - La regione non ha un solo ingresso e una sola uscita\n";
+    return false;
+  }
+
+  // Accessi raggruppati per base
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  MapVector<Value*, AccessGroup> groups;
+  for (BasicBlock *BB : region) {
+    for (Instruction &I : *BB) {
+      if (!isa<LoadInst>(I) && !isa<StoreInst>(I)) continue;
+      if (I.isVolatile() || I.isAtomic()) return false;
+
+      Value *Ptr = getLoadStorePointerOperand(&I);
+      Type *AccessTy = getLoadStoreType(&I);
+      const SCEV *PtrS = SE.getSCEV(Ptr);
+      auto *BaseS = dyn_cast<SCEVUnknown>(SE.getPointerBase(PtrS));
+      if (!BaseS) return false;
+
+      const SCEV *Low, *High;
+      if (!getAccessRange(SE.getMinusSCEV(PtrS, BaseS), LI.getLoopFor(BB), DL.getTypeStoreSize(AccessTy), SE, Low, High)) {
+        outs() << "  - Intervallo non calcolabile per " << I << "\n";
+        return false;
+      }
+
+      AccessGroup &G = groups.insert({BaseS->getValue(), AccessGroup{BaseS->getValue()}}).first->second;
+      G.Low = G.Low ? SE.getSMinExpr(G.Low, Low) : Low;
+      G.High = G.High ? SE.getSMaxExpr(G.High, High) : High;
+      G.written |= isa<StoreInst>(I);
+      G.accesses.push_back(&I);
+    }
+  }
+
+  // Il controllo viene calcolato prima della regione: gli intervalli devono essere disponibili lì
+  SCEVExpander Expander(SE, DL, "lver");
+  Instruction *InsertPt = Entry->getFirstNonPHI();
+
+  SmallVector<std::pair<unsigned, unsigned>, 4> checks;
+  for (unsigned i = 0; i < groups.size(); i++) {
+    for (unsigned j = i + 1; j < groups.size(); j++) {
+      AccessGroup &A = groups.begin()[i].second;
+      AccessGroup &B = groups.begin()[j].second;
+      if (!A.written && !B.written) continue;
+      if (AA.isNoAlias(MemoryLocation::getBeforeOrAfter(A.Base), MemoryLocation::getBeforeOrAfter(B.Base))) continue;
+
+      for (AccessGroup *G : {&A, &B}) {
+        const SCEV *Base = SE.getSCEV(G->Base);
+        if (!Expander.isSafeToExpandAt(SE.getAddExpr(Base, G->Low), InsertPt) ||
+            !Expander.isSafeToExpandAt(SE.getAddExpr(Base, G->High), InsertPt)) {
+          outs() << "  - Intervallo di " << G->Base->getName() << " non disponibile prima della regione\n";
+          return false;
+        }
+      }
+      checks.push_back({i, j});
+    }
+  }
+
+  if (checks.empty()) {
+    outs() << "  - Nessuna coppia di accessi da controllare\n";
+    return false;
+  }
+
+  // STEP 1: Il primo blocco viene diviso: le PHI restano nel blocco del controllo, il resto apre la regione
+  BasicBlock *Check = Entry;
+  BasicBlock *Body = SplitBlock(Entry, Entry->getFirstNonPHI(), &DT, &LI, nullptr, Entry->getName() + ".lver.orig");
+  region.remove(Entry);
+  region.insert(Body);
+
+  // STEP 2: Controllo a runtime, per ogni coppia: High_A <= Low_B || High_B <= Low_A
+  IRBuilder<> Builder(Check->getTerminator());
+  Value *NoConflict = nullptr;
+  for (auto [i, j] : checks) {
+    AccessGroup &A = groups.begin()[i].second;
+    AccessGroup &B = groups.begin()[j].second;
+    Type *PtrTy = A.Base->getType();
+
+    auto expandBound = [&](AccessGroup &G, const SCEV *Offset) {
+      return Expander.expandCodeFor(SE.getAddExpr(SE.getSCEV(G.Base), Offset), PtrTy, Check->getTerminator());
+    };
+    Value *LowA = expandBound(A, A.Low), *HighA = expandBound(A, A.High);
+    Value *LowB = expandBound(B, B.Low), *HighB = expandBound(B, B.High);
+
+    Value *Separated = Builder.CreateOr(Builder.CreateICmpULE(HighA, LowB, "lver.before"),
+                                        Builder.CreateICmpULE(HighB, LowA, "lver.after"), "lver.sep");
+    NoConflict = NoConflict ? Builder.CreateAnd(NoConflict, Separated, "lver.noalias") : Separated;
+
+    A.checkedWith.push_back(j);
+    B.checkedWith.push_back(i);
+    outs() << "  - Controllo " << A.Base->getName() << " [" << *A.Low << ", " << *A.High << ") / "
+           << B.Base->getName() << " [" << *B.Low << ", " << *B.High << ")\n";
+  }
+
+  // STEP 3: Clone della regione (fast path)
+  ValueToValueMapTy VMap;
+  SmallVector<BasicBlock*, 16> clones;
+  for (BasicBlock *BB : region) {
+    BasicBlock *Clone = CloneBasicBlock(BB, VMap, ".lver", &F);
+    VMap[BB] = Clone;
+    clones.push_back(Clone);
+  }
+  remapInstructionsInBlocks(clones, VMap);
+  SmallPtrSet<BasicBlock*, 16> cloned(clones.begin(), clones.end());
+
+  // STEP 4: Le PHI dell'uscita ricevono anche i valori del clone
+  for (PHINode &Phi : Exit->phis()) {
+    for (unsigned k = 0, e = Phi.getNumIncomingValues(); k < e; k++) {
+      Value *V = Phi.getIncomingValue(k);
+      Value *Mapped = VMap.lookup(V);
+      Phi.addIncoming(Mapped ? Mapped : V, cast<BasicBlock>(VMap[Phi.getIncomingBlock(k)]));
+    }
+  }
+
+  // STEP 5: I valori della regione usati dopo l'uscita diventano PHI tra originale e clone
+  for (BasicBlock *BB : region) {
+    for (Instruction &I : *BB) {
+      PHINode *Merged = nullptr;
+      for (Use &U : make_early_inc_range(I.uses())) {
+        auto *UserInst = cast<Instruction>(U.getUser());
+        if (region.contains(UserInst->getParent()) || cloned.count(UserInst->getParent())) continue;
+        if (UserInst->getParent() == Exit && isa<PHINode>(UserInst)) continue; // STEP 4
+
+        if (!Merged) {
+          Merged = PHINode::Create(I.getType(), pred_size(Exit), I.getName() + ".lver", &Exit->front());
+          for (BasicBlock *Pred : predecessors(Exit))
+            Merged->addIncoming(cloned.count(Pred) ? (Value*)VMap[&I] : &I, Pred);
+        }
+        U.set(Merged);
+      }
+    }
+  }
+
+  // STEP 6: Scelta a runtime tra clone e originale
+  BranchInst::Create(cast<BasicBlock>(VMap[Body]), Body, NoConflict, Check->getTerminator());
+  Check->getTerminator()->eraseFromParent();
+
+  // STEP 7: Nel clone ogni base ha il suo scope ed è no-alias con le basi controllate
+  MDBuilder MDB(F.getContext());
+  MDNode *Domain = MDB.createAnonymousAliasScopeDomain("LVerDomain");
+  SmallVector<MDNode*, 8> scopes;
+  for (auto &[Base, G] : groups)
+    scopes.push_back(MDB.createAnonymousAliasScope(Domain, Base->getName()));
+
+  for (unsigned i = 0; i < groups.size(); i++) {
+    AccessGroup &G = groups.begin()[i].second;
+    SmallVector<Metadata*, 4> noAlias;
+    for (unsigned j : G.checkedWith) noAlias.push_back(scopes[j]);
+
+    for (Instruction *I : G.accesses) {
+      auto *Clone = cast<Instruction>(VMap[I]);
+      Clone->setMetadata(LLVMContext::MD_alias_scope,
+                         MDNode::concatenate(Clone->getMetadata(LLVMContext::MD_alias_scope), MDNode::get(F.getContext(), scopes[i])));
+      if (!noAlias.empty())
+        Clone->setMetadata(LLVMContext::MD_noalias,
+                           MDNode::concatenate(Clone->getMetadata(LLVMContext::MD_noalias), MDNode::get(F.getContext(), noAlias)));
+    }
+  }
+
+  outs() << "  - Regione versionata: " << checks.size() << " controlli, " << clones.size() << " blocchi clonati\n";
+  return true;
+}
+
+PreservedAnalyses LoopVersioningPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  AAResults &AA = AM.getResult<AAManager>(F);
+
+  // Sequenze di loop adiacenti, in ordine di programma (LoopInfo ha i loop top-level in ordine inverso)
+  SmallVector<SmallVector<Loop*, 4>, 4> regions;
+  for (Loop *L : reverse(LI)) {
+    BasicBlock *Entry = getRegionEntry(*L);
+    if (!regions.empty() && Entry && getRegionExit(*regions.back().back()) == Entry)
+      regions.back().push_back(L);
+    else
+      regions.push_back({L});
+  }
+
+  bool changed = false;
+  for (auto &loops : regions) {
+    if (versionRegion(loops, F, LI, DT, SE, AA)) {
+      // I blocchi clonati non sono in DominatorTree e LoopInfo: le regioni successive sono disgiunte, basta il DT
+      DT.recalculate(F);
+      for (Loop *L : loops) SE.forgetLoop(L);
+      changed = true;
+    }
+  }
+
+  return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+// Scalar Replacement (store-to-load forwarding) implementation
+//-----------------------------------------------------------------------------
+
+/*
+  Dopo la LoopFusion il corpo fuso salva un valore e lo rilegge subito (test5.cpp):
+    for(i...){ A[i] = a + b; B[i] = A[i]; }          ->   t = a + b; A[i] = t; B[i] = t;
+  oppure rilegge il valore salvato qualche iterazione prima:
+    for(i...){ A[i+1] = x; B[i] = A[i+1] + A[i]; }   ->   A[i] è la x dell'iterazione precedente
+
+ALGORITMO (loop più interni in simplify form):
+  • Store S: indirizzo {start,+,step}<L> con step costante, eseguito ad ogni iterazione (il suo blocco domina il latch)
+  • Load L dello stesso tipo: distanza SCEV costante c = indirizzo(S) - indirizzo(L)
+    • c = 0 e S domina L: L legge il valore appena salvato -> il valore di S
+    • c = d * step con 0 < d <= MaxDistance: L legge il valore salvato d iterazioni prima ->
+      "registri rotanti", d PHI nell'header:  r1 = [init1, preheader], [valore di S, latch];  rk = [initk, preheader], [r(k-1), latch]
+      initk = valore in memoria prima del loop (load nel preheader di start - k * step, solo se sicuro)
+      Serve |step| >= dimensione dello store: così ogni iterazione di S scrive byte diversi e tra lo store letto
+      e il load S non tocca l'indirizzo letto
+  • Nessun'altra istruzione del loop può scrivere la memoria letta da L (AA):
+    • c = 0: nella stessa iterazione, la locazione letta
+    • c > 0: in una qualsiasi delle iterazioni tra lo store e il load, quindi l'intero oggetto letto (es. con
+      A[i] = x; A[i-1] = y; t = A[i-2] il valore letto è y, non la x di due iterazioni prima)
+  Lo store resta: il valore può servire dopo il loop (vedi Array Contraction)
+*/
+
+#include "LocalOpts.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/Loads.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/ScalarEvolutionExpander.h"
+
+static const unsigned MaxDistance = 4; // Registri rotanti per load
+
+// Store candidato: eseguito ad ogni iterazione, indirizzo affine con step costante
+const SCEVAddRecExpr *getForwardableStore(StoreInst *S, Loop &L, ScalarEvolution &SE, DominatorTree &DT) {
+  if (!S->isSimple() || !DT.dominates(S->getParent(), L.getLoopLatch())) return nullptr;
+  auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(S->getPointerOperand()));
+  if (!AR || AR->getLoop() != &L || !AR->isAffine()) return nullptr;
+  auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+  if (!Step || Step->getAPInt().isZero()) return nullptr;
+  return AR;
+}
+
+// Valore salvato da S d iterazioni prima: regs[k - 1] è la PHI rotante con il valore di k iterazioni prima
+// (create una volta sola per store)
+Value *getRotatingRegister(StoreInst *S, const SCEVAddRecExpr *AR, unsigned d, SmallVectorImpl<PHINode*> &regs, Loop &L,
+                           ScalarEvolution &SE, const DataLayout &DL) {
+  if (d <= regs.size()) return regs[d - 1];
+
+  BasicBlock *Preheader = L.getLoopPreheader();
+  Type *Ty = S->getValueOperand()->getType();
+  const APInt &Step = cast<SCEVConstant>(AR->getStepRecurrence(SE))->getAPInt();
+  SCEVExpander Expander(SE, DL, "scr");
+
+  // Valori prima del loop: start - k * step, letti nel preheader solo se il load non può fallire
+  SmallVector<Value*, 4> inits;
+  for (unsigned k = regs.size() + 1; k <= d; k++) {
+    const SCEV *Addr = SE.getAddExpr(AR->getStart(), SE.getConstant(-Step * k));
+    if (!Expander.isSafeToExpand(Addr)) return nullptr;
+    inits.push_back(Expander.expandCodeFor(Addr, S->getPointerOperand()->getType(), Preheader->getTerminator()));
+    if (!isSafeToLoadUnconditionally(inits.back(), Ty, S->getAlign(), DL, Preheader->getTerminator())) {
+      for (Value *Ptr : inits) RecursivelyDeleteTriviallyDeadInstructions(Ptr);
+      return nullptr;
+    }
+  }
+
+  IRBuilder<> Builder(Preheader->getTerminator());
+  for (Value *Ptr : inits) {
+    Value *Init = Builder.CreateAlignedLoad(Ty, Ptr, S->getAlign(), "scr.init");
+
+    // r1 riceve il valore salvato nell'iterazione corrente, rk quello di r(k-1)
+    Value *Next = regs.empty() ? S->getValueOperand() : regs.back();
+    PHINode *Phi = PHINode::Create(Ty, 2, "scr.reg" + Twine(regs.size() + 1), &L.getHeader()->front());
+    Phi->addIncoming(Init, Preheader);
+    Phi->addIncoming(Next, L.getLoopLatch());
+    regs.push_back(Phi);
+  }
+  return regs[d - 1];
+}
+
+bool replaceLoopLoads(Loop &L, ScalarEvolution &SE, DominatorTree &DT, AAResults &AA, const DataLayout &DL) {
+  if (!L.isLoopSimplifyForm()) return false;
+
+  SmallVector<StoreInst*, 8> stores;
+  SmallVector<LoadInst*, 8> loads;
+  SmallVector<Instruction*, 8> writers;
+  for (BasicBlock *BB : L.blocks()) {
+    for (Instruction &I : *BB) {
+      if (I.mayWriteToMemory()) writers.push_back(&I);
+      if (auto *S = dyn_cast<StoreInst>(&I)) stores.push_back(S);
+      if (auto *Load = dyn_cast<LoadInst>(&I); Load && Load->isSimple()) loads.push_back(Load);
+    }
+  }
+
+  DenseMap<StoreInst*, SmallVector<PHINode*, 4>> rotating;
+  bool changed = false;
+
+  for (LoadInst *Load : loads) {
+    for (StoreInst *S : stores) {
+      const SCEVAddRecExpr *AR = getForwardableStore(S, L, SE, DT);
+      if (!AR || S->getValueOperand()->getType() != Load->getType()) continue;
+
+      auto *Diff = dyn_cast<SCEVConstant>(SE.getMinusSCEV(AR, SE.getSCEV(Load->getPointerOperand())));
+      if (!Diff) continue;
+      const APInt &Step = cast<SCEVConstant>(AR->getStepRecurrence(SE))->getAPInt();
+      if (Diff->getAPInt().srem(Step) != 0) continue;
+      int64_t d = Diff->getAPInt().sdiv(Step).getSExtValue();
+      if (d < 0 || d > MaxDistance || (d == 0 && !DT.dominates(S, Load))) continue;
+      if (d > 0 && Step.abs().ult(DL.getTypeStoreSize(Load->getType()).getFixedValue())) continue; // S si sovrappone a sé stesso
+
+      // Solo S può scrivere la memoria letta dal load: con d > 0 gli altri store agiscono in iterazioni diverse,
+      // AA confronta gli indirizzi della stessa iterazione, quindi si controlla l'intero oggetto
+      MemoryLocation Loc = d == 0 ? MemoryLocation::get(Load)
+                                  : MemoryLocation::getBeforeOrAfter(getUnderlyingObject(Load->getPointerOperand()));
+      if (any_of(writers, [&](Instruction *W) { return W != S && isModSet(AA.getModRefInfo(W, Loc)); })) continue;
+
+      Value *Forwarded = d == 0 ? S->getValueOperand() : getRotatingRegister(S, AR, d, rotating[S], L, SE, DL);
+      if (!Forwarded) continue;
+
+      outs() << "  - " << *Load << " -> " << *Forwarded << " (distanza " << d << ")\n";
+      Value *Ptr = Load->getPointerOperand();
+      Load->replaceAllUsesWith(Forwarded);
+      Load->eraseFromParent();
+      RecursivelyDeleteTriviallyDeadInstructions(Ptr);
+      changed = true;
+      break;
+    }
+  }
+  return changed;
+}
+
+PreservedAnalyses ScalarReplacementPass::run(Function &F, FunctionAnalysisManager &AM) {
+  LoopInfo &LI = AM.getResult<LoopAnalysis>(F);
+  DominatorTree &DT = AM.getResult<DominatorTreeAnalysis>(F);
+  ScalarEvolution &SE = AM.getResult<ScalarEvolutionAnalysis>(F);
+  AAResults &AA = AM.getResult<AAManager>(F);
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  bool changed = false;
+  for (Loop *L : LI.getLoopsInPreorder()) {
+    if (!L->isInnermost()) continue;
+    outs() << "Loop ";
+    L->getHeader()->printAsOperand(outs(), false);
+    outs() << " (" << F.getName() << "):\n";
+
+    if (replaceLoopLoads(*L, SE, DT, AA, DL)) {
+      SE.forgetLoop(L);
+      changed = true;
+    }
+  }
+
+  if (!changed) return PreservedAnalyses::all();
+
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>(); // Cambiano solo le istruzioni, non i blocchi
+  return PA;
+}
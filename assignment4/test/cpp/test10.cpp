@@ -0,0 +1,22 @@
+// VETTORIZZAZIONE dopo la fusione (p=lf,vec)
+// Il loop fuso lavora su elementi consecutivi: VF = 4 con registri da 128 bit
+// Il terzo loop scrive A[i + 2], letto dal loop fuso due iterazioni dopo: non viene fuso, e con distanza 2 ha VF = 2
+int foo(int a, int b){
+    int A[21];
+    int B[21];
+
+    for(int i = 0; i < 19; i++){
+        A[i] = a * i + b;
+    }
+    for(int i = 0; i < 19; i++){
+        B[i] = A[i] - 1;
+    }
+    for(int i = 0; i < 19; i++){
+        A[i + 2] = A[i] + B[i];
+    }
+    return A[20] + B[18];
+}
+
+int main(){
+    return foo(2, 3);
+}
@@ -0,0 +1,33 @@
+// SCALAR REPLACEMENT dopo la fusione (p=lf,scr)
+int foo(int a, int b){
+    int A[11];
+    int B[10];
+    A[0] = b;
+
+    // Dopo la fusione B[i] rilegge A[i + 1], appena salvato (distanza 0), e A[i], salvato
+    // nell'iterazione precedente (distanza 1): due registri, nessun load di A nel loop
+    // (A[0] viene letto una volta sola prima del loop)
+    for(int i = 0; i < 10; i++){
+        A[i + 1] = a * i;
+    }
+    for(int i = 0; i < 10; i++){
+        B[i] = A[i + 1] + A[i];
+    }
+
+    // C[i - 2] è stato scritto per ultimo da C[i - 1] = b + i (iterazione precedente), non da C[i] = a + i
+    // (due iterazioni prima): un altro store scrive C tra i due, nessun forwarding
+    int C[12];
+    C[0] = C[1] = 0;
+    int t = 0;
+    for(int i = 2; i < 12; i++){
+        C[i] = a + i;
+        C[i - 1] = b + i;
+        t += C[i - 2];
+    }
+
+    return A[10] + B[9] + B[0] + t;
+}
+
+int main(){
+    return foo(3, 5);
+}
@@ -0,0 +1,20 @@
+// ARRAY CONTRACTION dopo la fusione (p=lf,ac)
+int foo(int a, int b){
+    int A[10];
+    int B[10];
+
+    // Dopo la fusione A[i] viene riletto nella stessa iterazione: l'array A sparisce,
+    // resta solo lo scalare di A[0] (letto dopo il loop). Lo stesso vale per B (B[9])
+    for(int i = 0; i < 10; i++){
+        A[i] = a * i + b;
+    }
+    for(int i = 0; i < 10; i++){
+        B[i] = A[i] * 2;
+    }
+
+    return A[0] + B[9];
+}
+
+int main(){
+    return foo(3, 5);
+}
@@ -0,0 +1,60 @@
+// DIPENDENZE DAL RIASSUNTO DEGLI ACCESSI (p=lf, riassunti con p=print<access-summary>)
+#include <string.h>
+
+// Chiamata opaca per il riassunto: scrive attraverso il puntatore
+__attribute__((noinline)) void set(int *p, int v){
+    *p = v;
+}
+
+int foo(int a){
+    int A[10];
+    int B[10];
+
+    for(int i = 0; i < 10; i++){
+        A[i] = i;
+    }
+
+    // Range disgiunti: il primo loop scrive A[0..5), il secondo legge A[5..10) -> FUSIONE
+    for(int i = 0; i < 5; i++){
+        A[i] = a;
+    }
+    for(int i = 0; i < 5; i++){
+        B[i] = A[i + 5];
+    }
+
+    // Il primo loop legge A[i], il secondo scrive A[i + 1]: dopo la fusione l'iterazione i + 1
+    // leggerebbe il valore appena scritto (dipendenza negativa) -> NO FUSIONE
+    for(int i = 0; i < 9; i++){
+        B[i] = A[i];
+    }
+    for(int i = 0; i < 9; i++){
+        A[i + 1] = a;
+    }
+
+    // Stesso step (4 byte) e offset 0, ma il secondo loop legge 8 byte da &A[i]: legge anche A[i + 1],
+    // che dopo la fusione non sarebbe ancora stato scritto (dipendenza negativa) -> NO FUSIONE
+    long long C[9];
+    for(int i = 0; i < 9; i++){
+        B[i] = A[i] + i;
+    }
+    for(int i = 0; i < 9; i++){
+        C[i] = *(long long *)&B[i];
+    }
+
+    // Il primo loop scrive con memset e con una chiamata, il secondo legge gli stessi elementi:
+    // il riassunto non conosce gli indirizzi toccati (accessi sconosciuti) -> NO FUSIONE
+    int M[9][4];
+    for(int i = 0; i < 9; i++){
+        memset(M[i], 0, sizeof(M[i]));
+        set(&A[i], i);
+    }
+    for(int i = 0; i < 9; i++){
+        B[i] = M[i][0] + A[i];
+    }
+
+    return A[0] + B[3] + B[8] + (int)(C[4] >> 32);
+}
+
+int main(){
+    return foo(3);
+}
@@ -0,0 +1,61 @@
+// PARALLELIZZAZIONE DEI LOOP DOALL (p='par<min-iterations=64>', eseguire con make execute rt=../../tools/build/libParRT.so)
+#define N 4096
+
+int A[N], B[N], C[N];
+
+int foo(int n, float *F){
+    // Iterazioni indipendenti -> PARALLELO
+    for(int i = 0; i < n; i++){
+        A[i] = B[i] + C[i];
+    }
+
+    // Riduzione intera: somme parziali per thread, combinate dal runtime -> PARALLELO
+    int sum = 0;
+    for(int i = 0; i < n; i++){
+        sum += A[i] * 3;
+    }
+
+    // Or dei bit -> PARALLELO
+    int mask = 0;
+    for(int i = 0; i < n; i++){
+        mask |= A[i];
+    }
+
+    // Il valore finale di una riduzione usato dal loop successivo (arriva in ctx dalla PHI LCSSA) -> PARALLELI entrambi
+    int total = 0;
+    for(int i = 0; i < n; i++){
+        total += B[i];
+    }
+    for(int i = 0; i < n; i++){
+        C[i] = B[i] * 100000 / total;
+    }
+    int last = C[n - 1];
+
+    // A[i] dipende da A[i - 1], scritto dall'iterazione precedente -> SEQUENZIALE
+    for(int i = 1; i < n; i++){
+        A[i] = A[i - 1] + B[i];
+    }
+
+    // Somma float senza -ffast-math: l'ordine delle somme cambia il risultato -> SEQUENZIALE
+    float fsum = 0;
+    for(int i = 0; i < n; i++){
+        fsum += F[i];
+    }
+
+    // Trip count costante < min-iterations -> SEQUENZIALE
+    for(int i = 0; i < 16; i++){
+        C[i] = i;
+    }
+
+    return sum + mask + (int)fsum + A[n - 1] + C[3] + last;
+}
+
+int main(){
+    float F[N];
+    for(int i = 0; i < N; i++){
+        B[i] = i;
+        C[i] = 2 * i;
+        F[i] = i * 0.5f;
+    }
+    return foo(N, F) & 0xff;
+}
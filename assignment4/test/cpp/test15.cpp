@@ -0,0 +1,47 @@
+// FUSIONE CON RIDUZIONI (p='lcssa,lf': i valori finali dei loop arrivano alle istruzioni dopo i loop con PHI LCSSA)
+// Stesso risultato con i loop ruotati (p='loop(loop-rotate),lcssa,lf'): l'uso di k nel secondo loop passa dalla PHI LCSSA
+#define N 100
+
+int A[N], B[N], C[N];
+
+int foo(int n){
+    int a = 0, b = 0;
+
+    // Riduzioni indipendenti: a e b restano PHI separate nell'header fuso,
+    // i loro valori finali vengono letti dopo il loop fuso -> FUSIONE
+    for(int i = 0; i < n; i++){
+        a += A[i];
+    }
+    for(int i = 0; i < n; i++){
+        b += B[i];
+    }
+
+    // Il secondo loop usa il valore finale della IV del primo (k = n): SCEV lo calcola prima dei loop -> FUSIONE
+    int k, s = 0;
+    for(k = 0; k < n; k++){
+        s += k;
+    }
+    for(int i = 0; i < n; i++){
+        C[i] = k + i;
+    }
+
+    // Il secondo loop usa il valore finale della riduzione del primo:
+    // dopo la fusione leggerebbe una somma parziale -> NO FUSIONE
+    int c = 0;
+    for(int i = 0; i < n; i++){
+        c += A[i];
+    }
+    for(int i = 0; i < n; i++){
+        B[i] = c;
+    }
+
+    return a + b + s + c + C[5] + B[7];
+}
+
+int main(){
+    for(int i = 0; i < N; i++){
+        A[i] = i;
+        B[i] = 2 * i;
+    }
+    return foo(N) & 0xff;
+}
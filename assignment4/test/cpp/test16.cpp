@@ -0,0 +1,36 @@
+// OTTIMIZZAZIONE PARALLELA CON PASSI CHE CREANO FUNZIONI (ParallelOpt, plugin unico):
+//   make parallel_optimize assignment=4 test=test16 lib=../../plugin/build/libLocalOpt.so p='fs,par'
+//   make execute assignment=4 test=test16 rt=../../tools/build/libParRT.so
+// Il modulo ricollegato contiene i cloni di fs e le funzioni estratte da par (definite, non solo dichiarate):
+// le due esecuzioni danno lo stesso risultato
+#define N 4096
+
+int A[N], B[N];
+
+// La chiamata ricorsiva ha step costante: fs crea walk.spec.0 nella partizione di walk
+int walk(int n, int step){
+    if(n <= 0)
+        return 0;
+    return n + walk(n - step, 2);
+}
+
+// Riduzione: par crea sum.par.0 e sum.par.0.combine nella partizione di sum
+int sum(int n){
+    int s = 0;
+    for(int i = 0; i < n; i++)
+        s += A[i];
+    return s;
+}
+
+// Un altro loop parallelo in un'altra partizione: copy.par.0 non deve confondersi con sum.par.0
+void copy(int n){
+    for(int i = 0; i < n; i++)
+        B[i] = A[i] * 2;
+}
+
+int main(){
+    for(int i = 0; i < N; i++)
+        A[i] = i % 7;
+    copy(N);
+    return (sum(N) + B[N - 1] + walk(100, 3)) & 0xff;
+}
@@ -0,0 +1,24 @@
+// VETTORIZZAZIONE CON BASI SCELTE A RUNTIME (p=vec)
+// P è X oppure Y (select/PHI di basi): nella stessa iterazione P[i + 1] e X[i] non si sovrappongono mai,
+// ma con P = X il loop legge l'elemento scritto all'iterazione prima (distanza 1) -> NON VETTORIZZATO
+// Il primo loop (basi diverse, identificate) viene vettorizzato
+// Con p=vec,vec il secondo vec salta l'epilogo scalare del primo loop (llvm.loop.isvectorized)
+int foo(bool c){
+    int X[20], Y[20];
+
+    for(int i = 0; i < 20; i++){
+        X[i] = i;
+        Y[i] = 2 * i;
+    }
+
+    int *P = c ? X : Y;
+    for(int i = 0; i < 19; i++){
+        P[i + 1] = X[i] + 1;
+    }
+
+    return X[19] + Y[19];
+}
+
+int main(){
+    return foo(true) + foo(false);
+}
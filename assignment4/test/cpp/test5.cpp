@@ -11,16 +11,24 @@ int foo(int a, int b, int N, int f){
     }
 
     int g = N + f;
-    /*
-    // Controllo dipendenze OK, ma niente merge perchè non è canonica
-    // Canonica: parte da 0 e si ferma ad un certo punto
+    // Loop che decrescono -> FUSIONE (anche con p=ic,lf: la IV viene prima resa canonica)
+    // NB: non si fondono con i due loop precedenti (A[i] scritto in avanti, A[i] scritto all'indietro:
+    //     la distanza tra gli accessi cambia ad ogni iterazione)
     for(int i=9; i>=0; i--){
         A[i] = a + b;
     }
     for(int j=9; j>=0; j--){
         B[j] = A[j];
     }
-    */
+
+    // IV diverse: all'iterazione k, i = k e j = 9 - k (quindi 9 - j = i) -> FUSIONE
+    for(int i=0; i<10; i++){
+        A[i] = B[i] + g;
+    }
+    for(int j=9; j>=0; j--){
+        B[9 - j] = A[9 - j];
+    }
+
     return A[0] + B[0] + g;
 }
 
@@ -0,0 +1,44 @@
+// FUSIONE con guardie scritte in modo diverso e loop in forma diversa
+// foo: le guardie "n>0" e "0<n" sono la stessa condizione per SCEV -> un'unica guardia
+int foo(int n){
+    int a = 0;
+    int b = 0;
+    if(n>0){
+        int i = 0;
+        do{
+            a += i;
+            i++;
+        }while(i < n);
+    }
+
+    if(0<n){
+        int j = 0;
+        do{
+            b += 2*j;
+            j++;
+        }while(j < n);
+    }
+    return a + b;
+}
+
+// bar: do-while (ruotato) seguito da un for (non ruotato): il for viene ruotato e prende la guardia "0<n"
+int bar(int n){
+    int a = 0;
+    int b = 0;
+    if(n>0){
+        int i = 0;
+        do{
+            a += i;
+            i++;
+        }while(i < n);
+    }
+
+    for(int j = 0; j < n; j++){
+        b += j;
+    }
+    return a + b;
+}
+
+int main(){
+    return foo(4) + bar(5) + foo(0) + bar(-1);
+}
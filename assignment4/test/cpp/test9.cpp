@@ -0,0 +1,17 @@
+// FUSIONE dopo il loop versioning (p=lvr,lf)
+// A, B e C sono puntatori: senza controllo a runtime non si può escludere che si sovrappongano
+void kernel(int *A, int *B, int *C, int n){
+    for(int i = 0; i < n; i++){
+        B[i] = A[i] + 1;
+    }
+    for(int i = 0; i < n; i++){
+        C[i] = A[i] + B[i];
+    }
+}
+
+int main(){
+    int X[20] = {1, 2, 3, 4, 5};
+    kernel(X, X + 5, X + 10, 5); // Disgiunti: loop fusi (clone)
+    kernel(X, X + 1, X + 10, 5); // Sovrapposti: versione originale
+    return X[12] + X[14] + X[3];
+}
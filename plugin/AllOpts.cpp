@@ -0,0 +1,219 @@
+//-----------------------------------------------------------------------------
+// Plugin unico con i passi degli assignment 1, 3 e 4
+//-----------------------------------------------------------------------------
+
+/*
+  • opt: gli stessi nomi dei plugin dei singoli assignment (es. -p cp,ai,sr,mi,li,lf<max-chain=8>), anche in una
+    pipeline di modulo (es. -p 'default<O2>,lf'), dove i passi di funzione vengono eseguiti su ogni funzione.
+    fs esegue anche li sui cloni
+  • clang -fpass-plugin=libLocalOpt.so -O1/-O2/-O3: i passi vengono eseguiti nella pipeline di clang, senza passare
+    per .bc/.ll e opt
+    • Inizio pipeline (PipelineStart): mem2reg e le ottimizzazioni locali, sullo stesso IR di make clang
+    • Prima del vettorizzatore (VectorizerStart): li, lu e lf, sui loop già semplificati e ruotati dalla pipeline
+      (lu toglie dai loop i branch invarianti, che impedirebbero la fusione e la vettorizzazione)
+    A -O0 non viene aggiunto nulla
+    I passi stampano i loro report su outs(), che in clang è lo stdout del compilatore (anche l'output di -o - / -S):
+    nei due extension point stdout viene quindi ridiretto, su /dev/null oppure, con -localopt-report, su stderr
+    (es. clang -fplugin=libLocalOpt.so -fpass-plugin=libLocalOpt.so -mllvm -localopt-report -O2 ...: -fplugin
+    carica il plugin prima che -mllvm venga letto). Con opt e -p i report restano su outs()
+*/
+
+#include "../assignment1/opts/LocalOpts.h"
+#include "../assignment3/opts/LocalOpts.h"
+#include "../assignment4/opts/LocalOpts.h"
+#include "llvm/Support/CommandLine.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char *PipelineStartPasses = "mem2reg,ai,sr,mi";
+static const char *VectorizerStartPasses = "li,lu,lf";
+
+static cl::opt<bool> ExtensionPointReport("localopt-report", cl::init(false),
+    cl::desc("Report dei passi aggiunti alla pipeline di default (clang -O<N>, opt -O<N>) su stderr invece che scartati"));
+
+// Passi di un extension point: durante la loro esecuzione lo stdout (fd 1, usato da outs()) punta a stderr
+// o a /dev/null, così i report non finiscono nell'output del compilatore
+struct ExtensionPointPasses : PassInfoMixin<ExtensionPointPasses> {
+  FunctionPassManager FPM;
+
+  explicit ExtensionPointPasses(FunctionPassManager FPM) : FPM(std::move(FPM)) {}
+
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM) {
+    int Target = ExtensionPointReport ? dup(STDERR_FILENO) : open("/dev/null", O_WRONLY);
+    int Stdout = dup(STDOUT_FILENO);
+    if (Target < 0 || Stdout < 0) report_fatal_error("LocalOpt: impossibile ridirigere stdout", false);
+
+    outs().flush(); // Quello che era già nel buffer appartiene allo stdout originale
+    dup2(Target, STDOUT_FILENO);
+    PreservedAnalyses PA = FPM.run(F, AM);
+    outs().flush();
+    dup2(Stdout, STDOUT_FILENO);
+
+    close(Target);
+    close(Stdout);
+    return PA;
+  }
+
+  static bool isRequired() { return true; }
+};
+
+// Nome con parametri (es. lf<max-chain=8>): il passo viene aggiunto solo se i parametri sono validi
+template <typename PassT, typename ParserT>
+static bool addParametrizedPass(StringRef Name, StringRef PassName, ParserT Parser, FunctionPassManager &FPM) {
+  auto Opts = PassBuilder::parsePassParameters(Parser, Name, PassName);
+  if (!Opts) {
+    errs() << toString(Opts.takeError()) << "\n";
+    return false;
+  }
+  FPM.addPass(PassT(*Opts));
+  return true;
+}
+
+bool add_passes(StringRef Name, FunctionPassManager &FPM){
+  // Assignment 1
+  if (Name == "ai") {
+    FPM.addPass(AlgebraicIdentityPass());
+    return true;
+  }
+  if (Name == "sr") {
+    FPM.addPass(StrengthReductionPass());
+    return true;
+  }
+  if (Name == "mi") {
+    FPM.addPass(MultiInstructionPass());
+    return true;
+  }
+  if (Name == "cp") {
+    FPM.addPass(ConstantPropagationPass());
+    return true;
+  }
+  if (Name == "gn") {
+    FPM.addPass(GlobalValueNumberingPass());
+    return true;
+  }
+  if (Name == "slp") {
+    FPM.addPass(SLPVectorizerPass());
+    return true;
+  }
+  if (Name == "vr") {
+    FPM.addPass(ValueRangePass());
+    return true;
+  }
+
+  // Assignment 3
+  if (PassBuilder::checkParametrizedPassName(Name, "li"))
+    return addParametrizedPass<LoopInvariantCodeMotionPass>(Name, "li", parseLICMOptions, FPM);
+  if (PassBuilder::checkParametrizedPassName(Name, "lu"))
+    return addParametrizedPass<LoopUnswitchingPass>(Name, "lu", parseLoopUnswitchingOptions, FPM);
+  if (Name == "lsr") {
+    FPM.addPass(LoopStrengthReductionPass());
+    return true;
+  }
+
+  // Assignment 4
+  if (PassBuilder::checkParametrizedPassName(Name, "lf"))
+    return addParametrizedPass<LoopFusionPass>(Name, "lf", parseLoopFusionOptions, FPM);
+  if (Name == "ic") {
+    FPM.addPass(InductionVariableCanonicalizationPass());
+    return true;
+  }
+  if (Name == "lvr") {
+    FPM.addPass(LoopVersioningPass());
+    return true;
+  }
+  if (Name == "vec") {
+    FPM.addPass(LoopVectorizationPass());
+    return true;
+  }
+  if (Name == "scr") {
+    FPM.addPass(ScalarReplacementPass());
+    return true;
+  }
+  if (Name == "ac") {
+    FPM.addPass(ArrayContractionPass());
+    return true;
+  }
+  if (PassBuilder::checkParametrizedPassName(Name, "par"))
+    return addParametrizedPass<LoopParallelizationPass>(Name, "par", parseLoopParallelizationOptions, FPM);
+  if (Name == "print<access-summary>") {
+    FPM.addPass(LoopAccessSummaryPrinterPass());
+    return true;
+  }
+
+  return false;
+}
+
+// Passi di modulo: fs<budget=N>(pipeline dei cloni), default fs(cp,ai,sr,mi,li); gli altri nomi vengono eseguiti
+// su ogni funzione
+bool add_module_passes(PassBuilder &PB, StringRef Name, ArrayRef<PassBuilder::PipelineElement> InnerPipeline, ModulePassManager &MPM){
+  if (PassBuilder::checkParametrizedPassName(Name, "fs")) {
+    Expected<FunctionSpecializationOptions> Opts = PassBuilder::parsePassParameters(parseFunctionSpecializationOptions, Name, "fs");
+    if (!Opts) {
+      errs() << toString(Opts.takeError()) << "\n";
+      return false;
+    }
+    FunctionPassManager CloneFPM;
+    Error Err = InnerPipeline.empty() ? PB.parsePassPipeline(CloneFPM, "cp,ai,sr,mi,li") : PB.parsePassPipeline(CloneFPM, InnerPipeline);
+    if (Err) {
+      errs() << toString(std::move(Err)) << "\n";
+      return false;
+    }
+    MPM.addPass(FunctionSpecializationPass(*Opts, std::move(CloneFPM)));
+    return true;
+  }
+  if (!InnerPipeline.empty()) return false;
+
+  FunctionPassManager FPM;
+  if (!add_passes(Name, FPM)) return false;
+  MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
+  return true;
+}
+
+// Pipeline di un extension point (nomi di questo plugin o di LLVM), con lo stdout ridiretto
+static void addExtensionPointPasses(PassBuilder &PB, StringRef Pipeline, FunctionPassManager &FPM) {
+  FunctionPassManager Passes;
+  if (Error Err = PB.parsePassPipeline(Passes, Pipeline))
+    report_fatal_error(std::move(Err), /*gen_crash_diag*/ false);
+  FPM.addPass(ExtensionPointPasses(std::move(Passes)));
+}
+
+//-----------------------------------------------------------------------------
+// New PM Registration
+//-----------------------------------------------------------------------------
+llvm::PassPluginLibraryInfo getTestPassPluginInfo() {
+  return {
+    LLVM_PLUGIN_API_VERSION, "LocalOpt", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+      PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager &FAM) {
+          FAM.registerPass([] { return LoopAccessSummaryAnalysis(); });
+        }
+      );
+      PB.registerPipelineParsingCallback([](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+          return add_passes(Name, FPM);
+        }
+      );
+      PB.registerPipelineParsingCallback([&PB](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement> InnerPipeline) {
+          return add_module_passes(PB, Name, InnerPipeline, MPM);
+        }
+      );
+
+      // Pipeline di default (clang -fpass-plugin, opt -O2)
+      PB.registerPipelineStartEPCallback([&PB](ModulePassManager &MPM, OptimizationLevel Level) {
+          if (Level == OptimizationLevel::O0) return;
+          FunctionPassManager FPM;
+          addExtensionPointPasses(PB, PipelineStartPasses, FPM);
+          MPM.addPass(createModuleToFunctionPassAdaptor(std::move(FPM)));
+        }
+      );
+      PB.registerVectorizerStartEPCallback([&PB](FunctionPassManager &FPM, OptimizationLevel Level) {
+          if (Level == OptimizationLevel::O0) return;
+          addExtensionPointPasses(PB, VectorizerStartPasses, FPM);
+        }
+      );
+    }
+  };
+}
+
+// This is the core interface for pass plugins. It guarantees that 'opt' will be able to recognize LocalOpt when added to the pass pipeline on the command line, i.e. via '-p LocalOpt'
+extern "C" LLVM_ATTRIBUTE_WEAK::llvm::PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return getTestPassPluginInfo();
+}
@@ -0,0 +1,190 @@
+//-----------------------------------------------------------------------------
+// DynCount: instrumentazione per il conteggio dinamico delle istruzioni
+//-----------------------------------------------------------------------------
+
+/*
+  Passo di modulo "dyncount" (plugin libDynCount.so):
+    • Ad ogni basic block viene associato un contatore i64, incrementato all'inizio del blocco
+      (dopo i PHINode): le istruzioni di un blocco vengono eseguite tutte insieme, quindi
+      esecuzioni del blocco * istruzioni del blocco = istruzioni eseguite
+    • Le tabelle statiche (blocchi, istruzioni per opcode, loop da LoopInfo) sono costanti globali
+      descritte da @__dyncount_module; le istruzioni aggiunte dal passo non vengono contate
+    • Un distruttore globale passa il descrittore a __dyncount_dump (runtime/DynCountRuntime.c)
+
+  Esempio:
+    opt -load-pass-plugin libDynCount.so -p dyncount test.ll -o test.prof.bc
+    DYNCOUNT_OUT=test.dyncount lli -load=libDynCountRT.so test.prof.bc
+    ProfDiff test.dyncount test.optimized.dyncount
+*/
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+
+using namespace llvm;
+
+struct DynCountPass : PassInfoMixin<DynCountPass> {
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &);
+  static bool isRequired() { return true; }
+};
+
+// Stringa costante (condivisa tra tutti gli usi dello stesso testo)
+Constant *getString(Module &M, StringMap<Constant*> &strings, StringRef S) {
+  Constant *&Str = strings[S];
+  if (!Str) {
+    Constant *Data = ConstantDataArray::getString(M.getContext(), S);
+    auto *GV = new GlobalVariable(M, Data->getType(), true, GlobalValue::PrivateLinkage, Data, "__dyncount_str");
+    GV->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+    Str = GV;
+  }
+  return Str;
+}
+
+// Tabella costante con gli elementi Elems
+GlobalVariable *createTable(Module &M, StructType *Ty, ArrayRef<Constant*> Elems, StringRef Name) {
+  ArrayType *ArrTy = ArrayType::get(Ty, Elems.size());
+  return new GlobalVariable(M, ArrTy, true, GlobalValue::PrivateLinkage, ConstantArray::get(ArrTy, Elems), Name);
+}
+
+PreservedAnalyses DynCountPass::run(Module &M, ModuleAnalysisManager &MAM) {
+  FunctionAnalysisManager &FAM = MAM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  LLVMContext &C = M.getContext();
+  Type *I32 = Type::getInt32Ty(C);
+  Type *I64 = Type::getInt64Ty(C);
+  Type *Ptr = PointerType::get(C, 0);
+
+  // NB: stesso layout delle struct in runtime/DynCountRuntime.c
+  StructType *BlockTy = StructType::create(C, {Ptr, Ptr, I32}, "dyncount_block");
+  StructType *OpTy = StructType::create(C, {I32, I32, I32}, "dyncount_op");
+  StructType *LoopTy = StructType::create(C, {Ptr, Ptr, I32, I32, I32}, "dyncount_loop");
+  StructType *ModuleTy = StructType::create(C, {Ptr, I32, I32, I32, I32, Ptr, Ptr, Ptr, Ptr, Ptr}, "dyncount_module");
+
+  StringMap<Constant*> strings;
+  StringMap<unsigned> opcodeIndex;
+  std::vector<Constant*> blocks, ops, loops, opcodes;
+  std::vector<std::pair<BasicBlock*, unsigned>> counted; // Blocchi da instrumentare e relativo contatore
+
+  for (Function &F : M) {
+    if (F.isDeclaration()) continue;
+
+    LoopInfo &LI = FAM.getResult<LoopAnalysis>(F);
+    Constant *FnName = getString(M, strings, F.getName());
+
+    // I blocchi senza nome prendono il nome dalla loro posizione nella funzione
+    DenseMap<BasicBlock*, std::string> names;
+    unsigned bbIndex = 0;
+    for (BasicBlock &BB : F) {
+      names[&BB] = BB.hasName() ? BB.getName().str() : "bb" + std::to_string(bbIndex);
+      bbIndex++;
+    }
+
+    // Loop della funzione in preorder: il padre viene sempre prima dei figli
+    DenseMap<Loop*, unsigned> loopId;
+    unsigned index = 0;
+    for (Loop *L : LI.getLoopsInPreorder()) {
+      loopId[L] = loops.size();
+      int parent = L->getParentLoop() ? (int)loopId[L->getParentLoop()] : -1;
+      loops.push_back(ConstantStruct::get(LoopTy, {FnName, getString(M, strings, names[L->getHeader()]),
+                                                   ConstantInt::get(I32, parent), ConstantInt::get(I32, index++),
+                                                   ConstantInt::get(I32, L->getLoopDepth())}));
+    }
+
+    for (BasicBlock &BB : F) {
+      if (BB.getFirstInsertionPt() == BB.end()) continue; // Es. catchswitch: nessun punto in cui contare
+
+      unsigned block = blocks.size();
+      Loop *L = LI.getLoopFor(&BB);
+      blocks.push_back(ConstantStruct::get(BlockTy, {FnName, getString(M, strings, names[&BB]),
+                                                     ConstantInt::get(I32, L ? (int)loopId[L] : -1)}));
+
+      // Istruzioni del blocco raggruppate per opcode (le debug intrinsic non sono istruzioni "vere")
+      MapVector<unsigned, unsigned> histogram;
+      for (Instruction &I : BB) {
+        if (!isa<DbgInfoIntrinsic>(I)) histogram[I.getOpcode()]++;
+      }
+
+      for (auto &[opcode, count] : histogram) {
+        auto It = opcodeIndex.try_emplace(Instruction::getOpcodeName(opcode), opcodes.size());
+        if (It.second) opcodes.push_back(getString(M, strings, Instruction::getOpcodeName(opcode)));
+        ops.push_back(ConstantStruct::get(OpTy, {ConstantInt::get(I32, block), ConstantInt::get(I32, It.first->second),
+                                                 ConstantInt::get(I32, count)}));
+      }
+
+      counted.push_back({&BB, block});
+    }
+  }
+
+  if (blocks.empty()) return PreservedAnalyses::all();
+
+  // Contatori: uno per blocco, azzerati
+  ArrayType *CountersTy = ArrayType::get(I64, blocks.size());
+  auto *Counters = new GlobalVariable(M, CountersTy, false, GlobalValue::PrivateLinkage,
+                                      ConstantAggregateZero::get(CountersTy), "__dyncount_counters");
+
+  for (auto &[BB, block] : counted) {
+    IRBuilder<> Builder(&*BB->getFirstInsertionPt());
+    Value *Slot = Builder.CreateConstInBoundsGEP2_64(CountersTy, Counters, 0, block);
+    Value *Count = Builder.CreateLoad(I64, Slot);
+    Builder.CreateStore(Builder.CreateAdd(Count, ConstantInt::get(I64, 1)), Slot);
+  }
+
+  ArrayType *OpcodesTy = ArrayType::get(Ptr, opcodes.size());
+  auto *Opcodes = new GlobalVariable(M, OpcodesTy, true, GlobalValue::PrivateLinkage,
+                                     ConstantArray::get(OpcodesTy, opcodes), "__dyncount_opcodes");
+
+  Constant *NoLoops = ConstantPointerNull::get(cast<PointerType>(Ptr));
+  auto *Desc = new GlobalVariable(M, ModuleTy, true, GlobalValue::PrivateLinkage,
+      ConstantStruct::get(ModuleTy, {getString(M, strings, M.getModuleIdentifier()),
+                                     ConstantInt::get(I32, blocks.size()), ConstantInt::get(I32, ops.size()),
+                                     ConstantInt::get(I32, loops.size()), ConstantInt::get(I32, opcodes.size()),
+                                     Counters,
+                                     createTable(M, BlockTy, blocks, "__dyncount_blocks"),
+                                     createTable(M, OpTy, ops, "__dyncount_ops"),
+                                     loops.empty() ? NoLoops : createTable(M, LoopTy, loops, "__dyncount_loops"),
+                                     Opcodes}),
+      "__dyncount_module");
+
+  // Distruttore globale: stampa il profilo all'uscita del programma
+  FunctionCallee Dump = M.getOrInsertFunction("__dyncount_dump", Type::getVoidTy(C), Ptr);
+  Function *Dtor = Function::Create(FunctionType::get(Type::getVoidTy(C), false), GlobalValue::InternalLinkage,
+                                    "__dyncount_dtor", M);
+  IRBuilder<> Builder(BasicBlock::Create(C, "entry", Dtor));
+  Builder.CreateCall(Dump, {Desc});
+  Builder.CreateRetVoid();
+  appendToGlobalDtors(M, Dtor, 0);
+
+  errs() << M.getModuleIdentifier() << ": DynCount instrumented " << blocks.size() << " blocks, "
+         << loops.size() << " loops\n";
+
+  return PreservedAnalyses::none();
+}
+
+//-----------------------------------------------------------------------------
+// New PM Registration
+//-----------------------------------------------------------------------------
+llvm::PassPluginLibraryInfo getDynCountPluginInfo() {
+  return {
+    LLVM_PLUGIN_API_VERSION, "DynCount", LLVM_VERSION_STRING, [](PassBuilder &PB) {
+      PB.registerPipelineParsingCallback([](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+          if (Name == "dyncount") {
+            MPM.addPass(DynCountPass());
+            return true;
+          }
+          return false;
+        }
+      );
+    }
+  };
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK::llvm::PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return getDynCountPluginInfo();
+}
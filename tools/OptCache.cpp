@@ -0,0 +1,87 @@
+//-----------------------------------------------------------------------------
+// Cache persistente dei risultati di ottimizzazione: implementazione
+//-----------------------------------------------------------------------------
+
+#include "OptCache.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+ArrayRef<uint8_t> toBytes(StringRef S) {
+  return ArrayRef<uint8_t>(reinterpret_cast<const uint8_t*>(S.data()), S.size());
+}
+
+Error OptCache::init(StringRef Pipeline, ArrayRef<std::string> Plugins) {
+  if (!enabled()) return Error::success();
+
+  if (std::error_code EC = sys::fs::create_directories(Dir))
+    return createStringError(EC, "impossibile creare la cache " + Dir);
+
+  // Il "build ID" di un plugin è l'hash del suo contenuto: ricompilarlo invalida la cache
+  SHA256 H;
+  H.update(LLVM_VERSION_STRING);
+  H.update(StringRef("\0", 1));
+  H.update(Pipeline);
+
+  for (const std::string &Path : Plugins) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(Path);
+    if (!Buf)
+      return createStringError(Buf.getError(), "impossibile leggere il plugin " + Path);
+
+    H.update(StringRef("\0", 1));
+    H.update(SHA256::hash(toBytes((*Buf)->getBuffer())));
+  }
+
+  Salt = toHex(H.final(), true);
+  return Error::success();
+}
+
+std::string OptCache::getKey(ArrayRef<char> Input) const {
+  SHA256 H;
+  H.update(Salt);
+  H.update(toBytes(StringRef(Input.data(), Input.size())));
+  return toHex(H.final(), true);
+}
+
+std::string OptCache::getPath(StringRef Key) const {
+  SmallString<256> Path(Dir);
+  sys::path::append(Path, Key.take_front(2), Key + ".bc");
+  return std::string(Path);
+}
+
+bool OptCache::lookup(StringRef Key, SmallVectorImpl<char> &Output) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf = MemoryBuffer::getFile(getPath(Key));
+  if (!Buf) {
+    Misses++;
+    return false;
+  }
+
+  StringRef Data = (*Buf)->getBuffer();
+  Output.assign(Data.begin(), Data.end());
+  Hits++;
+  return true;
+}
+
+void OptCache::store(StringRef Key, ArrayRef<char> Output) {
+  std::string Path = getPath(Key);
+  if (sys::fs::create_directories(sys::path::parent_path(Path))) return;
+
+  // Scrittura su un file temporaneo e rename: un lettore non vede mai un file a metà
+  int FD;
+  SmallString<256> TmpPath;
+  if (sys::fs::createUniqueFile(Path + ".%%%%%%.tmp", FD, TmpPath)) return;
+
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS.write(Output.data(), Output.size());
+  }
+
+  if (sys::fs::rename(TmpPath, Path))
+    sys::fs::remove(TmpPath);
+}
@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------
+// Cache persistente dei risultati di ottimizzazione
+//-----------------------------------------------------------------------------
+
+/*
+  Cache "content-addressed" su disco usata da ParallelOpt:
+    • Chiave: SHA-256 di (versione LLVM, pipeline -p, contenuto dei plugin caricati, bitcode della partizione)
+      Il bitcode della partizione contiene la funzione e le dichiarazioni di tutti i simboli che usa
+      (callee e globali, con tipi e attributi): è esattamente ciò che vede la pipeline
+    • Valore: il bitcode ottimizzato della partizione
+  I file sono in <dir>/<2 caratteri della chiave>/<chiave>.bc e vengono scritti con un rename atomico,
+  quindi più thread (o più processi) possono usare la stessa cache.
+*/
+
+#ifndef OPTCACHE_H
+#define OPTCACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+class OptCache {
+public:
+  // Con Dir vuota la cache è disabilitata
+  explicit OptCache(llvm::StringRef Dir) : Dir(Dir.str()) {}
+
+  // Calcola la parte della chiave comune a tutte le partizioni (pipeline e build dei plugin)
+  llvm::Error init(llvm::StringRef Pipeline, llvm::ArrayRef<std::string> Plugins);
+
+  bool enabled() const { return !Dir.empty(); }
+
+  std::string getKey(llvm::ArrayRef<char> Input) const;
+  bool lookup(llvm::StringRef Key, llvm::SmallVectorImpl<char> &Output);
+  void store(llvm::StringRef Key, llvm::ArrayRef<char> Output);
+
+  unsigned getHits() const { return Hits; }
+  unsigned getMisses() const { return Misses; }
+
+private:
+  std::string getPath(llvm::StringRef Key) const;
+
+  std::string Dir;
+  std::string Salt;
+  std::atomic<unsigned> Hits{0};
+  std::atomic<unsigned> Misses{0};
+};
+
+#endif
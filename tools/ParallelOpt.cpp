@@ -0,0 +1,418 @@
+//-----------------------------------------------------------------------------
+// ParallelOpt: driver di ottimizzazione parallelo
+//-----------------------------------------------------------------------------
+
+/*
+  Alternativa a "opt -load-pass-plugin ... -p ..." che può usare più core (-j):
+    1. Il modulo viene diviso in partizioni (una per funzione oppure una per SCC del call graph);
+       ogni partizione contiene le definizioni delle sue funzioni e le sole dichiarazioni dei simboli usati
+    2. Ogni partizione viene serializzata in bitcode e ottimizzata da un thread in un LLVMContext proprio,
+       con la pipeline passata a -p (stessa sintassi di opt, plugin caricati con -load-pass-plugin)
+    3. I risultati vengono ricollegati nel modulo originale nell'ordine delle partizioni,
+       quindi l'output non dipende dall'ordine in cui i thread terminano
+  NB: outs()/errs() sono stream globali e raw_ostream non è thread-safe: due thread che ci scrivono insieme sono una
+  data race sul buffer (comportamento indefinito, non solo righe mescolate). I passi di questo repository stampano
+  sempre, quindi il default è -j 1; -j diverso da 1 (0: tutti i core) solo con pipeline i cui passi non stampano
+  (es. i passi di LLVM come instcombine,gvn).
+  Con -cache-dir il risultato di ogni partizione viene salvato su disco (vedi OptCache.h)
+  e riusato finché la partizione, la pipeline e i plugin non cambiano.
+
+  Esempio: ParallelOpt -load-pass-plugin ../build/libLocalOpt.so -p cp,ai,sr,mi,dce in.ll -S -o out.ll
+           ParallelOpt -p 'sroa,instcombine,gvn' -j 0 in.ll -S -o out.ll
+*/
+
+#include "OptCache.h"
+#include "WorkStealingPool.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <thread>
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFilename(cl::Positional, cl::desc("<input .ll/.bc>"), cl::init("-"));
+static cl::opt<std::string> OutputFilename("o", cl::desc("File di output"), cl::value_desc("filename"), cl::init("-"));
+static cl::opt<std::string> Pipeline("p", cl::desc("Pipeline dei passi (sintassi di opt -p)"), cl::Required);
+static cl::list<std::string> PassPlugins("load-pass-plugin", cl::desc("Plugin da caricare (es. ../build/libLocalOpt.so)"));
+static cl::opt<unsigned> Jobs("j", cl::desc("Numero di thread (0: tutti i core), >1 solo con passi che non stampano"),
+                              cl::init(1));
+static cl::opt<bool> OutputAssembly("S", cl::desc("Scrive l'output in formato testuale (.ll)"));
+static cl::opt<std::string> CacheDir("cache-dir", cl::desc("Directory della cache dei risultati (vuota: nessuna cache)"), cl::init(""));
+
+enum class PartitionMode { Function, SCC };
+static cl::opt<PartitionMode> Partitioning("partition", cl::desc("Granularità delle partizioni"),
+    cl::values(clEnumValN(PartitionMode::Function, "function", "Una partizione per funzione"),
+               clEnumValN(PartitionMode::SCC, "scc", "Una partizione per SCC del call graph")),
+    cl::init(PartitionMode::Function));
+
+using Bitcode = SmallVector<char, 0>;
+
+struct Partition {
+  std::vector<Function*> Funcs; // Funzioni definite nella partizione (modulo originale)
+  StringSet<> Symbols;          // Nomi dei simboli della partizione prima della pipeline (definiti e dichiarati)
+  uint64_t Size = 0;            // Numero di istruzioni, per bilanciare il carico
+  Bitcode Input;
+  Bitcode Output;
+  std::string Error;
+};
+
+// ---------- 1. Partizionamento ----------
+
+std::vector<Partition> buildPartitions(Module &M) {
+  std::vector<Partition> partitions;
+
+  if (Partitioning == PartitionMode::Function) {
+    for (Function &F : M) {
+      if (F.isDeclaration()) continue;
+      partitions.emplace_back();
+      partitions.back().Funcs.push_back(&F);
+    }
+  } else {
+    // Le SCC vengono visitate bottom-up: l'ordine finale non conta, il merge avviene per nome
+    CallGraph CG(M);
+    for (auto SCC = scc_begin(&CG); !SCC.isAtEnd(); ++SCC) {
+      Partition P;
+      for (CallGraphNode *Node : *SCC) {
+        Function *F = Node->getFunction();
+        if (F && !F->isDeclaration()) P.Funcs.push_back(F);
+      }
+      if (!P.Funcs.empty()) partitions.push_back(std::move(P));
+    }
+  }
+
+  for (Partition &P : partitions) {
+    for (Function *F : P.Funcs) P.Size += F->getInstructionCount();
+  }
+
+  return partitions;
+}
+
+// Raccoglie i GlobalValue usati da una costante (anche dentro ConstantExpr annidate)
+void collectGlobals(Constant *C, SmallPtrSetImpl<Constant*> &Visited, SetVector<GlobalValue*> &Globals) {
+  if (!Visited.insert(C).second) return;
+  if (auto *GV = dyn_cast<GlobalValue>(C)) {
+    Globals.insert(GV);
+    return;
+  }
+  for (Value *Op : C->operands())
+    collectGlobals(cast<Constant>(Op), Visited, Globals);
+}
+
+// Crea nel modulo Dst la dichiarazione di un simbolo definito (o dichiarato) in un altro modulo
+GlobalValue *declareGlobal(Module &Dst, GlobalValue *GV) {
+  if (auto *FT = dyn_cast<FunctionType>(GV->getValueType())) {
+    Function *F = Function::Create(FT, GlobalValue::ExternalLinkage, GV->getAddressSpace(), GV->getName(), &Dst);
+    if (auto *Src = dyn_cast<Function>(GV)) F->setAttributes(Src->getAttributes());
+    return F;
+  }
+
+  auto *Src = dyn_cast<GlobalVariable>(GV);
+  return new GlobalVariable(Dst, GV->getValueType(), Src && Src->isConstant(), GlobalValue::ExternalLinkage,
+                            nullptr, GV->getName(), nullptr, GV->getThreadLocalMode(), GV->getAddressSpace());
+}
+
+// Modulo che contiene solo le funzioni della partizione e le dichiarazioni di ciò che usano
+// NB: costa O(dimensione della partizione), non O(dimensione del modulo) come CloneModule
+std::unique_ptr<Module> extractPartition(Module &M, Partition &P) {
+  // Identificatore fisso: il bitcode (e quindi la chiave della cache) dipende solo dal contenuto
+  auto Part = std::make_unique<Module>("partition", M.getContext());
+  Part->setDataLayout(M.getDataLayout());
+  Part->setTargetTriple(M.getTargetTriple());
+
+  // Senza "Debug Info Version" il reader scarterebbe le informazioni di debug
+  SmallVector<Module::ModuleFlagEntry> flags;
+  M.getModuleFlagsMetadata(flags);
+  for (Module::ModuleFlagEntry &Flag : flags)
+    Part->addModuleFlag(Flag.Behavior, Flag.Key->getString(), Flag.Val);
+
+  ValueToValueMapTy VMap;
+
+  for (Function *F : P.Funcs) {
+    Function *NF = Function::Create(F->getFunctionType(), F->getLinkage(), F->getAddressSpace(), F->getName(), Part.get());
+    NF->copyAttributesFrom(F);
+    NF->setComdat(nullptr); // Le comdat appartengono al modulo originale
+    VMap[F] = NF;
+
+    auto NewArg = NF->arg_begin();
+    for (Argument &A : F->args()) {
+      NewArg->setName(A.getName());
+      VMap[&A] = &*NewArg++;
+    }
+  }
+
+  // Simboli esterni alla partizione usati dalle sue funzioni
+  SmallPtrSet<Constant*, 32> visited;
+  SetVector<GlobalValue*> used;
+  for (Function *F : P.Funcs) {
+    if (F->hasPersonalityFn()) collectGlobals(F->getPersonalityFn(), visited, used);
+    for (Instruction &I : instructions(F)) {
+      for (Value *Op : I.operands()) {
+        if (auto *C = dyn_cast<Constant>(Op)) collectGlobals(C, visited, used);
+      }
+    }
+  }
+
+  for (GlobalValue *GV : used) {
+    if (!VMap.count(GV)) VMap[GV] = declareGlobal(*Part, GV);
+  }
+  for (GlobalValue &GV : Part->global_values())
+    P.Symbols.insert(GV.getName());
+
+  for (Function *F : P.Funcs) {
+    SmallVector<ReturnInst*, 8> returns;
+    CloneFunctionInto(cast<Function>(VMap[F]), F, VMap, CloneFunctionChangeType::DifferentModule, returns);
+  }
+
+  // CloneFunctionInto crea sempre llvm.dbg.cu: se è vuoto il reader lo segnalerebbe come debug info non valida
+  NamedMDNode *CUs = Part->getNamedMetadata("llvm.dbg.cu");
+  if (CUs && CUs->getNumOperands() == 0)
+    Part->eraseNamedMetadata(CUs);
+
+  return Part;
+}
+
+// ---------- 2. Ottimizzazione (eseguita dai thread) ----------
+
+// Registra i plugin su un PassBuilder e costruisce la pipeline, usato sia dai thread sia per validare -p
+Error buildPipeline(PassBuilder &PB, ArrayRef<PassPlugin> Plugins, ModulePassManager &MPM) {
+  for (const PassPlugin &Plugin : Plugins)
+    Plugin.registerPassBuilderCallbacks(PB);
+  return PB.parsePassPipeline(MPM, Pipeline);
+}
+
+void optimizePartition(Partition &P, ArrayRef<PassPlugin> Plugins, OptCache &Cache) {
+  std::string key;
+  if (Cache.enabled()) {
+    key = Cache.getKey(P.Input);
+    if (Cache.lookup(key, P.Output)) return; // Partizione già ottimizzata con la stessa pipeline
+  }
+
+  LLVMContext Ctx; // Un contesto per partizione: i thread non condividono nessuno stato dell'IR
+
+  Expected<std::unique_ptr<Module>> Part = parseBitcodeFile(MemoryBufferRef(StringRef(P.Input.data(), P.Input.size()), "partition"), Ctx);
+  if (!Part) {
+    P.Error = toString(Part.takeError());
+    return;
+  }
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PassBuilder PB;
+  ModulePassManager MPM;
+
+  if (Error E = buildPipeline(PB, Plugins, MPM)) {
+    P.Error = toString(std::move(E));
+    return;
+  }
+
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  MPM.run(**Part, MAM);
+
+  raw_svector_ostream OS(P.Output);
+  WriteBitcodeToFile(**Part, OS);
+
+  if (Cache.enabled())
+    Cache.store(key, P.Output);
+}
+
+// ---------- 3. Ricollegamento dei risultati ----------
+
+/*
+  Il modulo ottimizzato della partizione viene letto nel contesto del modulo originale, poi:
+    • I simboli che la partizione aveva prima della pipeline vengono associati per nome a quelli del modulo originale
+    • I simboli introdotti dalla pipeline:
+      • Dichiarazioni (es. intrinsic, funzioni del runtime come __parrt_for): associate per nome, o dichiarate
+      • Definizioni (es. i cloni di fs "foo.spec.N", le funzioni estratte da par "F.par.N" e "F.par.N.combine"):
+        spostate nel modulo originale; i suffissi ripartono da 0 in ogni partizione, quindi un nome già usato
+        viene reso unico (solo per i simboli interni, rinominare un simbolo esterno ne cambierebbe il significato)
+    • Gli usi dei simboli della partizione vengono sostituiti con quelli del modulo originale
+    • Il corpo ottimizzato di ogni funzione della partizione prende il posto di quello originale
+*/
+
+// Definizione introdotta dalla pipeline: spostata da R a M, con un nome unico se è interna
+bool moveNewDefinition(Module &M, Module &R, GlobalValue &GV, std::string &Error) {
+  if (M.getNamedValue(GV.getName()) && !GV.hasLocalLinkage()) {
+    Error = "la pipeline ha definito il simbolo esterno " + GV.getName().str() + ", già presente nel modulo";
+    return false;
+  }
+
+  if (const Comdat *C = GV.getComdat()) {
+    Comdat *NC = M.getOrInsertComdat(C->getName());
+    NC->setSelectionKind(C->getSelectionKind());
+    cast<GlobalObject>(GV).setComdat(NC);
+  }
+
+  // L'inserimento nella symbol table di M rinomina il simbolo se il nome è già usato
+  if (auto *F = dyn_cast<Function>(&GV)) {
+    F->removeFromParent();
+    M.getFunctionList().push_back(F);
+  } else if (auto *Var = dyn_cast<GlobalVariable>(&GV)) {
+    R.removeGlobalVariable(Var);
+    M.insertGlobalVariable(Var);
+  } else {
+    Error = "la pipeline ha definito l'alias o ifunc " + GV.getName().str() + " (non supportato)";
+    return false;
+  }
+  return true;
+}
+
+bool mergePartition(Module &M, Partition &P) {
+  Expected<std::unique_ptr<Module>> Res = parseBitcodeFile(MemoryBufferRef(StringRef(P.Output.data(), P.Output.size()), "partition"), M.getContext());
+  if (!Res) {
+    P.Error = toString(Res.takeError());
+    return false;
+  }
+  Module &R = **Res;
+
+  std::vector<std::pair<GlobalValue*, GlobalValue*>> mapping;
+  std::vector<GlobalValue*> newDefinitions;
+  for (GlobalValue &GV : R.global_values()) {
+    if (!P.Symbols.contains(GV.getName()) && !GV.isDeclaration()) {
+      newDefinitions.push_back(&GV);
+      continue;
+    }
+
+    GlobalValue *Orig = M.getNamedValue(GV.getName());
+    if (Orig && !P.Symbols.contains(GV.getName()) && Orig->hasLocalLinkage()) {
+      P.Error = "la pipeline ha dichiarato " + GV.getName().str() + ", nome di un simbolo interno di un'altra partizione";
+      return false;
+    }
+    if (!Orig) Orig = declareGlobal(M, &GV); // Es. dichiarazione di un intrinsic
+    mapping.push_back({&GV, Orig});
+  }
+
+  // Le nuove definizioni mantengono la propria identità: i loro usi nei corpi della partizione restano validi
+  for (GlobalValue *GV : newDefinitions) {
+    if (!moveNewDefinition(M, R, *GV, P.Error)) return false;
+  }
+
+  for (auto &[GV, Orig] : mapping)
+    GV->replaceAllUsesWith(Orig);
+
+  for (Function *F : P.Funcs) {
+    Function *Opt = R.getFunction(F->getName());
+    if (!Opt || Opt->isDeclaration()) continue; // Eliminata dalla pipeline (es. nessun uso)
+
+    GlobalValue::LinkageTypes linkage = F->getLinkage();
+    F->deleteBody(); // NB: imposta il linkage a External
+    F->setLinkage(linkage);
+    F->setAttributes(Opt->getAttributes());
+
+    for (unsigned i = 0; i < F->arg_size(); i++)
+      Opt->getArg(i)->replaceAllUsesWith(F->getArg(i));
+
+    F->splice(F->end(), Opt);
+    if (DISubprogram *SP = Opt->getSubprogram()) F->setSubprogram(SP);
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "Driver di ottimizzazione parallelo\n");
+
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Ctx);
+  if (!M) {
+    Err.print(argv[0], errs());
+    return 1;
+  }
+
+  std::vector<PassPlugin> plugins;
+  for (const std::string &Path : PassPlugins) {
+    Expected<PassPlugin> Plugin = PassPlugin::Load(Path);
+    if (!Plugin) {
+      errs() << "Impossibile caricare il plugin " << Path << ": " << toString(Plugin.takeError()) << "\n";
+      return 1;
+    }
+    plugins.push_back(*Plugin);
+  }
+
+  // La pipeline viene validata una volta sola, prima di partizionare
+  {
+    PassBuilder PB;
+    ModulePassManager MPM;
+    if (Error E = buildPipeline(PB, plugins, MPM)) {
+      errs() << "Pipeline non valida: " << toString(std::move(E)) << "\n";
+      return 1;
+    }
+  }
+
+  OptCache Cache(CacheDir);
+  if (Error E = Cache.init(Pipeline, PassPlugins)) {
+    errs() << toString(std::move(E)) << "\n";
+    return 1;
+  }
+
+  // I simboli vengono associati per nome: i GlobalValue senza nome ne ricevono uno
+  for (GlobalValue &GV : M->global_values()) {
+    if (!GV.hasName()) GV.setName("__anon_gv");
+  }
+
+  std::vector<Partition> partitions = buildPartitions(*M);
+  std::vector<uint64_t> costs;
+  for (Partition &P : partitions) {
+    raw_svector_ostream OS(P.Input);
+    WriteBitcodeToFile(*extractPartition(*M, P), OS);
+    costs.push_back(P.Size);
+  }
+
+  WorkStealingPool Pool(Jobs ? Jobs : std::thread::hardware_concurrency());
+  errs() << "ParallelOpt: " << partitions.size() << " partizioni su " << Pool.size() << " thread\n";
+  Pool.run(partitions.size(), [&](unsigned, unsigned I) { optimizePartition(partitions[I], plugins, Cache); }, costs);
+  if (Cache.enabled())
+    errs() << "ParallelOpt: cache " << Cache.getHits() << " hit, " << Cache.getMisses() << " miss\n";
+
+  for (Partition &P : partitions) {
+    if (P.Error.empty()) mergePartition(*M, P);
+    if (!P.Error.empty()) {
+      errs() << "Errore nella partizione di " << P.Funcs.front()->getName() << ": " << P.Error << "\n";
+      return 1;
+    }
+  }
+
+  if (verifyModule(*M, &errs())) {
+    errs() << "Il modulo ricollegato non è valido\n";
+    return 1;
+  }
+
+  std::error_code EC;
+  ToolOutputFile Out(OutputFilename, EC, OutputAssembly ? sys::fs::OF_Text : sys::fs::OF_None);
+  if (EC) {
+    errs() << EC.message() << "\n";
+    return 1;
+  }
+
+  if (OutputAssembly) M->print(Out.os(), nullptr);
+  else WriteBitcodeToFile(*M, Out.os());
+  Out.keep();
+
+  return 0;
+}
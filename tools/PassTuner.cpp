@@ -0,0 +1,439 @@
+//-----------------------------------------------------------------------------
+// PassTuner: ricerca automatica della pipeline di passi
+//-----------------------------------------------------------------------------
+
+/*
+  L'ordine dei passi conta (mi può creare occasioni per ai, li prima di lf non equivale a lf prima di li):
+  invece di scegliere a mano "p=ai,sr,mi", PassTuner cerca la sequenza migliore per ogni modulo.
+    • Candidati: sequenze (lunghe al più -max-length) dei passi di -pool, passi dei plugin o standard di opt,
+      seguite da -suffix (dce, come in make optimize)
+    • Ricerca (-search): exhaustive (tutte le sequenze, dalle più corte), random, genetic
+      (torneo, crossover a un punto, mutazioni sostituisci/inserisci/elimina/scambia, elitismo)
+    • Valutazione di un candidato, sempre in un processo separato (un passo che va in crash o non termina
+      scarta solo il candidato):
+        1. opt -load-pass-plugin ... -p <pipeline>
+        2. esecuzione: -metric=dyncount  istruzioni eseguite (DynCount, con lli): deterministico
+                       -metric=time      tempo minimo su -runs esecuzioni, con lli oppure nativo (-runner=native)
+        3. il candidato è valido solo se codice di uscita e stdout coincidono con quelli del modulo non ottimizzato
+    • -budget limita i candidati valutati; le pipeline già valutate non vengono rieseguite
+  Output: una riga "<modulo> <pipeline>" per modulo (su -o), il resoconto della ricerca su stderr.
+
+  Esempio: PassTuner -load-pass-plugin ../build/libLocalOpt.so -pool=ai,sr,mi,cp,gn -search=genetic ll/test.ll
+*/
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <random>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFilenames(cl::Positional, cl::desc("<input .ll/.bc>..."), cl::OneOrMore);
+static cl::opt<std::string> OutputFilename("o", cl::desc("File con la pipeline migliore di ogni modulo"), cl::value_desc("filename"), cl::init("-"));
+static cl::list<std::string> PassPlugins("load-pass-plugin", cl::desc("Plugin da caricare (es. ../build/libLocalOpt.so)"));
+static cl::list<std::string> Pool("pool", cl::desc("Passi tra cui cercare (default: ai,sr,mi,cp,gn)"), cl::CommaSeparated);
+static cl::opt<std::string> Suffix("suffix", cl::desc("Passi aggiunti in fondo ad ogni pipeline"), cl::init("dce"));
+static cl::opt<unsigned> MaxLength("max-length", cl::desc("Numero massimo di passi di una pipeline"), cl::init(4));
+static cl::opt<unsigned> Budget("budget", cl::desc("Numero massimo di pipeline valutate per modulo"), cl::init(100));
+
+enum class SearchMode { Exhaustive, Random, Genetic };
+static cl::opt<SearchMode> Search("search", cl::desc("Strategia di ricerca"),
+    cl::values(clEnumValN(SearchMode::Exhaustive, "exhaustive", "Tutte le sequenze, dalle più corte"),
+               clEnumValN(SearchMode::Random, "random", "Sequenze casuali"),
+               clEnumValN(SearchMode::Genetic, "genetic", "Algoritmo genetico")),
+    cl::init(SearchMode::Genetic));
+static cl::opt<unsigned> Population("population", cl::desc("Individui per generazione (genetic)"), cl::init(12));
+static cl::opt<unsigned> Generations("generations", cl::desc("Numero di generazioni (genetic)"), cl::init(10));
+static cl::opt<double> MutationRate("mutation-rate", cl::desc("Probabilità di mutazione di un figlio (genetic)"), cl::init(0.3));
+static cl::opt<unsigned> Seed("seed", cl::desc("Seme per random e genetic"), cl::init(1));
+
+enum class MetricKind { DynCount, Time };
+static cl::opt<MetricKind> Metric("metric", cl::desc("Costo di un candidato"),
+    cl::values(clEnumValN(MetricKind::DynCount, "dyncount", "Istruzioni eseguite (DynCount)"),
+               clEnumValN(MetricKind::Time, "time", "Tempo di esecuzione")),
+    cl::init(MetricKind::DynCount));
+enum class RunnerKind { Lli, Native };
+static cl::opt<RunnerKind> Runner("runner", cl::desc("Esecuzione con -metric=time"),
+    cl::values(clEnumValN(RunnerKind::Lli, "lli", "Interprete/JIT lli"),
+               clEnumValN(RunnerKind::Native, "native", "Eseguibile compilato con clang")),
+    cl::init(RunnerKind::Lli));
+static cl::opt<unsigned> Runs("runs", cl::desc("Esecuzioni per candidato con -metric=time (vale il tempo minimo)"), cl::init(3));
+static cl::opt<unsigned> RunTimeout("run-timeout", cl::desc("Secondi concessi ad ogni comando (0: nessun limite)"), cl::init(30));
+
+static cl::opt<std::string> OptPath("opt", cl::desc("Percorso di opt (default: dal PATH)"), cl::init(""));
+static cl::opt<std::string> LliPath("lli", cl::desc("Percorso di lli (default: dal PATH)"), cl::init(""));
+static cl::opt<std::string> ClangPath("clang", cl::desc("Percorso di clang (default: dal PATH)"), cl::init(""));
+static cl::opt<std::string> DynCountDir("dyncount-dir", cl::desc("Directory di libDynCount e libDynCountRT (default: quella di PassTuner)"), cl::init(""));
+
+#ifdef __APPLE__
+static const char *SharedLibExt = ".dylib";
+#else
+static const char *SharedLibExt = ".so";
+#endif
+
+using Candidate = std::vector<unsigned>; // Indici dei passi in Pool
+
+struct Evaluation {
+  bool Valid = false;
+  double Cost = 0;
+  std::string Error;
+};
+
+struct Tools {
+  std::string Opt, Lli, Clang, DynCount, DynCountRT;
+};
+
+// ---------- Esecuzione dei comandi ----------
+
+// Esegue Args[0] con stdout su Out (vuoto: scartato), stdin e stderr scartati.
+// Ritorna il codice di uscita, < 0 se il programma non termina normalmente (crash, timeout, non eseguibile)
+int runCommand(ArrayRef<StringRef> Args, StringRef Out, std::string &Err, double *Seconds = nullptr) {
+  std::optional<StringRef> redirects[] = {StringRef(""), Out, StringRef("")};
+  auto start = std::chrono::steady_clock::now();
+  int code = sys::ExecuteAndWait(Args[0], Args, std::nullopt, redirects, RunTimeout, 0, &Err);
+  if (Seconds) *Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (code < 0 && Err.empty()) Err = Args[0].str() + " non è terminato correttamente";
+  return code;
+}
+
+// Esegue uno strumento (opt, clang) che deve terminare con successo
+bool runTool(ArrayRef<StringRef> Args, std::string &Err) {
+  int code = runCommand(Args, "", Err);
+  if (code > 0) Err = sys::path::filename(Args[0]).str() + " ha fallito (codice " + std::to_string(code) + ")";
+  return code == 0;
+}
+
+// Cerca un programma: percorso esplicito oppure nel PATH
+bool findTool(StringRef Explicit, StringRef Name, std::string &Path) {
+  if (!Explicit.empty()) {
+    Path = Explicit.str();
+    return sys::fs::can_execute(Path);
+  }
+  ErrorOr<std::string> Found = sys::findProgramByName(Name);
+  if (!Found) return false;
+  Path = *Found;
+  return true;
+}
+
+// ---------- Valutazione dei candidati ----------
+
+// Istruzioni eseguite oppure secondi
+std::string formatCost(double Cost) {
+  return Metric == MetricKind::DynCount ? formatv("{0:F0} istruzioni", Cost).str() : formatv("{0:F4} s", Cost).str();
+}
+
+class Tuner {
+public:
+  Tuner(StringRef Input, StringRef TempDir, const Tools &T) : Input(Input.str()), Dir(TempDir.str()), T(T), RNG(Seed) {}
+
+  // Esegue il modulo non ottimizzato: il suo output è il riferimento per i candidati
+  bool runBaseline();
+  void search();
+  void report(raw_ostream &Out);
+
+private:
+  std::string getPipeline(const Candidate &C) const;
+  const Evaluation &evaluate(const Candidate &C);
+  bool measure(StringRef Module, Evaluation &E, std::string &Stdout, int &Code);
+  bool exhausted() const { return evaluations.size() >= Budget; }
+
+  void searchExhaustive();
+  void searchRandom();
+  void searchGenetic();
+  Candidate randomCandidate();
+  Candidate crossover(const Candidate &A, const Candidate &B);
+  void mutate(Candidate &C);
+
+  std::string Input, Dir;
+  const Tools &T;
+  std::mt19937 RNG;
+
+  Evaluation Baseline;
+  std::string BaselineStdout;
+  int BaselineCode = 0;
+
+  StringMap<Evaluation> evaluations; // Pipeline -> valutazione (ogni pipeline viene eseguita una volta sola)
+  std::string Best;                  // Pipeline migliore tra quelle valide
+};
+
+std::string Tuner::getPipeline(const Candidate &C) const {
+  SmallVector<StringRef, 8> passes;
+  for (unsigned P : C) passes.push_back(Pool[P]);
+  if (!Suffix.empty()) passes.push_back(Suffix);
+  return join(passes, ",");
+}
+
+// Esegue il modulo (instrumentato con DynCount se la metrica è dyncount) e ne misura il costo
+bool Tuner::measure(StringRef Module, Evaluation &E, std::string &Stdout, int &Code) {
+  std::string outFile = Dir + "/stdout.txt";
+  std::string exec = Module.str();
+  int code;
+
+  if (Metric == MetricKind::DynCount) {
+    std::string prof = Dir + "/prof.bc", counts = Dir + "/counts.dyncount";
+    if (!runTool({T.Opt, "-load-pass-plugin", T.DynCount, "-p", "dyncount", Module, "-o", prof}, E.Error)) return false;
+    sys::fs::remove(counts);
+    ::setenv("DYNCOUNT_OUT", counts.c_str(), 1);
+    code = runCommand({T.Lli, "-load=" + T.DynCountRT, prof}, outFile, E.Error);
+    if (code < 0) return false;
+
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Counts = MemoryBuffer::getFile(counts);
+    if (!Counts) {
+      E.Error = "profilo DynCount mancante";
+      return false;
+    }
+    SmallVector<StringRef, 16> lines;
+    (*Counts)->getBuffer().split(lines, '\n');
+    for (StringRef Line : lines) {
+      uint64_t total;
+      if (Line.consume_front("total ") && !Line.trim().getAsInteger(10, total)) E.Cost = total;
+    }
+  } else {
+    if (Runner == RunnerKind::Native) {
+      exec = Dir + "/candidate.exe";
+      if (!runTool({T.Clang, "-O0", "-w", Module, "-o", exec}, E.Error)) return false;
+    }
+
+    // Tempo minimo: le esecuzioni più lente misurano soprattutto il rumore della macchina
+    E.Cost = std::numeric_limits<double>::max();
+    for (unsigned i = 0; i < std::max(1u, (unsigned)Runs); i++) {
+      double seconds;
+      code = Runner == RunnerKind::Native ? runCommand({exec}, outFile, E.Error, &seconds)
+                                          : runCommand({T.Lli, exec}, outFile, E.Error, &seconds);
+      if (code < 0) return false;
+      E.Cost = std::min(E.Cost, seconds);
+    }
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Output = MemoryBuffer::getFile(outFile);
+  Stdout = Output ? (*Output)->getBuffer().str() : "";
+  Code = code;
+  return true;
+}
+
+bool Tuner::runBaseline() {
+  if (!measure(Input, Baseline, BaselineStdout, BaselineCode)) {
+    errs() << Input << ": esecuzione del modulo non ottimizzato fallita: " << Baseline.Error << "\n";
+    return false;
+  }
+  Baseline.Valid = true;
+  errs() << Input << ": (nessun passo) -> " << formatCost(Baseline.Cost) << "\n";
+  return true;
+}
+
+const Evaluation &Tuner::evaluate(const Candidate &C) {
+  std::string pipeline = getPipeline(C);
+  auto [It, inserted] = evaluations.try_emplace(pipeline);
+  Evaluation &E = It->second;
+  if (!inserted) return E;
+
+  std::string optimized = Dir + "/candidate.bc";
+  SmallVector<StringRef, 16> args = {T.Opt};
+  for (const std::string &Plugin : PassPlugins) args.append({"-load-pass-plugin", Plugin});
+  args.append({"-p", pipeline, Input, "-o", optimized});
+
+  std::string out;
+  int code;
+  // Pipeline non valida o passo fallito: il candidato viene scartato
+  if (runTool(args, E.Error) && measure(optimized, E, out, code)) {
+    E.Valid = out == BaselineStdout && code == BaselineCode;
+    if (!E.Valid) E.Error = "output diverso dal modulo non ottimizzato";
+  }
+
+  errs() << "  [" << evaluations.size() << "] " << pipeline << " -> ";
+  if (E.Valid) errs() << formatCost(E.Cost) << "\n";
+  else errs() << "scartata (" << E.Error << ")\n";
+
+  // A parità di costo vince la pipeline più corta (compila prima)
+  if (E.Valid) {
+    const Evaluation *B = Best.empty() ? nullptr : &evaluations[Best];
+    if (!B || E.Cost < B->Cost || (E.Cost == B->Cost && pipeline.size() < Best.size())) Best = pipeline;
+  }
+  return E;
+}
+
+// ---------- Strategie di ricerca ----------
+
+// Tutte le sequenze di lunghezza 1..MaxLength (a contatore), senza lo stesso passo due volte di fila:
+// ripetere subito un passo non trova di solito nulla di nuovo e il numero di sequenze cresce molto più in fretta
+void Tuner::searchExhaustive() {
+  for (unsigned length = 1; length <= MaxLength; length++) {
+    Candidate C(length, 0);
+    while (!exhausted()) {
+      bool repeated = false;
+      for (unsigned i = 1; i < length; i++) repeated |= C[i] == C[i - 1];
+      if (!repeated) evaluate(C);
+
+      unsigned i = 0;
+      while (i < length && ++C[i] == Pool.size()) C[i++] = 0;
+      if (i == length) break; // Sequenze di questa lunghezza terminate
+    }
+  }
+}
+
+Candidate Tuner::randomCandidate() {
+  Candidate C(std::uniform_int_distribution<unsigned>(1, MaxLength)(RNG));
+  for (unsigned &P : C) P = std::uniform_int_distribution<unsigned>(0, Pool.size() - 1)(RNG);
+  return C;
+}
+
+void Tuner::searchRandom() {
+  // Le pipeline ripetute non consumano budget: il limite sui tentativi evita di girare a vuoto su spazi piccoli
+  for (unsigned tries = 0; !exhausted() && tries < 10 * Budget; tries++) evaluate(randomCandidate());
+}
+
+// Prefisso di A seguito dal suffisso di B
+Candidate Tuner::crossover(const Candidate &A, const Candidate &B) {
+  unsigned i = std::uniform_int_distribution<unsigned>(0, A.size())(RNG);
+  unsigned j = std::uniform_int_distribution<unsigned>(0, B.size())(RNG);
+  Candidate C(A.begin(), A.begin() + i);
+  C.insert(C.end(), B.begin() + j, B.end());
+  if (C.size() > MaxLength) C.resize(MaxLength);
+  if (C.empty()) C.push_back(A.front());
+  return C;
+}
+
+void Tuner::mutate(Candidate &C) {
+  auto pass = [&] { return std::uniform_int_distribution<unsigned>(0, Pool.size() - 1)(RNG); };
+  auto position = [&](unsigned N) { return std::uniform_int_distribution<unsigned>(0, N - 1)(RNG); };
+
+  switch (std::uniform_int_distribution<unsigned>(0, 3)(RNG)) {
+  case 0: // Sostituisci
+    C[position(C.size())] = pass();
+    break;
+  case 1: // Inserisci
+    if (C.size() < MaxLength) C.insert(C.begin() + position(C.size() + 1), pass());
+    break;
+  case 2: // Elimina
+    if (C.size() > 1) C.erase(C.begin() + position(C.size()));
+    break;
+  case 3: // Scambia (l'ordine è proprio ciò che si cerca)
+    std::swap(C[position(C.size())], C[position(C.size())]);
+    break;
+  }
+}
+
+void Tuner::searchGenetic() {
+  // Fitness: costo del candidato, i candidati non validi sono i peggiori
+  auto cost = [&](const Candidate &C) {
+    const Evaluation &E = evaluate(C);
+    return E.Valid ? E.Cost : std::numeric_limits<double>::max();
+  };
+
+  std::vector<std::pair<double, Candidate>> population;
+  for (unsigned i = 0; i < Population && !exhausted(); i++) {
+    Candidate C = randomCandidate();
+    population.push_back({cost(C), C});
+  }
+
+  for (unsigned gen = 1; gen <= Generations && !exhausted() && !population.empty(); gen++) {
+    llvm::stable_sort(population, [](auto &A, auto &B) { return A.first < B.first; });
+    errs() << "  generazione " << gen << ", migliore: " << getPipeline(population.front().second) << "\n";
+
+    // Torneo a 3: il migliore di tre individui a caso
+    auto select = [&]() -> const Candidate & {
+      unsigned best = population.size();
+      for (unsigned k = 0; k < 3; k++) best = std::min(best, std::uniform_int_distribution<unsigned>(0, population.size() - 1)(RNG));
+      return population[best].second;
+    };
+
+    // Elitismo: i due migliori passano alla generazione successiva
+    std::vector<std::pair<double, Candidate>> next(population.begin(), population.begin() + std::min<size_t>(2, population.size()));
+    while (next.size() < Population && !exhausted()) {
+      Candidate C = crossover(select(), select());
+      if (std::uniform_real_distribution<double>(0, 1)(RNG) < MutationRate) mutate(C);
+      next.push_back({cost(C), C});
+    }
+    population = std::move(next);
+  }
+}
+
+void Tuner::search() {
+  switch (Search) {
+  case SearchMode::Exhaustive: searchExhaustive(); break;
+  case SearchMode::Random: searchRandom(); break;
+  case SearchMode::Genetic: searchGenetic(); break;
+  }
+}
+
+void Tuner::report(raw_ostream &Out) {
+  if (Best.empty()) {
+    errs() << Input << ": nessuna pipeline valida su " << evaluations.size() << " valutate\n";
+    return;
+  }
+
+  double cost = evaluations[Best].Cost;
+  errs() << Input << ": migliore " << Best << " -> " << formatCost(cost) << " (" << evaluations.size() << " pipeline valutate";
+  if (Baseline.Cost > 0) errs() << format(", %+.2f%%", 100.0 * (cost - Baseline.Cost) / Baseline.Cost);
+  errs() << ")\n";
+  Out << Input << " " << Best << "\n";
+}
+
+int main(int argc, char **argv) {
+  InitLLVM X(argc, argv);
+  cl::ParseCommandLineOptions(argc, argv, "Ricerca automatica della pipeline di passi\n");
+
+  if (Pool.empty()) {
+    for (const char *P : {"ai", "sr", "mi", "cp", "gn"}) Pool.push_back(P);
+  }
+  if (!MaxLength) MaxLength = 1;
+
+  Tools T;
+  if (!findTool(OptPath, "opt", T.Opt) || !findTool(LliPath, "lli", T.Lli) ||
+      (Metric == MetricKind::Time && Runner == RunnerKind::Native && !findTool(ClangPath, "clang", T.Clang))) {
+    errs() << "opt, lli (e clang con -runner=native) devono essere nel PATH o indicati con -opt, -lli, -clang\n";
+    return 1;
+  }
+
+  // DynCount viene compilato insieme a PassTuner (make tools)
+  SmallString<256> dir(DynCountDir);
+  if (dir.empty()) {
+    dir = sys::fs::getMainExecutable(argv[0], (void *)&runCommand);
+    sys::path::remove_filename(dir);
+  }
+  T.DynCount = (Twine(dir) + "/libDynCount" + SharedLibExt).str();
+  T.DynCountRT = (Twine(dir) + "/libDynCountRT" + SharedLibExt).str();
+  if (Metric == MetricKind::DynCount && (!sys::fs::exists(T.DynCount) || !sys::fs::exists(T.DynCountRT))) {
+    errs() << "libDynCount/libDynCountRT non trovate in " << dir << " (usa -dyncount-dir)\n";
+    return 1;
+  }
+
+  std::error_code EC;
+  ToolOutputFile Out(OutputFilename, EC, sys::fs::OF_Text);
+  if (EC) {
+    errs() << EC.message() << "\n";
+    return 1;
+  }
+
+  for (const std::string &Input : InputFilenames) {
+    SmallString<128> tempDir;
+    if ((EC = sys::fs::createUniqueDirectory("passtuner", tempDir))) {
+      errs() << EC.message() << "\n";
+      return 1;
+    }
+
+    Tuner Tune(Input, tempDir, T);
+    if (Tune.runBaseline()) {
+      Tune.search();
+      Tune.report(Out.os());
+    }
+    sys::fs::remove_directories(tempDir);
+  }
+
+  Out.keep();
+  return 0;
+}
@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// Thread pool work-stealing
+//-----------------------------------------------------------------------------
+
+/*
+  I task sono noti a priori (es. una partizione del modulo ciascuno):
+    • Vengono ordinati per costo decrescente e distribuiti round-robin sulle code dei thread
+    • Ogni thread estrae dalla testa della propria coda
+    • Quando la propria coda è vuota, "ruba" dalla coda degli altri thread (dal fondo, i task più leggeri)
+  Nessun task ne genera altri, quindi un thread termina quando tutte le code sono vuote.
+*/
+
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(unsigned Threads) : NumThreads(std::max(1u, Threads)) {}
+
+  // Esegue Task(i) per ogni i in [0, N) e ritorna quando sono tutti completati.
+  // Cost (opzionale) stima il costo di ogni task, per bilanciare la distribuzione iniziale.
+  void run(unsigned N, const std::function<void(unsigned Worker, unsigned Task)> &Task,
+           const std::vector<uint64_t> &Cost = {}) {
+    std::vector<unsigned> order(N);
+    std::iota(order.begin(), order.end(), 0);
+    if (Cost.size() == N)
+      std::stable_sort(order.begin(), order.end(), [&](unsigned A, unsigned B) { return Cost[A] > Cost[B]; });
+
+    unsigned threads = std::min(NumThreads, std::max(1u, N));
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (unsigned t = 0; t < threads; t++)
+      queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < N; i++)
+      queues[i % threads]->Tasks.push_back(order[i]);
+
+    auto worker = [&](unsigned Id) {
+      unsigned task;
+      while (pop(*queues[Id], task) || steal(queues, Id, task))
+        Task(Id, task);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+      pool.emplace_back(worker, t);
+    worker(0); // Il thread chiamante lavora come gli altri
+    for (std::thread &T : pool)
+      T.join();
+  }
+
+  unsigned size() const { return NumThreads; }
+
+private:
+  struct Queue {
+    std::mutex Lock;
+    std::deque<unsigned> Tasks;
+  };
+
+  static bool pop(Queue &Q, unsigned &Task) {
+    std::lock_guard<std::mutex> guard(Q.Lock);
+    if (Q.Tasks.empty()) return false;
+    Task = Q.Tasks.front();
+    Q.Tasks.pop_front();
+    return true;
+  }
+
+  static bool steal(std::vector<std::unique_ptr<Queue>> &Queues, unsigned Id, unsigned &Task) {
+    for (unsigned i = 1; i < Queues.size(); i++) {
+      Queue &Victim = *Queues[(Id + i) % Queues.size()];
+      std::lock_guard<std::mutex> guard(Victim.Lock);
+      if (Victim.Tasks.empty()) continue;
+      Task = Victim.Tasks.back();
+      Victim.Tasks.pop_back();
+      return true;
+    }
+    return false;
+  }
+
+  unsigned NumThreads;
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*-----------------------------------------------------------------------------
+  Runtime del profiler DynCount
+-----------------------------------------------------------------------------*/
+
+/*
+  Il passo "dyncount" aggiunge ad ogni modulo:
+    • un contatore per basic block, incrementato all'inizio del blocco
+    • le tabelle statiche dei blocchi (funzione, nome, loop più interno),
+      delle istruzioni di ogni blocco raggruppate per opcode e dei loop (header, loop padre, profondità)
+    • un distruttore globale che chiama __dyncount_dump
+  Il runtime moltiplica i contatori per il numero di istruzioni dei blocchi e scrive:
+    total    <istruzioni eseguite>
+    opcode   <opcode> <istruzioni eseguite>
+    function <funzione> <istruzioni eseguite>
+    loop     <funzione> <indice del loop nella funzione> <header> <profondità> <istruzioni eseguite>
+    block    <funzione> <blocco> <esecuzioni> <istruzioni eseguite>
+  sul file indicato da DYNCOUNT_OUT (stderr se non è impostata), nel formato letto da ProfDiff.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* NB: il layout deve coincidere con i tipi creati dal passo (DynCount.cpp) */
+struct dyncount_block {
+  const char *function;
+  const char *name;
+  int32_t loop;       /* Loop più interno che contiene il blocco, -1 se nessuno */
+};
+
+struct dyncount_op {
+  uint32_t block;
+  uint32_t opcode;    /* Indice in opcodes */
+  uint32_t count;     /* Istruzioni con quell'opcode nel blocco */
+};
+
+struct dyncount_loop {
+  const char *function;
+  const char *header;
+  int32_t parent;     /* Loop che lo contiene, -1 se è un loop esterno */
+  uint32_t index;     /* Indice del loop nella funzione (preorder) */
+  uint32_t depth;
+};
+
+struct dyncount_module {
+  const char *name;
+  uint32_t num_blocks;
+  uint32_t num_ops;
+  uint32_t num_loops;
+  uint32_t num_opcodes;
+  uint64_t *counters;
+  const struct dyncount_block *blocks;
+  const struct dyncount_op *ops;
+  const struct dyncount_loop *loops;
+  const char *const *opcodes;
+};
+
+void __dyncount_dump(const struct dyncount_module *M) {
+  uint64_t *block_instrs = calloc(M->num_blocks, sizeof(uint64_t));
+  uint64_t *opcode_instrs = calloc(M->num_opcodes, sizeof(uint64_t));
+  uint64_t *loop_instrs = calloc(M->num_loops, sizeof(uint64_t));
+  uint64_t total = 0;
+  uint32_t i;
+
+  if (!block_instrs || !opcode_instrs || !loop_instrs) {
+    free(block_instrs);
+    free(opcode_instrs);
+    free(loop_instrs);
+    return;
+  }
+
+  /* Istruzioni eseguite = esecuzioni del blocco * istruzioni del blocco con quell'opcode */
+  for (i = 0; i < M->num_ops; i++) {
+    const struct dyncount_op *op = &M->ops[i];
+    uint64_t executed = M->counters[op->block] * op->count;
+    block_instrs[op->block] += executed;
+    opcode_instrs[op->opcode] += executed;
+    total += executed;
+  }
+
+  /* Un loop conta anche le istruzioni dei loop annidati */
+  for (i = 0; i < M->num_blocks; i++) {
+    int32_t loop;
+    for (loop = M->blocks[i].loop; loop >= 0; loop = M->loops[loop].parent)
+      loop_instrs[loop] += block_instrs[i];
+  }
+
+  const char *path = getenv("DYNCOUNT_OUT");
+  FILE *out = path ? fopen(path, "w") : NULL;
+  if (!out) out = stderr;
+
+  fprintf(out, "# dyncount %s\n", M->name);
+  fprintf(out, "total %llu\n", (unsigned long long)total);
+
+  for (i = 0; i < M->num_opcodes; i++) {
+    if (opcode_instrs[i])
+      fprintf(out, "opcode %s %llu\n", M->opcodes[i], (unsigned long long)opcode_instrs[i]);
+  }
+
+  /* I blocchi di una funzione sono contigui nella tabella */
+  for (i = 0; i < M->num_blocks;) {
+    const char *function = M->blocks[i].function;
+    uint64_t instrs = 0;
+    for (; i < M->num_blocks && M->blocks[i].function == function; i++)
+      instrs += block_instrs[i];
+    fprintf(out, "function %s %llu\n", function, (unsigned long long)instrs);
+  }
+
+  for (i = 0; i < M->num_loops; i++) {
+    const struct dyncount_loop *L = &M->loops[i];
+    fprintf(out, "loop %s %u %s %u %llu\n", L->function, L->index, L->header, L->depth,
+            (unsigned long long)loop_instrs[i]);
+  }
+
+  for (i = 0; i < M->num_blocks; i++) {
+    if (M->counters[i])
+      fprintf(out, "block %s %s %llu %llu\n", M->blocks[i].function, M->blocks[i].name,
+              (unsigned long long)M->counters[i], (unsigned long long)block_instrs[i]);
+  }
+
+  if (out != stderr) fclose(out);
+  else fflush(out);
+
+  free(block_instrs);
+  free(opcode_instrs);
+  free(loop_instrs);
+}
@@ -0,0 +1,223 @@
+/*-----------------------------------------------------------------------------
+  Runtime della parallelizzazione dei loop (passo "par")
+-----------------------------------------------------------------------------*/
+
+/*
+  Il passo sostituisce un loop DOALL con:
+    __parrt_for(n, body, ctx, result, identity, size, combine)
+  dove body(begin, end, ctx, partial) esegue le iterazioni [begin, end) del loop, ctx contiene i valori usati dal
+  corpo e partial le riduzioni (size byte, 0 se il loop non ha riduzioni).
+    • Thread pool creato alla prima chiamata con PARRT_NUM_THREADS thread (default: i core disponibili); il thread
+      chiamante lavora come gli altri
+    • Scheduling (PARRT_SCHEDULE):
+      • static: ogni thread esegue un blocco contiguo di n / thread iterazioni
+      • dynamic (default): ogni thread parte dal proprio blocco e lo esegue a chunk di PARRT_CHUNK iterazioni
+        (default n / (8 * thread)); quando il blocco è finito ruba metà delle iterazioni rimaste a un altro thread
+    • Riduzioni: i parziali di ogni thread partono da identity e vengono combinati (combine) in result, che contiene
+      i valori iniziali, in ordine di thread
+  Un loop parallelo dentro il corpo di un altro, o chiamato mentre un altro è in corso (da un altro thread del
+  programma), viene eseguito in modo sequenziale, come quelli con meno iterazioni che thread.
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* NB: le firme devono coincidere con le funzioni create dal passo (LoopParallelization.cpp) */
+typedef void (*parrt_body)(int64_t begin, int64_t end, void *ctx, void *partial);
+typedef void (*parrt_combine)(void *acc, void *partial);
+
+enum parrt_schedule { PARRT_STATIC, PARRT_DYNAMIC };
+
+/* Iterazioni [next, end) ancora da eseguire di un thread */
+struct parrt_range {
+  pthread_mutex_t lock;
+  int64_t next;
+  int64_t end;
+};
+
+struct parrt_job {
+  parrt_body body;
+  void *ctx;
+  char *partials;     /* size byte per thread */
+  int64_t size;
+  int64_t chunk;
+  struct parrt_range *ranges;
+};
+
+static pthread_once_t parrt_once = PTHREAD_ONCE_INIT;
+static unsigned parrt_threads = 1;
+static enum parrt_schedule parrt_schedule = PARRT_DYNAMIC;
+static int64_t parrt_chunk = 0;
+
+/* Lavoro corrente: i worker aspettano un nuovo valore di parrt_generation */
+static pthread_mutex_t parrt_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parrt_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t parrt_done = PTHREAD_COND_INITIALIZER;
+static struct parrt_job *parrt_current;
+static uint64_t parrt_generation;
+static unsigned parrt_pending;
+
+static pthread_mutex_t parrt_busy = PTHREAD_MUTEX_INITIALIZER; /* Un solo loop parallelo alla volta */
+static __thread int parrt_in_parallel;
+
+static int parrt_take(struct parrt_range *range, int64_t chunk, int64_t *begin, int64_t *end) {
+  int found = 0;
+  pthread_mutex_lock(&range->lock);
+  if (range->next < range->end) {
+    *begin = range->next;
+    *end = range->end - range->next > chunk ? range->next + chunk : range->end;
+    range->next = *end;
+    found = 1;
+  }
+  pthread_mutex_unlock(&range->lock);
+  return found;
+}
+
+/* Metà delle iterazioni rimaste (la parte finale) del primo thread che ne ha ancora */
+static int parrt_steal(struct parrt_job *job, unsigned id, int64_t *begin, int64_t *end) {
+  for (unsigned i = 1; i < parrt_threads; i++) {
+    struct parrt_range *victim = &job->ranges[(id + i) % parrt_threads];
+    int found = 0;
+    pthread_mutex_lock(&victim->lock);
+    int64_t left = victim->end - victim->next;
+    if (left > 0) {
+      int64_t stolen = left > job->chunk ? left / 2 : left;
+      *begin = victim->end - stolen;
+      *end = victim->end;
+      victim->end = *begin;
+      found = 1;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    if (found) return 1;
+  }
+  return 0;
+}
+
+static void parrt_run(struct parrt_job *job, unsigned id) {
+  struct parrt_range *own = &job->ranges[id];
+  void *partial = job->size ? job->partials + id * job->size : NULL;
+  int64_t begin, end;
+
+  parrt_in_parallel = 1;
+  if (parrt_schedule == PARRT_STATIC) {
+    if (own->next < own->end) job->body(own->next, own->end, job->ctx, partial);
+  } else {
+    for (;;) {
+      if (parrt_take(own, job->chunk, &begin, &end)) {
+        job->body(begin, end, job->ctx, partial);
+        continue;
+      }
+      if (!parrt_steal(job, id, &begin, &end)) break;
+
+      /* Le iterazioni rubate diventano il proprio blocco: altri thread possono rubarne a loro volta una parte */
+      pthread_mutex_lock(&own->lock);
+      own->next = begin;
+      own->end = end;
+      pthread_mutex_unlock(&own->lock);
+    }
+  }
+  parrt_in_parallel = 0;
+}
+
+static void *parrt_worker(void *arg) {
+  unsigned id = (unsigned)(uintptr_t)arg;
+  uint64_t seen = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&parrt_lock);
+    while (parrt_generation == seen) pthread_cond_wait(&parrt_start, &parrt_lock);
+    seen = parrt_generation;
+    struct parrt_job *job = parrt_current;
+    pthread_mutex_unlock(&parrt_lock);
+
+    parrt_run(job, id);
+
+    pthread_mutex_lock(&parrt_lock);
+    if (--parrt_pending == 0) pthread_cond_signal(&parrt_done);
+    pthread_mutex_unlock(&parrt_lock);
+  }
+  return NULL;
+}
+
+static void parrt_init(void) {
+  const char *threads = getenv("PARRT_NUM_THREADS");
+  long count = threads ? atol(threads) : sysconf(_SC_NPROCESSORS_ONLN);
+  if (count < 1) count = 1;
+
+  const char *schedule = getenv("PARRT_SCHEDULE");
+  if (schedule && !strcmp(schedule, "static")) parrt_schedule = PARRT_STATIC;
+
+  const char *chunk = getenv("PARRT_CHUNK");
+  if (chunk) parrt_chunk = atoll(chunk);
+
+  /* I worker sono 1..count-1, il thread 0 è il chiamante */
+  parrt_threads = (unsigned)count;
+  for (unsigned id = 1; id < (unsigned)count; id++) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, parrt_worker, (void *)(uintptr_t)id) != 0) {
+      parrt_threads = id;
+      break;
+    }
+    pthread_detach(thread);
+  }
+}
+
+void __parrt_for(int64_t n, parrt_body body, void *ctx, void *result, void *identity, int64_t size, parrt_combine combine) {
+  if (n <= 0) return;
+  pthread_once(&parrt_once, parrt_init);
+
+  if (parrt_threads == 1 || n < parrt_threads || parrt_in_parallel || pthread_mutex_trylock(&parrt_busy) != 0) {
+    body(0, n, ctx, result);
+    return;
+  }
+
+  struct parrt_job job;
+  job.body = body;
+  job.ctx = ctx;
+  job.size = size;
+  job.chunk = parrt_chunk > 0 ? parrt_chunk : n / (8 * (int64_t)parrt_threads);
+  if (job.chunk < 1) job.chunk = 1;
+  job.ranges = malloc(parrt_threads * sizeof(struct parrt_range));
+  job.partials = size ? malloc(parrt_threads * size) : NULL;
+  if (!job.ranges || (size && !job.partials)) {
+    free(job.ranges);
+    free(job.partials);
+    pthread_mutex_unlock(&parrt_busy);
+    body(0, n, ctx, result);
+    return;
+  }
+
+  /* Blocchi contigui, i primi n % thread hanno un'iterazione in più */
+  int64_t base = n / parrt_threads, extra = n % parrt_threads;
+  for (unsigned id = 0; id < parrt_threads; id++) {
+    struct parrt_range *range = &job.ranges[id];
+    pthread_mutex_init(&range->lock, NULL);
+    range->next = id * base + (id < extra ? id : extra);
+    range->end = range->next + base + (id < extra ? 1 : 0);
+    if (size) memcpy(job.partials + id * size, identity, size);
+  }
+
+  pthread_mutex_lock(&parrt_lock);
+  parrt_current = &job;
+  parrt_pending = parrt_threads - 1;
+  parrt_generation++;
+  pthread_cond_broadcast(&parrt_start);
+  pthread_mutex_unlock(&parrt_lock);
+
+  parrt_run(&job, 0);
+
+  pthread_mutex_lock(&parrt_lock);
+  while (parrt_pending) pthread_cond_wait(&parrt_done, &parrt_lock);
+  pthread_mutex_unlock(&parrt_lock);
+
+  for (unsigned id = 0; id < parrt_threads; id++) {
+    if (size) combine(result, job.partials + id * size);
+    pthread_mutex_destroy(&job.ranges[id].lock);
+  }
+  free(job.ranges);
+  free(job.partials);
+  pthread_mutex_unlock(&parrt_busy);
+}